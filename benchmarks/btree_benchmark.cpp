@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "btree.h"
+#include "olc_btree.h"
+
+namespace {
+
+// Размеры 1e6 и 1e7 гоняются всегда; 1e8 (~несколько ГБ на std::map)
+// включается только при сборке с -DBTREE_BENCHMARK_HUGE.
+void sizes(benchmark::internal::Benchmark* b) {
+  b->Arg(1 << 20)->Arg(10'000'000);
+#ifdef BTREE_BENCHMARK_HUGE
+  b->Arg(100'000'000);
+#endif
+  b->Unit(benchmark::kMillisecond);
+}
+
+std::vector<std::int64_t> shuffledKeys(std::size_t n) {
+  std::vector<std::int64_t> keys(n);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(7));
+  return keys;
+}
+
+// Каждая итерация - 1e5 случайных поисков по уже построенному контейнеру.
+constexpr std::size_t kLookups = 100'000;
+
+template <typename Map>
+Map build(std::size_t n) {
+  Map map;
+  for (std::int64_t key : shuffledKeys(n)) {
+    map.emplace(key, key);
+  }
+  return map;
+}
+
+template <>
+BTreeMap<std::int64_t, std::int64_t> build(std::size_t n) {
+  std::vector<std::pair<std::int64_t, std::int64_t>> sorted(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    sorted[i] = {static_cast<std::int64_t>(i), static_cast<std::int64_t>(i)};
+  }
+  return {sorted_unique, sorted.begin(), sorted.end()};
+}
+
+template <typename Map>
+void BM_PointLookup(benchmark::State& state) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const Map map = build<Map>(n);
+  std::vector<std::int64_t> probes = shuffledKeys(n);
+  probes.resize(std::min(n, kLookups));
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    for (std::int64_t key : probes) {
+      sum += map.find(key)->second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(probes.size()));
+}
+BENCHMARK_TEMPLATE(BM_PointLookup, std::map<std::int64_t, std::int64_t>)
+    ->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_PointLookup, BTreeMap<std::int64_t, std::int64_t>)
+    ->Apply(sizes);
+
+// Сканирование 1000 соседних ключей от случайной точки.
+template <typename Map>
+void BM_RangeScan(benchmark::State& state) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const Map map = build<Map>(n);
+  std::vector<std::int64_t> starts = shuffledKeys(n);
+  starts.resize(1000);
+  std::size_t next = 0;
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    auto it = map.lower_bound(starts[next++ % starts.size()]);
+    for (int i = 0; i < 1000 && it != map.end(); ++i, ++it) {
+      sum += it->second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK_TEMPLATE(BM_RangeScan, std::map<std::int64_t, std::int64_t>)
+    ->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_RangeScan, BTreeMap<std::int64_t, std::int64_t>)
+    ->Apply(sizes);
+
+template <typename Map>
+void BM_RandomInsert(benchmark::State& state) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const std::vector<std::int64_t> keys = shuffledKeys(n);
+  for (auto _ : state) {
+    Map map;
+    for (std::int64_t key : keys) {
+      map.emplace(key, key);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_RandomInsert, std::map<std::int64_t, std::int64_t>)
+    ->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_RandomInsert, BTreeMap<std::int64_t, std::int64_t>)
+    ->Apply(sizes);
+
+void BM_BulkLoad(benchmark::State& state) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    auto map = build<BTreeMap<std::int64_t, std::int64_t>>(n);
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BulkLoad)->Apply(sizes);
+
+void BM_OlcPointLookup(benchmark::State& state) {
+  static OlcBTreeMap<std::int64_t, std::int64_t> map;
+  const auto n = static_cast<std::size_t>(state.range(0));
+  if (state.thread_index() == 0 && map.size() != n) {
+    map.clear();
+    for (std::int64_t key : shuffledKeys(n)) {
+      map.insert(key, key);
+    }
+  }
+  std::mt19937_64 rng(static_cast<unsigned>(state.thread_index()));
+  for (auto _ : state) {
+    const auto key = static_cast<std::int64_t>(rng() % n);
+    benchmark::DoNotOptimize(map.find(key));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OlcPointLookup)->Arg(1 << 20)->ThreadRange(1, 8);
+
+}  // namespace
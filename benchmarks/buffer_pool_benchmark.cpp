@@ -0,0 +1,189 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.h"
+
+namespace {
+
+constexpr std::size_t kMessageSize = 1500;
+constexpr std::size_t kHeaderSize = 64;
+constexpr std::size_t kMessages = 20000;
+
+// Кольцо одного производителя и одного потребителя между стадиями.
+template <typename T, std::size_t N = 256>
+class SpscRing {
+ public:
+  void push(T value) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    while (tail - head_.load(std::memory_order_acquire) == N) {
+      std::this_thread::yield();
+    }
+    slots_[tail % N] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  T pop() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    while (tail_.load(std::memory_order_acquire) == head) {
+      std::this_thread::yield();
+    }
+    T value = std::move(slots_[head % N]);
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+ private:
+  std::array<T, N> slots_{};
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+int devNull() {
+  static const int fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  return fd;
+}
+
+void fillMessage(std::byte* out, std::size_t seq) {
+  std::memset(out, static_cast<int>(seq & 0xFF), kMessageSize);
+}
+
+/**
+ * Производитель пишет сообщение в блок пула, разборщик режет его на
+ * заголовок и тело (куски того же блока) и переставляет их в цепочке,
+ * отправитель отдаёт цепочку одним writev. Данные не копируются.
+ */
+void BM_PipelinePooled(benchmark::State& state) {
+  BufferPool pool(kMessageSize);
+  for (auto _ : state) {
+    SpscRing<BufferRef> raw;
+    SpscRing<BufferChain> parsed;
+    std::thread producer([&] {
+      for (std::size_t i = 0; i < kMessages; ++i) {
+        UniqueBufferRef buffer = pool.acquire();
+        fillMessage(buffer.mutableData().data(), i);
+        raw.push(std::move(buffer));
+      }
+    });
+    std::thread parser([&] {
+      for (std::size_t i = 0; i < kMessages; ++i) {
+        const BufferRef message = raw.pop();
+        BufferChain chain;
+        chain.append(message.slice(kHeaderSize));
+        chain.append(message.slice(0, kHeaderSize));
+        parsed.push(std::move(chain));
+      }
+    });
+    for (std::size_t i = 0; i < kMessages; ++i) {
+      BufferChain chain = parsed.pop();
+      benchmark::DoNotOptimize(chain.writeTo(devNull()));
+    }
+    producer.join();
+    parser.join();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kMessages));
+}
+
+// Базовая линия: каждая стадия владеет своей копией байтов.
+void BM_PipelineCopying(benchmark::State& state) {
+  using Bytes = std::vector<std::byte>;
+  for (auto _ : state) {
+    SpscRing<Bytes> raw;
+    SpscRing<std::pair<Bytes, Bytes>> parsed;
+    std::thread producer([&] {
+      for (std::size_t i = 0; i < kMessages; ++i) {
+        Bytes message(kMessageSize);
+        fillMessage(message.data(), i);
+        raw.push(std::move(message));
+      }
+    });
+    std::thread parser([&] {
+      for (std::size_t i = 0; i < kMessages; ++i) {
+        const Bytes message = raw.pop();
+        const auto split = message.begin() + kHeaderSize;
+        parsed.push({Bytes(message.begin(), split),
+                     Bytes(split, message.end())});
+      }
+    });
+    Bytes out;
+    for (std::size_t i = 0; i < kMessages; ++i) {
+      auto [header, body] = parsed.pop();
+      out.assign(body.begin(), body.end());
+      out.insert(out.end(), header.begin(), header.end());
+      benchmark::DoNotOptimize(::write(devNull(), out.data(), out.size()));
+    }
+    producer.join();
+    parser.join();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kMessages));
+}
+
+void BM_BufferPoolAcquireRelease(benchmark::State& state) {
+  BufferPool pool(kMessageSize);
+  for (auto _ : state) {
+    UniqueBufferRef buffer = pool.acquire();
+    benchmark::DoNotOptimize(buffer.mutableData().data());
+  }
+}
+
+void BM_MallocFree(benchmark::State& state) {
+  for (auto _ : state) {
+    void* buffer = std::malloc(kMessageSize);
+    benchmark::DoNotOptimize(buffer);
+    std::free(buffer);
+  }
+}
+
+// Выделение в одном потоке, освобождение в другом.
+template <bool Pooled>
+void BM_CrossThreadRelease(benchmark::State& state) {
+  BufferPool pool(kMessageSize);
+  for (auto _ : state) {
+    SpscRing<std::optional<UniqueBufferRef>> pooled;
+    SpscRing<void*> plain;
+    std::thread consumer([&] {
+      for (std::size_t i = 0; i < kMessages; ++i) {
+        if constexpr (Pooled) {
+          pooled.pop().reset();
+        } else {
+          std::free(plain.pop());
+        }
+      }
+    });
+    for (std::size_t i = 0; i < kMessages; ++i) {
+      if constexpr (Pooled) {
+        pooled.push(pool.acquire());
+      } else {
+        plain.push(std::malloc(kMessageSize));
+      }
+    }
+    consumer.join();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kMessages));
+}
+
+}  // namespace
+
+BENCHMARK(BM_PipelinePooled)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_PipelineCopying)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_BufferPoolAcquireRelease);
+BENCHMARK(BM_MallocFree);
+BENCHMARK_TEMPLATE(BM_CrossThreadRelease, true)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CrossThreadRelease, false)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
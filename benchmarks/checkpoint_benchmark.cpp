@@ -0,0 +1,130 @@
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+
+#include "checkpoint.h"
+
+namespace {
+
+/**
+ * Мир в арене на range(0) МиБ, между чекпоинтами меняется range(1)
+ * промилле страниц. Время бенчмарка - пауза вызывающего потока на
+ * чекпоинт; mutate_ms - цена изменений (под mprotect сюда попадают
+ * SIGSEGV на первых записях), MB_written - объём записи на чекпоинт.
+ */
+struct World {
+  explicit World(const benchmark::State& state, DirtyTracking tracking)
+      : arena(static_cast<std::size_t>(state.range(0)) << 20, tracking),
+        path((std::filesystem::temp_directory_path() /
+              ("checkpoint_benchmark_" + std::to_string(::getpid())))
+                 .string()),
+        dirtyPages(std::max<std::size_t>(
+            1, arena.pageCount() * static_cast<std::size_t>(state.range(1)) /
+                   1000)) {
+    arena.allocate(arena.capacity());
+    for (std::size_t i = 0; i < arena.capacity(); i += arena.pageSize()) {
+      arena.data()[i] = std::byte{1};
+    }
+  }
+  ~World() { std::filesystem::remove(path); }
+
+  double mutate() {
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < dirtyPages; ++i) {
+      const std::size_t page = rng() % arena.pageCount();
+      arena.data()[page * arena.pageSize() + rng() % arena.pageSize()] ^=
+          std::byte{0x5A};
+    }
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  CheckpointArena arena;
+  std::string path;
+  std::size_t dirtyPages;
+  std::mt19937_64 rng{42};
+};
+
+void report(benchmark::State& state, double mutateMs, double bytes) {
+  const auto n = static_cast<double>(state.iterations());
+  state.counters["mutate_ms"] = mutateMs / n;
+  state.counters["MB_written"] = bytes / n / (1024.0 * 1024.0);
+}
+
+double seconds(std::chrono::nanoseconds pause) {
+  return std::chrono::duration<double>(pause).count();
+}
+
+// Базовая линия: каждый чекпоинт сериализует весь мир заново.
+void BM_CheckpointFullSerialize(benchmark::State& state) {
+  World world(state, DirtyTracking::none);
+  double mutateMs = 0.0;
+  double bytes = 0.0;
+  for (auto _ : state) {
+    mutateMs += world.mutate();
+    CheckpointWriter writer(world.arena, world.path);
+    const CheckpointStats stats = writer.checkpointFull();
+    state.SetIterationTime(seconds(stats.pause));
+    bytes += static_cast<double>(stats.bytesWritten);
+  }
+  report(state, mutateMs, bytes);
+}
+
+template <DirtyTracking Tracking>
+void BM_CheckpointDelta(benchmark::State& state) {
+  if (Tracking == DirtyTracking::softDirty &&
+      !CheckpointArena::softDirtySupported()) {
+    state.SkipWithError("kernel does not track soft-dirty bits");
+    return;
+  }
+  World world(state, Tracking);
+  CheckpointWriter writer(world.arena, world.path);
+  writer.checkpointFull();
+  double mutateMs = 0.0;
+  double bytes = 0.0;
+  for (auto _ : state) {
+    mutateMs += world.mutate();
+    const CheckpointStats stats = writer.checkpoint();
+    state.SetIterationTime(seconds(stats.pause));
+    bytes += static_cast<double>(stats.bytesWritten);
+  }
+  report(state, mutateMs, bytes);
+}
+
+// Пауза - только сбор грязных страниц и fork; запись идёт в дочернем.
+void BM_CheckpointBackgroundFork(benchmark::State& state) {
+  World world(state, DirtyTracking::mprotect);
+  CheckpointWriter writer(world.arena, world.path);
+  writer.checkpointFull();
+  double mutateMs = 0.0;
+  double bytes = 0.0;
+  for (auto _ : state) {
+    mutateMs += world.mutate();
+    const CheckpointStats stats = writer.checkpointInBackground();
+    state.SetIterationTime(seconds(stats.pause));
+    bytes += static_cast<double>(stats.bytesWritten);
+    writer.wait();
+  }
+  report(state, mutateMs, bytes);
+}
+
+void worlds(benchmark::internal::Benchmark* b) {
+  b->Args({64, 10})->Args({256, 10})->Args({256, 100});
+  b->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(20);
+}
+
+BENCHMARK(BM_CheckpointFullSerialize)->Apply(worlds);
+BENCHMARK_TEMPLATE(BM_CheckpointDelta, DirtyTracking::mprotect)
+    ->Apply(worlds);
+BENCHMARK_TEMPLATE(BM_CheckpointDelta, DirtyTracking::softDirty)
+    ->Apply(worlds);
+BENCHMARK(BM_CheckpointBackgroundFork)->Apply(worlds);
+
+}  // namespace
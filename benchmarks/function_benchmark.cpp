@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <functional>
+#include <utility>
+
+#include "function.h"
+
+namespace {
+
+// Замыкание на 24 байта: больше, чем локальный буфер std::function в
+// libstdc++ (16 байт), но влезает в InplaceFunction по умолчанию.
+auto makeClosure(long seed) {
+  std::array<long, 3> state{seed, seed + 1, seed + 2};
+  return [state](long x) { return state[0] + state[1] * x + state[2]; };
+}
+
+template <typename Function>
+void BM_Construct(benchmark::State& state) {
+  long seed = 0;
+  for (auto _ : state) {
+    Function f(makeClosure(++seed));
+    benchmark::DoNotOptimize(f);
+  }
+}
+BENCHMARK_TEMPLATE(BM_Construct, std::function<long(long)>);
+BENCHMARK_TEMPLATE(BM_Construct, InplaceFunction<long(long)>);
+BENCHMARK_TEMPLATE(BM_Construct, UniqueFunction<long(long)>);
+#ifdef __cpp_lib_move_only_function
+BENCHMARK_TEMPLATE(BM_Construct, std::move_only_function<long(long)>);
+#endif
+
+template <typename Function>
+void BM_Move(benchmark::State& state) {
+  Function a(makeClosure(1));
+  Function b;
+  for (auto _ : state) {
+    b = std::move(a);
+    a = std::move(b);
+    benchmark::DoNotOptimize(a);
+  }
+}
+BENCHMARK_TEMPLATE(BM_Move, std::function<long(long)>);
+BENCHMARK_TEMPLATE(BM_Move, InplaceFunction<long(long)>);
+BENCHMARK_TEMPLATE(BM_Move, UniqueFunction<long(long)>);
+#ifdef __cpp_lib_move_only_function
+BENCHMARK_TEMPLATE(BM_Move, std::move_only_function<long(long)>);
+#endif
+
+template <typename Function>
+void BM_Invoke(benchmark::State& state) {
+  Function f(makeClosure(1));
+  long x = 0;
+  for (auto _ : state) {
+    x = f(x) & 0xff;
+    benchmark::DoNotOptimize(x);
+  }
+}
+BENCHMARK_TEMPLATE(BM_Invoke, std::function<long(long)>);
+BENCHMARK_TEMPLATE(BM_Invoke, InplaceFunction<long(long)>);
+BENCHMARK_TEMPLATE(BM_Invoke, UniqueFunction<long(long)>);
+#ifdef __cpp_lib_move_only_function
+BENCHMARK_TEMPLATE(BM_Invoke, std::move_only_function<long(long)>);
+#endif
+
+}  // namespace
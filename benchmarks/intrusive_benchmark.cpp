@@ -0,0 +1,230 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <list>
+#include <numeric>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "intrusive.h"
+
+namespace {
+
+struct Object : IntrusiveListHook<>,
+                IntrusiveHashSetHook<>,
+                IntrusiveRBTreeHook<> {
+  explicit Object(int k) : key(k) {}
+  int key;
+  char payload[48] = {};
+};
+
+struct ObjectHash {
+  std::size_t operator()(const Object& o) const noexcept {
+    return std::hash<int>{}(o.key);
+  }
+};
+
+struct ObjectEqual {
+  bool operator()(const Object& a, const Object& b) const noexcept {
+    return a.key == b.key;
+  }
+};
+
+struct ObjectLess {
+  bool operator()(const Object& a, const Object& b) const noexcept {
+    return a.key < b.key;
+  }
+};
+
+std::vector<Object> makeObjects(std::size_t n) {
+  std::vector<int> keys(n);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+  std::vector<Object> objects;
+  objects.reserve(n);
+  for (int k : keys) {
+    objects.emplace_back(k);
+  }
+  return objects;
+}
+
+// ---------------------------------------------------------------------------
+// Список реестра объектов: вставка всех, удаление всех по ссылке.
+
+void BM_IntrusiveList_InsertErase(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  IntrusiveList<Object> list;
+  for (auto _ : state) {
+    for (Object& o : objects) {
+      list.push_back(o);
+    }
+    for (Object& o : objects) {
+      list.erase(o);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IntrusiveList_InsertErase)->Range(1 << 8, 1 << 16);
+
+// std::list<Object*> требует хранить итератор, чтобы удалять за O(1).
+void BM_StdList_InsertErase(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  std::vector<std::list<Object*>::iterator> positions(objects.size());
+  std::list<Object*> list;
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+      positions[i] = list.insert(list.end(), &objects[i]);
+    }
+    for (auto it : positions) {
+      list.erase(it);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdList_InsertErase)->Range(1 << 8, 1 << 16);
+
+void BM_IntrusiveList_Iterate(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  IntrusiveList<Object> list;
+  for (Object& o : objects) {
+    list.push_back(o);
+  }
+  for (auto _ : state) {
+    long sum = 0;
+    for (const Object& o : list) {
+      sum += o.key;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IntrusiveList_Iterate)->Range(1 << 8, 1 << 16);
+
+void BM_StdList_Iterate(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  std::list<Object*> list;
+  for (Object& o : objects) {
+    list.push_back(&o);
+  }
+  for (auto _ : state) {
+    long sum = 0;
+    for (const Object* o : list) {
+      sum += o->key;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdList_Iterate)->Range(1 << 8, 1 << 16);
+
+// ---------------------------------------------------------------------------
+// Упорядоченный индекс.
+
+void BM_IntrusiveRBTree_InsertErase(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  IntrusiveRBTree<Object, IntrusiveBaseHook<Object, IntrusiveRBTreeHook<>>,
+                  ObjectLess>
+      tree;
+  for (auto _ : state) {
+    for (Object& o : objects) {
+      tree.insert(o);
+    }
+    for (Object& o : objects) {
+      tree.erase(o);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IntrusiveRBTree_InsertErase)->Range(1 << 8, 1 << 16);
+
+void BM_StdSet_InsertErase(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  auto less = [](const Object* a, const Object* b) { return a->key < b->key; };
+  std::set<Object*, decltype(less)> set(less);
+  for (auto _ : state) {
+    for (Object& o : objects) {
+      set.insert(&o);
+    }
+    for (Object& o : objects) {
+      set.erase(&o);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdSet_InsertErase)->Range(1 << 8, 1 << 16);
+
+void BM_IntrusiveRBTree_Iterate(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  IntrusiveRBTree<Object, IntrusiveBaseHook<Object, IntrusiveRBTreeHook<>>,
+                  ObjectLess>
+      tree;
+  for (Object& o : objects) {
+    tree.insert(o);
+  }
+  for (auto _ : state) {
+    long sum = 0;
+    for (const Object& o : tree) {
+      sum += o.key;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IntrusiveRBTree_Iterate)->Range(1 << 8, 1 << 16);
+
+void BM_StdSet_Iterate(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  auto less = [](const Object* a, const Object* b) { return a->key < b->key; };
+  std::set<Object*, decltype(less)> set(less);
+  for (Object& o : objects) {
+    set.insert(&o);
+  }
+  for (auto _ : state) {
+    long sum = 0;
+    for (const Object* o : set) {
+      sum += o->key;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdSet_Iterate)->Range(1 << 8, 1 << 16);
+
+// ---------------------------------------------------------------------------
+// Хеш-индекс.
+
+void BM_IntrusiveHashSet_InsertErase(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  IntrusiveHashSet<Object, IntrusiveBaseHook<Object, IntrusiveHashSetHook<>>,
+                   ObjectHash, ObjectEqual>
+      set(objects.size());
+  for (auto _ : state) {
+    for (Object& o : objects) {
+      set.insert(o);
+    }
+    for (Object& o : objects) {
+      set.erase(o);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IntrusiveHashSet_InsertErase)->Range(1 << 8, 1 << 16);
+
+void BM_StdUnorderedSet_InsertErase(benchmark::State& state) {
+  auto objects = makeObjects(static_cast<std::size_t>(state.range(0)));
+  std::unordered_set<Object*> set(objects.size());
+  for (auto _ : state) {
+    for (Object& o : objects) {
+      set.insert(&o);
+    }
+    for (Object& o : objects) {
+      set.erase(&o);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdUnorderedSet_InsertErase)->Range(1 << 8, 1 << 16);
+
+}  // namespace
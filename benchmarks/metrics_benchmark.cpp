@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "metrics.h"
+
+namespace {
+
+/**
+ * Цена обновления метрики под нагрузкой из N потоков, все пишут в одну и
+ * ту же метрику. Базовые линии - один общий atomic (кэш-линия скачет
+ * между ядрами) и счётчик под мьютексом.
+ */
+MetricsRegistry& registry() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+void contention(benchmark::internal::Benchmark* b) {
+  b->ThreadRange(1, 16)->UseRealTime();
+}
+
+void BM_MetricsSharedAtomic(benchmark::State& state) {
+  static std::atomic<std::uint64_t> counter{0};
+  for (auto _ : state) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void BM_MetricsMutexCounter(benchmark::State& state) {
+  static std::mutex mutex;
+  static std::uint64_t counter = 0;
+  for (auto _ : state) {
+    std::lock_guard lock(mutex);
+    benchmark::DoNotOptimize(++counter);
+  }
+}
+
+void BM_MetricsCounterInc(benchmark::State& state) {
+  static const Counter counter = registry().counter("bench_counter");
+  for (auto _ : state) {
+    counter.inc();
+  }
+}
+
+void BM_MetricsGaugeAdd(benchmark::State& state) {
+  static const Gauge gauge = registry().gauge("bench_gauge");
+  for (auto _ : state) {
+    gauge.add(1);
+  }
+}
+
+void BM_MetricsHistogramRecord(benchmark::State& state) {
+  static const Histogram histogram = registry().histogram("bench_histogram");
+  std::uint64_t value = static_cast<std::uint64_t>(state.thread_index()) + 1;
+  for (auto _ : state) {
+    histogram.record(value);
+    value = value * 6364136223846793005u + 1442695040888963407u;
+    value >>= 40;  // разброс по корзинам в пределах 2^24
+  }
+}
+
+// Таймер на ScopeGuard: два чтения steady_clock и запись в гистограмму.
+void BM_MetricsScopedTimer(benchmark::State& state) {
+  static const Histogram histogram = registry().histogram("bench_timer");
+  for (auto _ : state) {
+    METRICS_SCOPED_TIMER(histogram);
+  }
+}
+
+// Сбор снимка всех метрик, как это делает внешний MetricsReader.
+void BM_MetricsSnapshot(benchmark::State& state) {
+  registry().counter("bench_counter");
+  registry().histogram("bench_histogram");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(registry().snapshot());
+  }
+}
+
+BENCHMARK(BM_MetricsSharedAtomic)->Apply(contention);
+BENCHMARK(BM_MetricsMutexCounter)->Apply(contention);
+BENCHMARK(BM_MetricsCounterInc)->Apply(contention);
+BENCHMARK(BM_MetricsGaugeAdd)->Apply(contention);
+BENCHMARK(BM_MetricsHistogramRecord)->Apply(contention);
+BENCHMARK(BM_MetricsScopedTimer)->Apply(contention);
+BENCHMARK(BM_MetricsSnapshot);
+
+}  // namespace
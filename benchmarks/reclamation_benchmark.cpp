@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "lockfree.h"
+#include "reclamation.h"
+
+namespace {
+
+struct Config {
+  explicit Config(long v) : a(v), b(v * 2) {}
+  long a;
+  long b;
+};
+
+// Каждый 1024-й шаг потока 0 - запись (замена объекта), остальное - чтения.
+constexpr long kWriteEvery = 1024;
+
+int maxThreads() {
+  return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+template <typename Domain>
+void BM_ReadMostly(benchmark::State& state) {
+  static Domain domain;
+  static std::atomic<Config*> shared{new Config(0)};
+  long step = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0 && ++step % kWriteEvery == 0) {
+      Config* old = shared.exchange(new Config(step));
+      domain.retire(old);
+      continue;
+    }
+    typename Domain::template Guard<1> guard(domain);
+    const Config* config = guard.protect(shared);
+    benchmark::DoNotOptimize(config->a + config->b);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ReadMostly, EpochDomain)->ThreadRange(1, maxThreads());
+BENCHMARK_TEMPLATE(BM_ReadMostly, HazardPointerDomain)
+    ->ThreadRange(1, maxThreads());
+
+void BM_ReadMostly_SharedMutex(benchmark::State& state) {
+  static std::shared_mutex mutex;
+  static Config* shared = new Config(0);
+  long step = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0 && ++step % kWriteEvery == 0) {
+      std::unique_lock lock(mutex);
+      delete std::exchange(shared, new Config(step));
+      continue;
+    }
+    std::shared_lock lock(mutex);
+    benchmark::DoNotOptimize(shared->a + shared->b);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadMostly_SharedMutex)->ThreadRange(1, maxThreads());
+
+template <typename Domain>
+void BM_TreiberStack_PushPop(benchmark::State& state) {
+  static Domain domain;
+  static TreiberStack<long, Domain> stack(domain);
+  long i = 0;
+  for (auto _ : state) {
+    stack.push(++i);
+    benchmark::DoNotOptimize(stack.pop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_TreiberStack_PushPop, EpochDomain)
+    ->ThreadRange(1, maxThreads());
+BENCHMARK_TEMPLATE(BM_TreiberStack_PushPop, HazardPointerDomain)
+    ->ThreadRange(1, maxThreads());
+
+template <typename Domain>
+void BM_MichaelScottQueue_PushPop(benchmark::State& state) {
+  static Domain domain;
+  static MichaelScottQueue<long, Domain> queue(domain);
+  long i = 0;
+  for (auto _ : state) {
+    queue.push(++i);
+    benchmark::DoNotOptimize(queue.pop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MichaelScottQueue_PushPop, EpochDomain)
+    ->ThreadRange(1, maxThreads());
+BENCHMARK_TEMPLATE(BM_MichaelScottQueue_PushPop, HazardPointerDomain)
+    ->ThreadRange(1, maxThreads());
+
+}  // namespace
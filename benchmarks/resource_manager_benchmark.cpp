@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "resource_manager.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr std::size_t kFiles = 256;
+constexpr std::size_t kFileSize = 64 * 1024;
+
+// Каталог со сгенерированными файлами, общий для всех бенчмарков.
+const fs::path& assets() {
+  struct Directory {
+    Directory()
+        : path(fs::temp_directory_path() /
+               ("resource_benchmark_" + std::to_string(::getpid()))) {
+      fs::create_directories(path);
+      std::string data(kFileSize, 'x');
+      for (std::size_t i = 0; i < kFiles; ++i) {
+        data[0] = static_cast<char>(i);
+        std::ofstream(path / std::to_string(i), std::ios::binary) << data;
+      }
+    }
+    ~Directory() { fs::remove_all(path); }
+    fs::path path;
+  };
+  static const Directory directory;
+  return directory.path;
+}
+
+std::string key(std::size_t i) { return std::to_string(i); }
+
+// Базовая линия: синхронное чтение файла в буфер при каждом обращении.
+void BM_ResourceSyncRead(benchmark::State& state) {
+  std::vector<char> buffer(kFileSize);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const std::string path = (assets() / key(i++ % kFiles)).string();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    benchmark::DoNotOptimize(::read(fd, buffer.data(), buffer.size()));
+    ::close(fd);
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kFileSize));
+}
+
+void BM_ResourceCacheHit(benchmark::State& state) {
+  ResourceManager manager(assets());
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    manager.get(key(i));
+  }
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(manager.get(key(i++ % kFiles)).get());
+  }
+}
+
+// Холодная загрузка всего каталога: range(0) потоков пула.
+void BM_ResourceColdLoadAll(benchmark::State& state) {
+  ResourceManager::Options options;
+  options.workers = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    ResourceManager manager(assets(), options);
+    std::vector<std::shared_future<ResourceHandle>> pending;
+    pending.reserve(kFiles);
+    for (std::size_t i = 0; i < kFiles; ++i) {
+      pending.push_back(manager.load(key(i)));
+    }
+    for (auto& future : pending) {
+      benchmark::DoNotOptimize(future.get().get());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kFiles));
+}
+
+/**
+ * Обращения по закону Ципфа к каталогу, бюджет - range(0) процентов его
+ * объёма. hit_rate и перцентили задержки загрузки - из stats().
+ */
+void BM_ResourceZipfWorkload(benchmark::State& state) {
+  ResourceManager::Options options;
+  options.memoryBudget =
+      kFiles * kFileSize * static_cast<std::size_t>(state.range(0)) / 100;
+  ResourceManager manager(assets(), options);
+  std::vector<double> weights(kFiles);
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    weights[i] = 1.0 / static_cast<double>(i + 1);
+  }
+  std::discrete_distribution<std::size_t> zipf(weights.begin(), weights.end());
+  std::mt19937 rng(7);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(manager.get(key(zipf(rng))).get());
+  }
+  const ResourceStats stats = manager.stats();
+  state.counters["hit_rate"] = stats.hitRate();
+  state.counters["load_p50_us"] =
+      static_cast<double>(stats.loadLatency.percentile(0.5)) / 1000.0;
+  state.counters["load_p99_us"] =
+      static_cast<double>(stats.loadLatency.percentile(0.99)) / 1000.0;
+}
+
+/**
+ * Последовательный проход с подсказкой prefetch на range(0) ключей
+ * вперёд: чем дальше подсказка, тем реже get() ждёт загрузку.
+ */
+void BM_ResourceSequentialPrefetch(benchmark::State& state) {
+  const auto ahead = static_cast<std::size_t>(state.range(0));
+  ResourceManager::Options options;
+  options.memoryBudget = 32 * kFileSize;
+  ResourceManager manager(assets(), options);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    for (std::size_t j = 1; j <= ahead; ++j) {
+      manager.prefetch(key((i + j) % kFiles));
+    }
+    benchmark::DoNotOptimize(manager.get(key(i++ % kFiles)).get());
+  }
+  state.counters["hit_rate"] = manager.stats().hitRate();
+}
+
+BENCHMARK(BM_ResourceSyncRead);
+BENCHMARK(BM_ResourceCacheHit);
+BENCHMARK(BM_ResourceColdLoadAll)
+    ->Arg(1)
+    ->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ResourceZipfWorkload)->Arg(10)->Arg(50)->Arg(100);
+BENCHMARK(BM_ResourceSequentialPrefetch)->Arg(0)->Arg(4)->Arg(16);
+
+}  // namespace
@@ -0,0 +1,193 @@
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "slab_allocator.h"
+
+namespace {
+
+struct GlibcMalloc {
+  static void* allocate(std::size_t size) { return std::malloc(size); }
+  static void deallocate(void* p) { std::free(p); }
+  static void trim() { ::malloc_trim(0); }
+};
+
+struct Slab {
+  static void* allocate(std::size_t size) { return SlabHeap::allocate(size); }
+  static void deallocate(void* p) { SlabHeap::deallocate(p); }
+  static void trim() { SlabHeap::trim(); }
+};
+
+// Выделение и немедленное освобождение пачки объектов одного размера.
+template <typename Heap>
+void BM_AllocFree(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  void* blocks[64];
+  for (auto _ : state) {
+    for (void*& p : blocks) {
+      p = Heap::allocate(size);
+    }
+    benchmark::DoNotOptimize(blocks);
+    for (void* p : blocks) {
+      Heap::deallocate(p);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK_TEMPLATE(BM_AllocFree, GlibcMalloc)
+    ->RangeMultiplier(4)
+    ->Range(16, 4096);
+BENCHMARK_TEMPLATE(BM_AllocFree, Slab)->RangeMultiplier(4)->Range(16, 4096);
+
+// Очередь одного производителя и одного потребителя.
+class PointerRing {
+ public:
+  bool push(void* p) noexcept {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+      return false;
+    }
+    slots_[tail % kCapacity] = p;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(void*& p) noexcept {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    p = slots_[head % kCapacity];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  static constexpr std::size_t kCapacity = 1 << 14;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) void* slots_[kCapacity];
+};
+
+/**
+ * Производитель (поток бенчмарка) выделяет, потребитель освобождает:
+ * каждое освобождение чужое. У glibc это блокировка арены производителя,
+ * у SlabHeap - CAS в remoteFree span'а.
+ */
+template <typename Heap>
+void BM_CrossThreadFree(benchmark::State& state) {
+  constexpr int kBatch = 256;
+  auto ring = std::make_unique<PointerRing>();
+  std::atomic<bool> done{false};
+  std::thread consumer([&] {
+    for (;;) {
+      const bool finished = done.load(std::memory_order_acquire);
+      void* p = nullptr;
+      if (ring->pop(p)) {
+        Heap::deallocate(p);
+      } else if (finished) {
+        break;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  std::minstd_rand rng(1);
+  for (auto _ : state) {
+    for (int i = 0; i < kBatch; ++i) {
+      void* p = Heap::allocate(16 + (rng() & 511));
+      while (!ring->push(p)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  done.store(true, std::memory_order_release);
+  consumer.join();
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK_TEMPLATE(BM_CrossThreadFree, GlibcMalloc)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CrossThreadFree, Slab)->UseRealTime();
+
+double megabytes(std::size_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+/**
+ * Долгоживущая нагрузка: 200k живых объектов, за раунд освобождается
+ * случайная половина и заменяется объектами другого размерного профиля;
+ * в конце выживает 5%. Считается, сколько RSS процесс удерживает ради
+ * этих 5% после trim: разброс выживших по страницам и есть фрагментация.
+ */
+template <typename Heap>
+void BM_Fragmentation(benchmark::State& state) {
+  constexpr std::size_t kLive = 200'000;
+  constexpr int kRounds = 16;
+  std::mt19937 rng(7);
+  double retainedMb = 0.0;
+  double liveMb = 0.0;
+  double fragmentation = 0.0;
+  for (auto _ : state) {
+    Heap::trim();
+    const std::size_t rssBefore = SlabHeap::residentBytes();
+    std::vector<void*> slots(kLive);
+    std::vector<std::size_t> sizes(kLive);
+    auto fill = [&](std::size_t i, int round) {
+      const std::size_t base = std::size_t{16} << (round % 8);
+      sizes[i] = base + rng() % base;
+      slots[i] = Heap::allocate(sizes[i]);
+      std::memset(slots[i], 1, sizes[i]);
+    };
+    for (std::size_t i = 0; i < kLive; ++i) {
+      fill(i, 0);
+    }
+    for (int round = 1; round < kRounds; ++round) {
+      for (std::size_t i = 0; i < kLive; ++i) {
+        if (rng() % 2 == 0) {
+          Heap::deallocate(slots[i]);
+          fill(i, round);
+        }
+      }
+    }
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < kLive; ++i) {
+      if (rng() % 20 != 0) {
+        Heap::deallocate(std::exchange(slots[i], nullptr));
+      } else {
+        live += sizes[i];
+      }
+    }
+    Heap::trim();
+    const std::size_t rssAfter = SlabHeap::residentBytes();
+    retainedMb = megabytes(rssAfter > rssBefore ? rssAfter - rssBefore : 0);
+    liveMb = megabytes(live);
+    if constexpr (std::is_same_v<Heap, Slab>) {
+      fragmentation = SlabHeap::stats().fragmentation();
+    }
+    for (void* p : slots) {
+      Heap::deallocate(p);
+    }
+  }
+  state.counters["live_MB"] = liveMb;
+  state.counters["retained_MB"] = retainedMb;
+  if constexpr (std::is_same_v<Heap, Slab>) {
+    state.counters["fragmentation"] = fragmentation;
+  }
+  state.SetItemsProcessed(state.iterations() * kLive * kRounds);
+}
+BENCHMARK_TEMPLATE(BM_Fragmentation, GlibcMalloc)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(3);
+BENCHMARK_TEMPLATE(BM_Fragmentation, Slab)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(3);
+
+}  // namespace
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "small_vector.h"
+
+namespace {
+
+// Типичная "наша" структура: владеющий указатель плюс немного данных.
+// Помечена как тривиально перемещаемая - unique_ptr не ссылается на себя.
+struct Entity {
+  using IsTriviallyRelocatable = std::true_type;
+  explicit Entity(int i) : mesh(std::make_unique<int>(i)), id(i) {}
+  std::unique_ptr<int> mesh;
+  int id;
+  float transform[6] = {};
+};
+
+template <typename Vector>
+void BM_Growth(benchmark::State& state) {
+  const auto n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    Vector v;
+    for (int i = 0; i < n; ++i) {
+      v.emplace_back(i);
+    }
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Growth, std::vector<Entity>)->Range(1 << 6, 1 << 16);
+BENCHMARK_TEMPLATE(BM_Growth, RelocatingVector<Entity>)
+    ->Range(1 << 6, 1 << 16);
+BENCHMARK_TEMPLATE(BM_Growth, SmallVector<Entity, 16>)->Range(1 << 6, 1 << 16);
+
+// Вставка в середину: каждый раз сдвигается половина элементов.
+template <typename Vector>
+void BM_MiddleInsert(benchmark::State& state) {
+  const auto n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    Vector v;
+    v.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) {
+      v.emplace(v.begin() + v.size() / 2, i);
+    }
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_MiddleInsert, std::vector<Entity>)
+    ->Range(1 << 6, 1 << 13);
+BENCHMARK_TEMPLATE(BM_MiddleInsert, RelocatingVector<Entity>)
+    ->Range(1 << 6, 1 << 13);
+
+template <typename Vector>
+void BM_MiddleErase(benchmark::State& state) {
+  const auto n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    Vector v;
+    for (int i = 0; i < n; ++i) {
+      v.emplace_back(i);
+    }
+    state.ResumeTiming();
+    while (!v.empty()) {
+      v.erase(v.begin() + v.size() / 2);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_MiddleErase, std::vector<Entity>)->Range(1 << 6, 1 << 13);
+BENCHMARK_TEMPLATE(BM_MiddleErase, RelocatingVector<Entity>)
+    ->Range(1 << 6, 1 << 13);
+
+}  // namespace
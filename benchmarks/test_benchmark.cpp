@@ -1,20 +1,31 @@
 #include <benchmark/benchmark.h>
 #include <memory>
 
+#include "slab_allocator.h"
+
 class CustomMemoryManager : public benchmark::MemoryManager {
  public:
   int64_t num_allocs;
   int64_t max_bytes_used;
+  // Прирост живых байт SlabHeap за прогон (SlabAllocator, slab new/delete).
+  int64_t slab_bytes_before;
 
   void Start() override {
     num_allocs = 0;
     max_bytes_used = 0;
+    slab_bytes_before =
+        static_cast<int64_t>(SlabHeap::stats().allocatedBytes);
   }
 
   void Stop(Result& result) override {
     result.num_allocs = num_allocs;
     result.max_bytes_used = max_bytes_used;
+    result.net_heap_growth =
+        static_cast<int64_t>(SlabHeap::stats().allocatedBytes) -
+        slab_bytes_before;
   }
+  // google benchmark < 1.8 объявляет чисто виртуальным только этот вариант.
+  void Stop(Result* result) { Stop(*result); }
 };
 
 std::unique_ptr<CustomMemoryManager> mm(new CustomMemoryManager());
@@ -0,0 +1,209 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "udp.h"
+
+namespace {
+
+constexpr std::size_t kPayload = 64;
+
+/**
+ * Сервер и клиент на loopback. Клиент шлёт пачку датаграмм через
+ * sendmmsg, сервер принимает их выбранным бэкендом и отвечает эхом.
+ * Базовая линия Naive - recvfrom/sendto на каждую датаграмму.
+ */
+struct NaiveTransport {
+  NaiveTransport(UdpSocket& socket, PacketPool& pool, std::size_t)
+      : socket_(socket), pool_(pool) {}
+
+  template <typename Handler>
+  std::size_t receive(Handler&& handler, int timeoutMs = 0) {
+    const std::uint32_t id = pool_.acquire();
+    SCOPE_EXIT { pool_.release(id); };
+    std::size_t count = 0;
+    for (bool waited = false;;) {
+      sockaddr_storage name{};
+      socklen_t size = sizeof(name);
+      const ssize_t n =
+          ::recvfrom(socket_.fd(), pool_.buffer(id), pool_.bufferSize(),
+                     MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&name), &size);
+      if (n >= 0) {
+        ++count;
+        handler(std::span<const std::byte>(pool_.buffer(id),
+                                           static_cast<std::size_t>(n)),
+                SocketAddress(reinterpret_cast<const sockaddr*>(&name), size));
+        continue;
+      }
+      if (count > 0 || waited || timeoutMs == 0) {
+        return count;
+      }
+      pollfd fd{socket_.fd(), POLLIN, 0};
+      ::poll(&fd, 1, timeoutMs);
+      waited = true;
+    }
+  }
+
+  std::size_t send(std::span<const OutPacket> packets) {
+    std::size_t sent = 0;
+    for (const OutPacket& packet : packets) {
+      sent += ::sendto(socket_.fd(), packet.payload.data(),
+                       packet.payload.size(), 0, packet.to->get(),
+                       packet.to->size()) >= 0;
+    }
+    return sent;
+  }
+
+  UdpSocket& socket_;
+  PacketPool& pool_;
+};
+
+template <typename Transport>
+struct Loopback {
+  explicit Loopback(std::size_t batch)
+      : server(SocketAddress::loopback()),
+        client(SocketAddress::loopback()),
+        pool(1024),
+        clientPool(1024),
+        transport(server, pool, batch),
+        clientTransport(client, clientPool, batch),
+        serverAddress(server.localAddress()),
+        payload(kPayload, std::byte{0x42}),
+        packets(batch, OutPacket{payload, &serverAddress}) {
+    server.setBufferSizes(8 << 20);
+    client.setBufferSizes(8 << 20);
+  }
+
+  /**
+   * Клиент шлёт пачку, сервер принимает её целиком. На loopback доставка
+   * идёт в контексте отправителя, поэтому время приёма меряем отдельно.
+   */
+  std::size_t serverReceivesBatch(std::chrono::nanoseconds& elapsed) {
+    clientTransport.send(packets);
+    const auto start = std::chrono::steady_clock::now();
+    SCOPE_EXIT { elapsed = std::chrono::steady_clock::now() - start; };
+    std::size_t received = 0;
+    while (received < packets.size()) {
+      const std::size_t got = transport.receive(
+          [](std::span<const std::byte> data, const SocketAddress&) {
+            benchmark::DoNotOptimize(data.data());
+          },
+          100);
+      if (got == 0) {
+        break;  // датаграммы потерялись в буфере сокета
+      }
+      received += got;
+    }
+    return received;
+  }
+
+  // Клиент шлёт пачку, сервер отвечает эхом, клиент принимает ответы.
+  std::size_t roundTrip() {
+    clientTransport.send(packets);
+    std::size_t echoed = 0;
+    replies.clear();
+    while (echoed < packets.size()) {
+      const std::size_t got = transport.receive(
+          [&](std::span<const std::byte> data, const SocketAddress& from) {
+            replyTo.push_back(from);
+            replies.push_back({data.size() == kPayload ? payload : data,
+                               nullptr});
+          },
+          100);
+      if (got == 0) {
+        break;
+      }
+      echoed += got;
+    }
+    for (std::size_t i = 0; i < replies.size(); ++i) {
+      replies[i].to = &replyTo[i];
+    }
+    transport.send(replies);
+    replyTo.clear();
+    std::size_t back = 0;
+    while (back < echoed) {
+      const std::size_t got = clientTransport.receive(
+          [](std::span<const std::byte>, const SocketAddress&) {}, 100);
+      if (got == 0) {
+        break;
+      }
+      back += got;
+    }
+    return back;
+  }
+
+  UdpSocket server;
+  UdpSocket client;
+  PacketPool pool;
+  PacketPool clientPool;
+  Transport transport;
+  MmsgTransport clientTransport;
+  SocketAddress serverAddress;
+  std::vector<std::byte> payload;
+  std::vector<OutPacket> packets;
+  std::vector<OutPacket> replies;
+  std::vector<SocketAddress> replyTo;
+};
+
+template <typename Transport>
+bool skipUnsupported(benchmark::State& state) {
+  if constexpr (std::is_same_v<Transport, UringTransport>) {
+    if (!UringTransport::supported()) {
+      state.SkipWithError("io_uring is not available");
+      return true;
+    }
+  }
+  return false;
+}
+
+// Пропускная способность приёма: pps - принятые датаграммы в секунду.
+template <typename Transport>
+void BM_UdpReceive(benchmark::State& state) {
+  if (skipUnsupported<Transport>(state)) {
+    return;
+  }
+  Loopback<Transport> loopback(static_cast<std::size_t>(state.range(0)));
+  std::size_t packets = 0;
+  for (auto _ : state) {
+    std::chrono::nanoseconds elapsed{};
+    packets += loopback.serverReceivesBatch(elapsed);
+    state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+  }
+  state.counters["pps"] =
+      benchmark::Counter(static_cast<double>(packets),
+                         benchmark::Counter::kIsRate);
+  state.counters["lost"] = static_cast<double>(
+      static_cast<std::size_t>(state.iterations()) * loopback.packets.size() -
+      packets);
+}
+
+/**
+ * Эхо туда-обратно: время итерации - задержка пачки из range(0)
+ * датаграмм, per_packet - её доля на одну датаграмму.
+ */
+template <typename Transport>
+void BM_UdpEchoLatency(benchmark::State& state) {
+  if (skipUnsupported<Transport>(state)) {
+    return;
+  }
+  Loopback<Transport> loopback(static_cast<std::size_t>(state.range(0)));
+  std::size_t packets = 0;
+  for (auto _ : state) {
+    packets += loopback.roundTrip();
+  }
+  state.counters["per_packet"] = benchmark::Counter(
+      static_cast<double>(packets),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK_TEMPLATE(BM_UdpReceive, NaiveTransport)->Arg(64)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_UdpReceive, MmsgTransport)->Arg(64)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_UdpReceive, UringTransport)->Arg(64)->UseManualTime();
+
+BENCHMARK_TEMPLATE(BM_UdpEchoLatency, NaiveTransport)->Arg(1)->Arg(32);
+BENCHMARK_TEMPLATE(BM_UdpEchoLatency, MmsgTransport)->Arg(1)->Arg(32);
+BENCHMARK_TEMPLATE(BM_UdpEchoLatency, UringTransport)->Arg(1)->Arg(32);
+
+}  // namespace
@@ -0,0 +1,1165 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "scope_guard.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * B+дерево (ABTree из Game Programming Gems 5) - упорядоченные BTreeMap и
+ * BTreeSet с интерфейсом std::map / std::set.
+ *
+ * Узлы занимают NodeBytes байт (по умолчанию 4 кэш-линии) и выровнены по
+ * кэш-линии. Ключи лежат в узле непрерывным массивом, поэтому поиск внутри
+ * узла - линейный подсчёт ключей без ветвлений, который для арифметических
+ * ключей и std::less выполняется SIMD-инструкциями. Листья связаны в
+ * двусвязный список, обход в обе стороны не поднимается по дереву.
+ *
+ * Отличия от std::map: любая вставка или удаление инвалидирует итераторы и
+ * ссылки на элементы (элементы переезжают между узлами); Key должен быть
+ * default-constructible и присваиваемым. Переезд элемента не должен бросать
+ * исключений: иначе сдвиг посреди листа оставил бы дыру. Поэтому Key
+ * создаётся по умолчанию, перемещается и (у BTreeMap, где ключ в
+ * pair<const Key, T> при переезде копируется) копируется noexcept, а T
+ * перемещается noexcept. Тогда вставка, которая бросила, оставляет дерево
+ * прежним, как std::map.
+ * Длинные строки в ключах BTreeMap лучше заменить на целые id или
+ * string_view: ключ там хранится дважды и копируется при каждом сдвиге.
+ */
+
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
+
+namespace privat {
+
+template <typename Key, typename Compare>
+inline constexpr bool kSimdSearchable =
+    std::is_arithmetic_v<Key> &&
+    (std::is_same_v<Compare, std::less<Key>> ||
+     std::is_same_v<Compare, std::less<>>);
+
+/**
+ * Количество ключей, меньших key (OrEqual - не больших key). Ключи в узле
+ * отсортированы, поэтому это и есть lower_bound (upper_bound). Скалярный
+ * вариант без ветвлений компилятор векторизует сам, для int32 (SSE2) и
+ * int64 (AVX2) есть явные версии.
+ */
+template <bool OrEqual, typename Key>
+std::size_t countBelow(const Key* keys, std::size_t n, Key key) noexcept {
+  std::size_t i = 0;
+  std::size_t count = 0;
+#if defined(__SSE2__)
+  if constexpr (std::is_same_v<Key, std::int32_t>) {
+    const __m128i needle = _mm_set1_epi32(key);
+    for (; i + 4 <= n; i += 4) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+      const __m128i hit = OrEqual ? _mm_cmpgt_epi32(v, needle)
+                                  : _mm_cmpgt_epi32(needle, v);
+      const int mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+      const auto bits = static_cast<std::size_t>(__builtin_popcount(
+          static_cast<unsigned>(mask)));
+      count += OrEqual ? 4 - bits : bits;
+    }
+  }
+#endif
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<Key, std::int64_t>) {
+    const __m256i needle = _mm256_set1_epi64x(key);
+    for (; i + 4 <= n; i += 4) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+      const __m256i hit = OrEqual ? _mm256_cmpgt_epi64(v, needle)
+                                  : _mm256_cmpgt_epi64(needle, v);
+      const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(hit));
+      const auto bits = static_cast<std::size_t>(__builtin_popcount(
+          static_cast<unsigned>(mask)));
+      count += OrEqual ? 4 - bits : bits;
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    count += static_cast<std::size_t>(OrEqual ? !(key < keys[i])
+                                              : keys[i] < key);
+  }
+  return count;
+}
+
+template <typename Key, typename T, bool IsMap>
+struct BTreeValue {
+  using type = std::pair<const Key, T>;
+};
+
+template <typename Key, typename T>
+struct BTreeValue<Key, T, false> {
+  using type = Key;
+};
+
+struct BTreeEmpty {};
+
+template <typename Key, typename T, typename Compare, std::size_t NodeBytes,
+          bool IsMap>
+class BTree {
+ public:
+  using key_type = Key;
+  using value_type = typename BTreeValue<Key, T, IsMap>::type;
+  using key_compare = Compare;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+ protected:
+  static_assert(NodeBytes >= 128, "NodeBytes is too small");
+
+  static_assert(std::is_nothrow_default_constructible_v<Key> &&
+                    std::is_nothrow_move_assignable_v<Key>,
+                "Key must be nothrow default-constructible and "
+                "move-assignable");
+  static_assert(!IsMap || (std::is_nothrow_copy_constructible_v<Key> &&
+                           std::is_nothrow_move_constructible_v<T>),
+                "BTreeMap relocates pair<const Key, T>: Key copy and T move "
+                "must not throw");
+
+  static constexpr std::size_t kCacheLine = 64;
+  static constexpr std::size_t kLeafSlotBytes =
+      sizeof(Key) + (IsMap ? sizeof(value_type) : 0);
+
+ public:
+  static constexpr std::size_t kLeafCapacity =
+      std::max<std::size_t>(4, (NodeBytes - 4 * sizeof(void*)) /
+                                   kLeafSlotBytes);
+  static constexpr std::size_t kInnerCapacity = std::max<std::size_t>(
+      4, (NodeBytes - 2 * sizeof(void*)) / (sizeof(Key) + sizeof(void*)));
+
+ protected:
+  // Минимальная заполненность: при слиянии двух минимальных узлов результат
+  // гарантированно помещается в один.
+  static constexpr std::size_t kLeafMin = kLeafCapacity / 2;
+  static constexpr std::size_t kInnerMinChildren = (kInnerCapacity + 1) / 2;
+
+  struct Node {
+    explicit Node(bool isLeaf) noexcept : leaf(isLeaf) {}
+    std::size_t size = 0;
+    const bool leaf;
+  };
+
+  struct SlotArray {
+    alignas(value_type) unsigned char bytes[kLeafCapacity * sizeof(value_type)];
+  };
+
+  struct alignas(kCacheLine) Leaf : Node {
+    Leaf() noexcept : Node(true) {}
+    ~Leaf() {
+      if constexpr (IsMap) {
+        for (std::size_t i = 0; i < this->size; ++i) {
+          std::destroy_at(&slot(i));
+        }
+      }
+    }
+    Leaf(const Leaf&) = delete;
+    Leaf& operator=(const Leaf&) = delete;
+
+    value_type& slot(std::size_t i) noexcept {
+      if constexpr (IsMap) {
+        return *std::launder(
+            reinterpret_cast<value_type*>(slots.bytes) + i);
+      } else {
+        return keys[i];
+      }
+    }
+
+    Leaf* prev = nullptr;
+    Leaf* next = nullptr;
+    Key keys[kLeafCapacity];
+    [[no_unique_address]] std::conditional_t<IsMap, SlotArray, BTreeEmpty>
+        slots;
+  };
+
+  struct alignas(kCacheLine) Inner : Node {
+    Inner() noexcept : Node(false) {}
+    Key keys[kInnerCapacity];
+    Node* children[kInnerCapacity + 1];
+  };
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename BTree::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const || !IsMap, const value_type*,
+                                       value_type*>;
+    using reference = std::conditional_t<Const || !IsMap, const value_type&,
+                                         value_type&>;
+
+    Iterator() noexcept = default;
+    Iterator(const BTree* tree, Leaf* leaf, std::size_t pos) noexcept
+        : tree_(tree), leaf_(leaf), pos_(pos) {}
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other) noexcept
+        : tree_(other.tree_), leaf_(other.leaf_), pos_(other.pos_) {}
+
+    reference operator*() const noexcept { return leaf_->slot(pos_); }
+    pointer operator->() const noexcept { return &leaf_->slot(pos_); }
+
+    Iterator& operator++() noexcept {
+      if (++pos_ == leaf_->size) {
+        leaf_ = leaf_->next;
+        pos_ = 0;
+      }
+      return *this;
+    }
+    Iterator operator++(int) noexcept {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    Iterator& operator--() noexcept {
+      if (!leaf_) {
+        leaf_ = tree_->last_;
+        pos_ = leaf_->size - 1;
+      } else if (pos_ == 0) {
+        leaf_ = leaf_->prev;
+        pos_ = leaf_->size - 1;
+      } else {
+        --pos_;
+      }
+      return *this;
+    }
+    Iterator operator--(int) noexcept {
+      Iterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+
+    friend bool operator==(const Iterator& a, const Iterator& b) noexcept {
+      return a.leaf_ == b.leaf_ && a.pos_ == b.pos_;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b) noexcept {
+      return !(a == b);
+    }
+
+   private:
+    friend class BTree;
+    friend class Iterator<!Const>;
+
+    const BTree* tree_ = nullptr;
+    Leaf* leaf_ = nullptr;
+    std::size_t pos_ = 0;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  BTree() = default;
+  explicit BTree(const Compare& compare) : compare_(compare) {}
+
+  BTree(const BTree& other) : compare_(other.compare_) {
+    bulkLoad(other.begin(), other.size_);
+  }
+
+  BTree(BTree&& other) noexcept
+      : root_(std::exchange(other.root_, nullptr)),
+        first_(std::exchange(other.first_, nullptr)),
+        last_(std::exchange(other.last_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        compare_(std::move(other.compare_)) {}
+
+  BTree& operator=(const BTree& other) {
+    if (this != &other) {
+      BTree copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  BTree& operator=(BTree&& other) noexcept {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+
+  ~BTree() { clear(); }
+
+  iterator begin() noexcept { return iterator(this, first_, 0); }
+  iterator end() noexcept { return iterator(this, nullptr, 0); }
+  const_iterator begin() const noexcept {
+    return const_iterator(this, first_, 0);
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(this, nullptr, 0);
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  key_compare key_comp() const { return compare_; }
+
+  void clear() noexcept {
+    if (root_) {
+      destroy(root_);
+    }
+    root_ = nullptr;
+    first_ = last_ = nullptr;
+    size_ = 0;
+  }
+
+  void swap(BTree& other) noexcept {
+    std::swap(root_, other.root_);
+    std::swap(first_, other.first_);
+    std::swap(last_, other.last_);
+    std::swap(size_, other.size_);
+    std::swap(compare_, other.compare_);
+  }
+
+  iterator lower_bound(const Key& key) {
+    return normalize(findLeaf<false>(key));
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return const_cast<BTree*>(this)->lower_bound(key);
+  }
+  iterator upper_bound(const Key& key) {
+    return normalize(findLeaf<true>(key));
+  }
+  const_iterator upper_bound(const Key& key) const {
+    return const_cast<BTree*>(this)->upper_bound(key);
+  }
+
+  iterator find(const Key& key) {
+    iterator it = lower_bound(key);
+    if (it == end() || compare_(key, it.leaf_->keys[it.pos_])) {
+      return end();
+    }
+    return it;
+  }
+  const_iterator find(const Key& key) const {
+    return const_cast<BTree*>(this)->find(key);
+  }
+
+  bool contains(const Key& key) const { return find(key) != end(); }
+  size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  std::pair<iterator, iterator> equal_range(const Key& key) {
+    iterator first = lower_bound(key);
+    iterator last = first;
+    if (last != end() && !compare_(key, last.leaf_->keys[last.pos_])) {
+      ++last;
+    }
+    return {first, last};
+  }
+
+  size_type erase(const Key& key) {
+    Path path;
+    std::size_t depth = 0;
+    Leaf* leaf = descend(key, path, &depth);
+    if (!leaf) {
+      return 0;
+    }
+    const std::size_t pos = leafLowerBound(leaf, key);
+    if (pos == leaf->size || compare_(key, leaf->keys[pos])) {
+      return 0;
+    }
+    leafErase(leaf, pos);
+    --size_;
+    rebalanceAfterErase(leaf, path, depth);
+    return 1;
+  }
+
+  // Элементы переезжают при ребалансировке, поэтому следующий элемент
+  // ищется заново по удалённому ключу.
+  iterator erase(const_iterator pos) {
+    Key key = pos.leaf_->keys[pos.pos_];
+    erase(key);
+    return lower_bound(key);
+  }
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    if (first == begin() && last == end()) {
+      clear();
+      return end();
+    }
+    if (last == end()) {
+      while (first != end()) {
+        first = erase(first);
+      }
+      return end();
+    }
+    Key stop = last.leaf_->keys[last.pos_];
+    iterator it(this, first.leaf_, first.pos_);
+    while (compare_(it.leaf_->keys[it.pos_], stop)) {
+      it = erase(it);
+    }
+    return it;
+  }
+
+  friend bool operator==(const BTree& a, const BTree& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+  }
+
+  /**
+   * Строит дерево из отсортированного диапазона уникальных ключей за O(n)
+   * без единого сравнения: листья заполняются равномерно и почти целиком.
+   */
+  template <typename InputIt>
+  void assignSorted(InputIt first, InputIt last) {
+    BTree fresh(compare_);
+    fresh.bulkLoad(first,
+                   static_cast<std::size_t>(std::distance(first, last)));
+    swap(fresh);
+  }
+
+  // Проверка инвариантов для тестов: сортировка, заполненность, глубина.
+  bool verify() const {
+    if (!root_) {
+      return size_ == 0 && !first_ && !last_;
+    }
+    std::size_t count = 0;
+    std::size_t leafDepth = 0;
+    const Key* prev = nullptr;
+    if (!verifyNode(root_, nullptr, nullptr, 0, leafDepth, prev, count)) {
+      return false;
+    }
+    return count == size_;
+  }
+
+ protected:
+  // Путь от корня: узел и номер поддерева, в которое спустились.
+  struct PathEntry {
+    Inner* node;
+    std::size_t idx;
+  };
+  using Path = PathEntry[64];
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplaceKey(const Key& key, Args&&... args) {
+    Path path;
+    std::size_t depth = 0;
+    Leaf* leaf = descend(key, path, &depth);
+    std::size_t pos = leaf ? leafLowerBound(leaf, key) : 0;
+    if (leaf && pos < leaf->size && !compare_(key, leaf->keys[pos])) {
+      return {iterator(this, leaf, pos), false};
+    }
+    Pending pending(key, std::forward<Args>(args)...);
+    if (!leaf) {
+      leaf = new Leaf();
+      root_ = first_ = last_ = leaf;
+    }
+    if (leaf->size < kLeafCapacity) {
+      leafInsert(leaf, pos, pending);
+      ++size_;
+      return {iterator(this, leaf, pos), true};
+    }
+
+    // Лист полон: делим его. При добавлении в конец последнего листа
+    // (типичная вставка по возрастанию) левый лист остаётся полным. Узлы и
+    // копия разделителя готовятся до первого изменения: дальше ничего не
+    // бросает, иначе правая половина осталась бы видна только через next.
+    SplitNodes spare;
+    reserveSplit(path, depth, spare);
+    const std::size_t keep =
+        (leaf == last_ && pos == leaf->size) ? leaf->size : leaf->size / 2;
+    Key separator = keep < leaf->size ? leaf->keys[keep] : key;
+    Leaf* right = std::exchange(spare.leaf, nullptr);
+    moveLeafTail(leaf, keep, right);
+    right->next = leaf->next;
+    right->prev = leaf;
+    (leaf->next ? leaf->next->prev : last_) = right;
+    leaf->next = right;
+
+    Leaf* target = leaf;
+    if (pos > leaf->size || (pos == leaf->size && right->size == 0)) {
+      target = right;
+      pos -= leaf->size;
+    }
+    leafInsert(target, pos, pending);
+    ++size_;
+    insertIntoParent(path, depth, std::move(separator), right, spare);
+    return {iterator(this, target, pos), true};
+  }
+
+ private:
+  static void destroy(Node* node) noexcept {
+    if (node->leaf) {
+      delete static_cast<Leaf*>(node);
+      return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for (std::size_t i = 0; i <= inner->size; ++i) {
+      destroy(inner->children[i]);
+    }
+    delete inner;
+  }
+
+  std::size_t leafLowerBound(const Leaf* leaf, const Key& key) const {
+    if constexpr (kSimdSearchable<Key, Compare>) {
+      return countBelow<false>(leaf->keys, leaf->size, key);
+    } else {
+      return static_cast<std::size_t>(
+          std::lower_bound(leaf->keys, leaf->keys + leaf->size, key,
+                           compare_) -
+          leaf->keys);
+    }
+  }
+
+  std::size_t leafUpperBound(const Leaf* leaf, const Key& key) const {
+    if constexpr (kSimdSearchable<Key, Compare>) {
+      return countBelow<true>(leaf->keys, leaf->size, key);
+    } else {
+      return static_cast<std::size_t>(
+          std::upper_bound(leaf->keys, leaf->keys + leaf->size, key,
+                           compare_) -
+          leaf->keys);
+    }
+  }
+
+  // Номер поддерева: ключи, равные разделителю, лежат справа от него.
+  std::size_t childIndex(const Inner* inner, const Key& key) const {
+    if constexpr (kSimdSearchable<Key, Compare>) {
+      return countBelow<true>(inner->keys, inner->size, key);
+    } else {
+      return static_cast<std::size_t>(
+          std::upper_bound(inner->keys, inner->keys + inner->size, key,
+                           compare_) -
+          inner->keys);
+    }
+  }
+
+  Leaf* descend(const Key& key, Path& path,
+                std::size_t* depthOut = nullptr) const {
+    std::size_t depth = 0;
+    Node* node = root_;
+    if (!node) {
+      return nullptr;
+    }
+    while (!node->leaf) {
+      Inner* inner = static_cast<Inner*>(node);
+      const std::size_t idx = childIndex(inner, key);
+      path[depth++] = {inner, idx};
+      node = inner->children[idx];
+    }
+    if (depthOut) {
+      *depthOut = depth;
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  template <bool Upper>
+  iterator findLeaf(const Key& key) {
+    Node* node = root_;
+    if (!node) {
+      return end();
+    }
+    while (!node->leaf) {
+      Inner* inner = static_cast<Inner*>(node);
+      node = inner->children[childIndex(inner, key)];
+    }
+    Leaf* leaf = static_cast<Leaf*>(node);
+    return iterator(this, leaf,
+                    Upper ? leafUpperBound(leaf, key)
+                          : leafLowerBound(leaf, key));
+  }
+
+  // Позиция за последним элементом листа - это начало следующего листа.
+  iterator normalize(iterator it) const noexcept {
+    if (it.leaf_ && it.pos_ == it.leaf_->size) {
+      it.leaf_ = it.leaf_->next;
+      it.pos_ = 0;
+    }
+    return it;
+  }
+
+  /**
+   * Новый элемент, построенный до любых изменений дерева: если копия ключа
+   * или конструктор значения бросят исключение, дерево останется прежним.
+   * Дальше элемент только перемещается, как и при перестройке узлов.
+   */
+  struct Pending {
+    template <typename... Args>
+    explicit Pending(const Key& k, Args&&... args)
+        : key(k), value(makeValue(k, std::forward<Args>(args)...)) {}
+
+    template <typename... Args>
+    static auto makeValue(const Key& k, Args&&... args) {
+      if constexpr (IsMap) {
+        return value_type(std::piecewise_construct, std::forward_as_tuple(k),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+      } else {
+        return BTreeEmpty{};
+      }
+    }
+
+    Key key;
+    std::conditional_t<IsMap, value_type, BTreeEmpty> value;
+  };
+
+  // Переносит элемент листа from[i] в to[j] (в to[j] элемента ещё нет).
+  static void relocateSlot(Leaf* from, std::size_t i, Leaf* to,
+                           std::size_t j) {
+    to->keys[j] = std::move(from->keys[i]);
+    if constexpr (IsMap) {
+      ::new (static_cast<void*>(&to->slot(j)))
+          value_type(std::move(from->slot(i)));
+      std::destroy_at(&from->slot(i));
+    }
+  }
+
+  static void leafInsert(Leaf* leaf, std::size_t pos, Pending& pending) {
+    for (std::size_t i = leaf->size; i > pos; --i) {
+      relocateSlot(leaf, i - 1, leaf, i);
+    }
+    leaf->keys[pos] = std::move(pending.key);
+    if constexpr (IsMap) {
+      ::new (static_cast<void*>(&leaf->slot(pos)))
+          value_type(std::move(pending.value));
+    }
+    ++leaf->size;
+  }
+
+  static void leafErase(Leaf* leaf, std::size_t pos) {
+    if constexpr (IsMap) {
+      std::destroy_at(&leaf->slot(pos));
+    }
+    for (std::size_t i = pos + 1; i < leaf->size; ++i) {
+      relocateSlot(leaf, i, leaf, i - 1);
+    }
+    --leaf->size;
+  }
+
+  // Переносит элементы leaf начиная с keep в начало пустого листа right.
+  static void moveLeafTail(Leaf* leaf, std::size_t keep, Leaf* right) {
+    for (std::size_t i = keep; i < leaf->size; ++i) {
+      relocateSlot(leaf, i, right, right->size++);
+    }
+    leaf->size = keep;
+  }
+
+  // Узлы для одного разделения листа: новый лист, по внутреннему узлу на
+  // каждый полный уровень пути и новый корень, если полны все уровни.
+  struct SplitNodes {
+    SplitNodes() = default;
+    SplitNodes(const SplitNodes&) = delete;
+    SplitNodes& operator=(const SplitNodes&) = delete;
+    ~SplitNodes() {
+      delete leaf;
+      for (std::size_t i = 0; i < count; ++i) {
+        delete inners[i];
+      }
+    }
+
+    Inner* takeInner() noexcept { return inners[--count]; }
+
+    Leaf* leaf = nullptr;
+    Inner* inners[std::extent_v<Path> + 1] = {};
+    std::size_t count = 0;
+  };
+
+  static void reserveSplit(const Path& path, std::size_t depth,
+                           SplitNodes& spare) {
+    spare.leaf = new Leaf();
+    while (depth > 0 && path[depth - 1].node->size == kInnerCapacity) {
+      spare.inners[spare.count++] = new Inner();
+      --depth;
+    }
+    if (depth == 0) {
+      spare.inners[spare.count++] = new Inner();
+    }
+  }
+
+  void insertIntoParent(Path& path, std::size_t depth, Key separator,
+                        Node* right, SplitNodes& spare) noexcept {
+    while (depth > 0) {
+      auto [parent, idx] = path[--depth];
+      if (parent->size < kInnerCapacity) {
+        for (std::size_t i = parent->size; i > idx; --i) {
+          parent->keys[i] = std::move(parent->keys[i - 1]);
+          parent->children[i + 1] = parent->children[i];
+        }
+        parent->keys[idx] = std::move(separator);
+        parent->children[idx + 1] = right;
+        ++parent->size;
+        return;
+      }
+
+      // Делим переполненный внутренний узел: средний ключ уходит наверх.
+      Key keys[kInnerCapacity + 1];
+      Node* children[kInnerCapacity + 2];
+      for (std::size_t i = 0, j = 0; i <= kInnerCapacity; ++i) {
+        keys[i] = std::move(i == idx ? separator : parent->keys[j++]);
+      }
+      for (std::size_t i = 0, j = 0; i <= kInnerCapacity + 1; ++i) {
+        children[i] = i == idx + 1 ? right : parent->children[j++];
+      }
+      const std::size_t mid = (kInnerCapacity + 1) / 2;
+      Inner* sibling = spare.takeInner();
+      parent->size = mid;
+      for (std::size_t i = 0; i < mid; ++i) {
+        parent->keys[i] = std::move(keys[i]);
+        parent->children[i] = children[i];
+      }
+      parent->children[mid] = children[mid];
+      sibling->size = kInnerCapacity - mid;
+      for (std::size_t i = 0; i < sibling->size; ++i) {
+        sibling->keys[i] = std::move(keys[mid + 1 + i]);
+        sibling->children[i] = children[mid + 1 + i];
+      }
+      sibling->children[sibling->size] = children[kInnerCapacity + 1];
+      separator = std::move(keys[mid]);
+      right = sibling;
+    }
+
+    Inner* root = spare.takeInner();
+    root->size = 1;
+    root->keys[0] = std::move(separator);
+    root->children[0] = root_;
+    root->children[1] = right;
+    root_ = root;
+  }
+
+  void unlinkLeaf(Leaf* leaf) noexcept {
+    (leaf->prev ? leaf->prev->next : first_) = leaf->next;
+    (leaf->next ? leaf->next->prev : last_) = leaf->prev;
+  }
+
+  static void innerRemove(Inner* inner, std::size_t keyIdx) {
+    for (std::size_t i = keyIdx; i + 1 < inner->size; ++i) {
+      inner->keys[i] = std::move(inner->keys[i + 1]);
+      inner->children[i + 1] = inner->children[i + 2];
+    }
+    --inner->size;
+  }
+
+  void rebalanceAfterErase(Leaf* leaf, Path& path, std::size_t depth) {
+    if (depth == 0) {
+      if (leaf->size == 0) {
+        delete leaf;
+        root_ = nullptr;
+        first_ = last_ = nullptr;
+      }
+      return;
+    }
+    if (leaf->size >= kLeafMin) {
+      return;
+    }
+
+    auto [parent, idx] = path[depth - 1];
+    Leaf* left = idx > 0 ? static_cast<Leaf*>(parent->children[idx - 1])
+                         : nullptr;
+    Leaf* right = idx < parent->size
+                      ? static_cast<Leaf*>(parent->children[idx + 1])
+                      : nullptr;
+    if (left && left->size > kLeafMin) {
+      for (std::size_t i = leaf->size; i > 0; --i) {
+        relocateSlot(leaf, i - 1, leaf, i);
+      }
+      relocateSlot(left, --left->size, leaf, 0);
+      ++leaf->size;
+      parent->keys[idx - 1] = leaf->keys[0];
+      return;
+    }
+    if (right && right->size > kLeafMin) {
+      relocateSlot(right, 0, leaf, leaf->size++);
+      for (std::size_t i = 1; i < right->size; ++i) {
+        relocateSlot(right, i, right, i - 1);
+      }
+      --right->size;
+      parent->keys[idx] = right->keys[0];
+      return;
+    }
+    if (left) {
+      moveLeafTail(leaf, 0, left);
+      unlinkLeaf(leaf);
+      delete leaf;
+      innerRemove(parent, idx - 1);
+    } else {
+      moveLeafTail(right, 0, leaf);
+      unlinkLeaf(right);
+      delete right;
+      innerRemove(parent, idx);
+    }
+    rebalanceInner(path, depth - 1);
+  }
+
+  void rebalanceInner(Path& path, std::size_t depth) {
+    while (true) {
+      Inner* node = path[depth].node;
+      if (depth == 0) {
+        if (node->size == 0) {
+          root_ = node->children[0];
+          delete node;
+        }
+        return;
+      }
+      if (node->size + 1 >= kInnerMinChildren) {
+        return;
+      }
+      auto [parent, idx] = path[depth - 1];
+      Inner* left = idx > 0 ? static_cast<Inner*>(parent->children[idx - 1])
+                            : nullptr;
+      Inner* right = idx < parent->size
+                         ? static_cast<Inner*>(parent->children[idx + 1])
+                         : nullptr;
+      if (left && left->size + 1 > kInnerMinChildren) {
+        // Поворот вправо через разделитель родителя.
+        for (std::size_t i = node->size; i > 0; --i) {
+          node->keys[i] = std::move(node->keys[i - 1]);
+        }
+        for (std::size_t i = node->size + 1; i > 0; --i) {
+          node->children[i] = node->children[i - 1];
+        }
+        node->keys[0] = std::move(parent->keys[idx - 1]);
+        node->children[0] = left->children[left->size];
+        ++node->size;
+        parent->keys[idx - 1] = std::move(left->keys[left->size - 1]);
+        --left->size;
+        return;
+      }
+      if (right && right->size + 1 > kInnerMinChildren) {
+        node->keys[node->size] = std::move(parent->keys[idx]);
+        node->children[node->size + 1] = right->children[0];
+        ++node->size;
+        parent->keys[idx] = std::move(right->keys[0]);
+        for (std::size_t i = 0; i + 1 < right->size; ++i) {
+          right->keys[i] = std::move(right->keys[i + 1]);
+        }
+        for (std::size_t i = 0; i < right->size; ++i) {
+          right->children[i] = right->children[i + 1];
+        }
+        --right->size;
+        return;
+      }
+      if (left) {
+        mergeInner(left, std::move(parent->keys[idx - 1]), node);
+        innerRemove(parent, idx - 1);
+      } else {
+        mergeInner(node, std::move(parent->keys[idx]), right);
+        innerRemove(parent, idx);
+      }
+      --depth;
+    }
+  }
+
+  // Дописывает separator и содержимое right в left и удаляет right.
+  static void mergeInner(Inner* left, Key separator, Inner* right) {
+    left->keys[left->size] = std::move(separator);
+    for (std::size_t i = 0; i < right->size; ++i) {
+      left->keys[left->size + 1 + i] = std::move(right->keys[i]);
+    }
+    for (std::size_t i = 0; i <= right->size; ++i) {
+      left->children[left->size + 1 + i] = right->children[i];
+    }
+    left->size += right->size + 1;
+    delete right;
+  }
+
+  /**
+   * Равномерно раскладывает count элементов по листьям, затем строит
+   * внутренние уровни снизу вверх тем же способом. Равномерное деление
+   * гарантирует минимальную заполненность каждого узла.
+   */
+  template <typename InputIt>
+  void bulkLoad(InputIt first, std::size_t count) {
+    clear();
+    if (count == 0) {
+      return;
+    }
+    struct Built {
+      Node* node;
+      const Key* minKey;
+    };
+    std::unique_ptr<Built[]> level(
+        new Built[(count + kLeafCapacity - 1) / kLeafCapacity]);
+    std::size_t nodes = (count + kLeafCapacity - 1) / kLeafCapacity;
+    std::size_t innerCount = 0;
+    for (std::size_t n = nodes; n > 1;) {
+      n = (n + kInnerCapacity) / (kInnerCapacity + 1);
+      innerCount += n;
+    }
+    // root_ появляется только в конце: до этого построенное держат цепочка
+    // листьев и inners, их и освобождаем, если копия элемента или new
+    // бросили (в конструкторе копирования деструктор не вызовется).
+    std::unique_ptr<Inner*[]> inners(new Inner*[innerCount]);
+    std::size_t innersMade = 0;
+    SCOPE_FAIL {
+      for (Leaf* leaf = first_; leaf;) {
+        delete std::exchange(leaf, leaf->next);
+      }
+      first_ = last_ = nullptr;
+      size_ = 0;
+      for (std::size_t i = 0; i < innersMade; ++i) {
+        delete inners[i];
+      }
+    };
+    [[maybe_unused]] const Key* prev = nullptr;
+    for (std::size_t n = 0, done = 0; n < nodes; ++n) {
+      const std::size_t take = (count - done) / (nodes - n);
+      Leaf* leaf = new Leaf();
+      leaf->prev = last_;
+      (last_ ? last_->next : first_) = leaf;
+      last_ = leaf;
+      for (std::size_t i = 0; i < take; ++i, ++first) {
+        decltype(auto) item = *first;
+        if constexpr (IsMap) {
+          leaf->keys[i] = item.first;
+          ::new (static_cast<void*>(&leaf->slot(i))) value_type(item);
+        } else {
+          leaf->keys[i] = item;
+        }
+        ++leaf->size;
+        assert(!prev || compare_(*prev, leaf->keys[i]));
+        prev = &leaf->keys[i];
+      }
+      done += take;
+      level[n] = {leaf, &leaf->keys[0]};
+    }
+    size_ = count;
+
+    while (nodes > 1) {
+      const std::size_t parents =
+          (nodes + kInnerCapacity) / (kInnerCapacity + 1);
+      for (std::size_t p = 0, done = 0; p < parents; ++p) {
+        const std::size_t take = (nodes - done) / (parents - p);
+        Inner* inner = new Inner();
+        inners[innersMade++] = inner;
+        for (std::size_t i = 0; i < take; ++i) {
+          inner->children[i] = level[done + i].node;
+          if (i > 0) {
+            inner->keys[i - 1] = *level[done + i].minKey;
+          }
+        }
+        inner->size = take - 1;
+        level[p] = {inner, level[done].minKey};
+        done += take;
+      }
+      nodes = parents;
+    }
+    root_ = level[0].node;
+  }
+
+  bool verifyNode(const Node* node, const Key* low, const Key* high,
+                  std::size_t depth, std::size_t& leafDepth,
+                  const Key*& prev, std::size_t& count) const {
+    if (node->leaf) {
+      const Leaf* leaf = static_cast<const Leaf*>(node);
+      if (leafDepth == 0) {
+        leafDepth = depth + 1;
+      } else if (leafDepth != depth + 1) {
+        return false;
+      }
+      // Недозаполненным может быть только последний лист - после деления
+      // при вставке по возрастанию, - но не пустым.
+      if (node != root_ && (leaf->size == 0 ||
+                            (leaf != last_ && leaf->size < kLeafMin))) {
+        return false;
+      }
+      for (std::size_t i = 0; i < leaf->size; ++i) {
+        const Key& key = leaf->keys[i];
+        if ((prev && !compare_(*prev, key)) || (low && compare_(key, *low)) ||
+            (high && !compare_(key, *high))) {
+          return false;
+        }
+        prev = &key;
+      }
+      count += leaf->size;
+      return true;
+    }
+    const Inner* inner = static_cast<const Inner*>(node);
+    if (node != root_ ? inner->size + 1 < kInnerMinChildren
+                      : inner->size == 0) {
+      return false;
+    }
+    for (std::size_t i = 0; i <= inner->size; ++i) {
+      const Key* childLow = i == 0 ? low : &inner->keys[i - 1];
+      const Key* childHigh = i == inner->size ? high : &inner->keys[i];
+      if (!verifyNode(inner->children[i], childLow, childHigh, depth + 1,
+                      leafDepth, prev, count)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ protected:
+  Node* root_ = nullptr;
+  Leaf* first_ = nullptr;
+  Leaf* last_ = nullptr;
+  std::size_t size_ = 0;
+  [[no_unique_address]] Compare compare_{};
+};
+
+}  // namespace privat
+
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          std::size_t NodeBytes = 256>
+class BTreeMap
+    : public privat::BTree<Key, T, Compare, NodeBytes, /*IsMap=*/true> {
+  using Base = privat::BTree<Key, T, Compare, NodeBytes, true>;
+
+ public:
+  using mapped_type = T;
+  using typename Base::const_iterator;
+  using typename Base::iterator;
+  using typename Base::key_type;
+  using typename Base::value_type;
+
+  BTreeMap() = default;
+  explicit BTreeMap(const Compare& compare) : Base(compare) {}
+
+  template <typename InputIt>
+  BTreeMap(InputIt first, InputIt last, const Compare& compare = Compare())
+      : Base(compare) {
+    insert(first, last);
+  }
+
+  BTreeMap(std::initializer_list<value_type> values,
+           const Compare& compare = Compare())
+      : BTreeMap(values.begin(), values.end(), compare) {}
+
+  // Диапазон уже отсортирован и без повторов: O(n) bulk-load.
+  template <typename InputIt>
+  BTreeMap(sorted_unique_t, InputIt first, InputIt last,
+           const Compare& compare = Compare())
+      : Base(compare) {
+    this->assignSorted(first, last);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+    return this->emplaceKey(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    return this->emplaceKey(value.first, std::move(value.second));
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return this->emplaceKey(value.first, value.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return this->emplaceKey(value.first, std::move(value.second));
+  }
+
+  template <typename P,
+            typename = std::enable_if_t<std::is_constructible_v<value_type, P>>>
+  std::pair<iterator, bool> insert(P&& value) {
+    return emplace(std::forward<P>(value));
+  }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> values) {
+    insert(values.begin(), values.end());
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const Key& key, M&& mapped) {
+    auto result = this->emplaceKey(key, std::forward<M>(mapped));
+    if (!result.second) {
+      result.first->second = std::forward<M>(mapped);
+    }
+    return result;
+  }
+
+  T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+  T& at(const Key& key) {
+    iterator it = this->find(key);
+    if (it == this->end()) {
+      throw std::out_of_range("BTreeMap::at");
+    }
+    return it->second;
+  }
+
+  const T& at(const Key& key) const {
+    return const_cast<BTreeMap*>(this)->at(key);
+  }
+};
+
+template <typename Key, typename Compare = std::less<Key>,
+          std::size_t NodeBytes = 256>
+class BTreeSet
+    : public privat::BTree<Key, void, Compare, NodeBytes, /*IsMap=*/false> {
+  using Base = privat::BTree<Key, void, Compare, NodeBytes, false>;
+
+ public:
+  using typename Base::const_iterator;
+  using typename Base::iterator;
+  using typename Base::value_type;
+
+  BTreeSet() = default;
+  explicit BTreeSet(const Compare& compare) : Base(compare) {}
+
+  template <typename InputIt>
+  BTreeSet(InputIt first, InputIt last, const Compare& compare = Compare())
+      : Base(compare) {
+    insert(first, last);
+  }
+
+  BTreeSet(std::initializer_list<Key> keys, const Compare& compare = Compare())
+      : BTreeSet(keys.begin(), keys.end(), compare) {}
+
+  template <typename InputIt>
+  BTreeSet(sorted_unique_t, InputIt first, InputIt last,
+           const Compare& compare = Compare())
+      : Base(compare) {
+    this->assignSorted(first, last);
+  }
+
+  std::pair<iterator, bool> insert(const Key& key) {
+    return this->emplaceKey(key);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return this->emplaceKey(Key(std::forward<Args>(args)...));
+  }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+};
@@ -0,0 +1,535 @@
+#pragma once
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <utility>
+
+#include "core.h"
+#include "posix_error.h"
+#include "reclamation.h"
+#include "small_vector.h"
+
+/**
+ * Пул буферов фиксированного размера (gems1: buffer pool) и счётные
+ * ссылки на их куски.
+ *
+ * Блоки нарезаются из чанков, которые живут до разрушения пула, поэтому
+ * общий список свободных блоков - стек Трайбера по индексам со счётчиком
+ * версий в том же 64-битном слове (от ABA), без домена освобождения. Перед
+ * ним - кэш потока (threadLocalFor из reclamation.h): выделение и возврат
+ * обычно не трогают общих атомиков, а со стеком поток обменивается
+ * пачками.
+ *
+ * UniqueBufferRef - единственная, только перемещаемая ссылка на весь
+ * свежий блок: через неё блок заполняют. share() превращает её в
+ * BufferRef - копируемую ссылку на неизменяемые байты, от которой можно
+ * брать под-куски без копирования. Блок возвращается в пул, когда
+ * исчезает последняя ссылка на любой его кусок, в каком бы потоке это ни
+ * случилось. BufferChain собирает куски в список для writev.
+ *
+ * Пул должен пережить все свои ссылки. Блоки из кэшей завершённых потоков
+ * возвращаются в общий стек. Кэши потоков ссылаются на состояние пула
+ * через weak_ptr, поэтому деструктор пула сразу освобождает все чанки,
+ * включая блоки в кэшах ещё живых потоков.
+ */
+
+class BufferPool;
+
+namespace privat {
+
+struct alignas(64) BufferBlock {
+  std::atomic<std::uint32_t> refs{0};
+  std::atomic<std::uint32_t> next{0};  // индекс + 1 в стеке, 0 - конец
+  std::uint32_t index = 0;
+  BufferPool* pool = nullptr;
+
+  std::byte* data() noexcept {
+    return reinterpret_cast<std::byte*>(this) + sizeof(BufferBlock);
+  }
+};
+
+struct BufferPoolState : UncopyableUnmovable {
+  static constexpr std::uint32_t kCacheSize = 64;
+
+  struct Local {
+    std::atomic<bool> inUse_{false};
+    Local* next_ = nullptr;
+    std::uint32_t count = 0;
+    BufferBlock* blocks[kCacheSize];
+    // Пишет только свой поток, поэтому без RMW; stats() их складывает.
+    std::atomic<std::uint64_t> acquired{0};
+    std::atomic<std::uint64_t> released{0};
+
+    static void bump(std::atomic<std::uint64_t>& counter) noexcept {
+      counter.store(counter.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    }
+  };
+
+  BufferPoolState(std::size_t blockSize, std::uint32_t blocksPerChunk,
+                  std::uint32_t maxChunks)
+      : blockSize(blockSize),
+        stride(sizeof(BufferBlock) +
+               (blockSize + alignof(BufferBlock) - 1) / alignof(BufferBlock) *
+                   alignof(BufferBlock)),
+        blocksPerChunk(blocksPerChunk),
+        maxChunks(maxChunks),
+        chunks(new std::atomic<std::byte*>[maxChunks]) {
+    for (std::uint32_t i = 0; i < maxChunks; ++i) {
+      chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~BufferPoolState() {
+    for (std::uint32_t i = 0; i < chunkCount; ++i) {
+      ::operator delete(chunks[i].load(std::memory_order_relaxed),
+                        std::align_val_t{alignof(BufferBlock)});
+    }
+  }
+
+  Local* acquireLocal() { return locals.acquire(); }
+
+  void releaseLocal(Local* local) {
+    pushChain(local->blocks, local->count);
+    local->count = 0;
+    RecordList<Local>::release(local);
+  }
+
+  BufferBlock* block(std::uint32_t index) const noexcept {
+    std::byte* chunk =
+        chunks[index / blocksPerChunk].load(std::memory_order_acquire);
+    return reinterpret_cast<BufferBlock*>(
+        chunk + std::size_t{index % blocksPerChunk} * stride);
+  }
+
+  // Связывает blocks[0..count) в цепочку и кладёт её в стек одним CAS.
+  void pushChain(BufferBlock* const* blocks, std::uint32_t count) noexcept {
+    if (count == 0) {
+      return;
+    }
+    for (std::uint32_t i = 0; i + 1 < count; ++i) {
+      blocks[i]->next.store(blocks[i + 1]->index + 1,
+                            std::memory_order_relaxed);
+    }
+    pushLinked(blocks[0], blocks[count - 1]);
+  }
+
+  // first..last уже связаны через next.
+  void pushLinked(BufferBlock* first, BufferBlock* last) noexcept {
+    std::uint64_t head = freeHead.load(std::memory_order_relaxed);
+    std::uint64_t desired = 0;
+    do {
+      last->next.store(static_cast<std::uint32_t>(head),
+                       std::memory_order_relaxed);
+      desired = nextVersion(head) + first->index + 1;
+    } while (!freeHead.compare_exchange_weak(head, desired,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+  }
+
+  static std::uint64_t nextVersion(std::uint64_t head) noexcept {
+    return (head & ~std::uint64_t{0xFFFFFFFF}) + (std::uint64_t{1} << 32);
+  }
+
+  BufferBlock* pop() noexcept {
+    std::uint64_t head = freeHead.load(std::memory_order_acquire);
+    for (;;) {
+      const auto top = static_cast<std::uint32_t>(head);
+      if (top == 0) {
+        return nullptr;
+      }
+      BufferBlock* block = this->block(top - 1);
+      // next может оказаться устаревшим, если блок уже сняли и вернули:
+      // тогда версия в head изменилась и CAS не пройдёт.
+      const std::uint32_t next = block->next.load(std::memory_order_relaxed);
+      const std::uint64_t desired = nextVersion(head) + next;
+      if (freeHead.compare_exchange_weak(head, desired,
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+        return block;
+      }
+    }
+  }
+
+  // Новый чанк: первый блок - вызывающему, остальные - в стек.
+  BufferBlock* grow(BufferPool* owner) {
+    std::lock_guard lock(growMutex);
+    if (BufferBlock* block = pop()) {
+      return block;  // пока ждали мьютекс, другой поток уже вырастил пул
+    }
+    if (chunkCount == maxChunks) {
+      return nullptr;
+    }
+    auto* chunk = static_cast<std::byte*>(
+        ::operator new(stride * blocksPerChunk,
+                       std::align_val_t{alignof(BufferBlock)}));
+    const std::uint32_t first = chunkCount * blocksPerChunk;
+    for (std::uint32_t i = 0; i < blocksPerChunk; ++i) {
+      auto* block = new (chunk + std::size_t{i} * stride) BufferBlock;
+      block->index = first + i;
+      block->pool = owner;
+      block->next.store(i + 1 < blocksPerChunk ? first + i + 2 : 0,
+                        std::memory_order_relaxed);
+    }
+    chunks[chunkCount].store(chunk, std::memory_order_release);
+    ++chunkCount;
+    totalBlocks.fetch_add(blocksPerChunk, std::memory_order_relaxed);
+    if (blocksPerChunk > 1) {
+      pushLinked(block(first + 1), block(first + blocksPerChunk - 1));
+    }
+    return block(first);
+  }
+
+  const std::size_t blockSize;
+  const std::size_t stride;
+  const std::uint32_t blocksPerChunk;
+  const std::uint32_t maxChunks;
+  // Старшие 32 бита - версия, младшие - индекс вершины + 1.
+  alignas(64) std::atomic<std::uint64_t> freeHead{0};
+  alignas(64) std::atomic<std::size_t> totalBlocks{0};
+  std::unique_ptr<std::atomic<std::byte*>[]> chunks;
+  std::uint32_t chunkCount = 0;  // под growMutex
+  std::mutex growMutex;
+  RecordList<Local> locals;
+};
+
+/**
+ * Общая часть ссылок: копирование увеличивает счётчик блока. Разрешено ли
+ * оно у конкретной ссылки, решает база EnableCopyMove в BasicBufferRef.
+ */
+class BufferRefBase {
+ public:
+  BufferRefBase() noexcept = default;
+  BufferRefBase(const BufferRefBase& other) noexcept
+      : block_(other.block_), data_(other.data_), size_(other.size_) {
+    if (block_) {
+      block_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  BufferRefBase(BufferRefBase&& other) noexcept
+      : block_(std::exchange(other.block_, nullptr)),
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  BufferRefBase& operator=(BufferRefBase other) noexcept {
+    swap(other);
+    return *this;
+  }
+  ~BufferRefBase() { reset(); }
+
+  inline void reset() noexcept;
+
+  std::span<const std::byte> data() const noexcept { return {data_, size_}; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  explicit operator bool() const noexcept { return block_ != nullptr; }
+
+  // Сколько ссылок на блок (на любые его куски) сейчас живо.
+  std::uint32_t useCount() const noexcept {
+    return block_ ? block_->refs.load(std::memory_order_acquire) : 0;
+  }
+
+  void removePrefix(std::size_t n) noexcept {
+    assert(n <= size_);
+    data_ += n;
+    size_ -= n;
+  }
+  void removeSuffix(std::size_t n) noexcept {
+    assert(n <= size_);
+    size_ -= n;
+  }
+
+  void swap(BufferRefBase& other) noexcept {
+    std::swap(block_, other.block_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+ protected:
+  BufferRefBase(BufferBlock* block, std::byte* data, std::size_t size) noexcept
+      : block_(block), data_(data), size_(size) {}
+
+  BufferBlock* block_ = nullptr;
+  std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace privat
+
+template <bool Shared>
+class BasicBufferRef;
+
+// Единственная ссылка на свежий блок: запись, потом share().
+using UniqueBufferRef = BasicBufferRef<false>;
+// Разделяемая ссылка на неизменяемый кусок блока.
+using BufferRef = BasicBufferRef<true>;
+
+template <bool Shared>
+class BasicBufferRef : public privat::BufferRefBase,
+                       private EnableCopyMove<Shared, true> {
+ public:
+  static constexpr std::size_t npos = ~std::size_t{0};
+
+  BasicBufferRef() noexcept = default;
+
+  // Уникальная ссылка превращается в разделяемую без копирования. Шаблон,
+  // чтобы у BasicBufferRef<false> это не считалось конструктором перемещения.
+  template <bool OtherShared>
+    requires(Shared && !OtherShared)
+  BasicBufferRef(BasicBufferRef<OtherShared>&& unique) noexcept
+      : BufferRefBase(std::move(unique)) {}
+
+  // Кусок [offset, offset + length) с той же жизнью блока.
+  BasicBufferRef slice(std::size_t offset,
+                       std::size_t length = npos) const& noexcept
+    requires Shared
+  {
+    BasicBufferRef result(*this);
+    result.narrow(offset, length);
+    return result;
+  }
+  BasicBufferRef slice(std::size_t offset,
+                       std::size_t length = npos) && noexcept {
+    BasicBufferRef result(std::move(*this));
+    result.narrow(offset, length);
+    return result;
+  }
+
+  // Запись доступна только единственному владельцу.
+  std::span<std::byte> mutableData() noexcept
+    requires(!Shared)
+  {
+    return {data_, size_};
+  }
+
+  BufferRef share() && noexcept
+    requires(!Shared)
+  {
+    return BufferRef(std::move(*this));
+  }
+
+ private:
+  friend class BufferPool;
+  template <bool>
+  friend class BasicBufferRef;
+
+  using BufferRefBase::BufferRefBase;
+
+  void narrow(std::size_t offset, std::size_t length) noexcept {
+    assert(offset <= size_);
+    data_ += offset;
+    size_ = std::min(size_ - offset, length);
+  }
+};
+
+class BufferPool : private UncopyableUnmovable {
+ public:
+  struct Stats {
+    std::size_t totalBlocks;
+    std::size_t liveBlocks;  // выданы и ещё не вернулись
+  };
+
+  /**
+   * blockSize - ёмкость блока, память растёт чанками по blocksPerChunk
+   * блоков, но не больше maxBlocks.
+   */
+  explicit BufferPool(std::size_t blockSize, std::uint32_t blocksPerChunk = 256,
+                      std::size_t maxBlocks = std::size_t{1} << 20)
+      : state_(std::make_shared<privat::BufferPoolState>(
+            blockSize, std::max<std::uint32_t>(blocksPerChunk, 1),
+            static_cast<std::uint32_t>(std::max<std::size_t>(
+                1, std::min<std::size_t>(maxBlocks, UINT32_MAX - 1) /
+                       std::max<std::uint32_t>(blocksPerChunk, 1))))) {}
+
+  ~BufferPool() {
+    assert(stats().liveBlocks == 0 && "buffers outlive their pool");
+  }
+
+  // Пустая ссылка, если пул исчерпан.
+  UniqueBufferRef tryAcquire() {
+    Local& local = privat::threadLocalFor(state_);
+    privat::BufferBlock* block = nullptr;
+    if (local.count > 0) {
+      block = local.blocks[--local.count];
+    } else {
+      block = refill(local);
+      if (!block) {
+        return {};
+      }
+    }
+    block->refs.store(1, std::memory_order_relaxed);
+    Local::bump(local.acquired);
+    return UniqueBufferRef(block, block->data(), state_->blockSize);
+  }
+
+  UniqueBufferRef acquire() {
+    UniqueBufferRef buffer = tryAcquire();
+    if (!buffer) {
+      throw std::bad_alloc();
+    }
+    return buffer;
+  }
+
+  std::size_t blockSize() const noexcept { return state_->blockSize; }
+
+  // Приблизительно, пока другие потоки берут и возвращают блоки.
+  Stats stats() const noexcept {
+    std::uint64_t acquired = 0;
+    std::uint64_t released = 0;
+    for (Local* local = state_->locals.head(); local; local = local->next_) {
+      acquired += local->acquired.load(std::memory_order_relaxed);
+      released += local->released.load(std::memory_order_relaxed);
+    }
+    return {state_->totalBlocks.load(std::memory_order_relaxed),
+            static_cast<std::size_t>(acquired - released)};
+  }
+
+ private:
+  friend class privat::BufferRefBase;
+  using Local = privat::BufferPoolState::Local;
+
+  // Половина кэша из общего стека; если там пусто - новый чанк.
+  privat::BufferBlock* refill(Local& local) {
+    while (local.count < privat::BufferPoolState::kCacheSize / 2) {
+      privat::BufferBlock* block = state_->pop();
+      if (!block) {
+        break;
+      }
+      local.blocks[local.count++] = block;
+    }
+    if (local.count > 0) {
+      return local.blocks[--local.count];
+    }
+    return state_->grow(this);
+  }
+
+  void release(privat::BufferBlock* block) noexcept {
+    Local& local = privat::threadLocalFor(state_);
+    Local::bump(local.released);
+    if (local.count == privat::BufferPoolState::kCacheSize) {
+      // Кэш полон: старшая половина уходит в общий стек одной цепочкой.
+      constexpr std::uint32_t kHalf = privat::BufferPoolState::kCacheSize / 2;
+      state_->pushChain(local.blocks + kHalf, kHalf);
+      local.count = kHalf;
+    }
+    local.blocks[local.count++] = block;
+  }
+
+  std::shared_ptr<privat::BufferPoolState> state_;
+};
+
+inline void privat::BufferRefBase::reset() noexcept {
+  if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    block_->pool->release(block_);
+  }
+  block_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+/**
+ * Список кусков для scatter/gather-вывода: writev без склейки в один
+ * буфер. Сами байты не копируются, куски держатся ссылками.
+ */
+class BufferChain {
+ public:
+  void append(BufferRef buffer) {
+    if (!buffer.empty()) {
+      bytes_ += buffer.size();
+      parts_.push_back(std::move(buffer));
+    }
+  }
+  void append(BufferChain&& other) {
+    for (BufferRef& part : other.parts_) {
+      append(std::move(part));
+    }
+    other.clear();
+  }
+
+  std::size_t size() const noexcept { return bytes_; }
+  bool empty() const noexcept { return bytes_ == 0; }
+  std::size_t partCount() const noexcept { return parts_.size(); }
+  const BufferRef& part(std::size_t i) const noexcept { return parts_[i]; }
+
+  void clear() noexcept {
+    parts_.clear();
+    bytes_ = 0;
+  }
+
+  // Отбрасывает n байт с начала (например, уже записанные writev).
+  void consume(std::size_t n) noexcept {
+    assert(n <= bytes_);
+    bytes_ -= n;
+    std::size_t drop = 0;
+    while (n > 0 && n >= parts_[drop].size()) {
+      n -= parts_[drop++].size();
+    }
+    if (n > 0) {
+      parts_[drop].removePrefix(n);
+    }
+    parts_.erase(parts_.begin(),
+                 parts_.begin() + static_cast<std::ptrdiff_t>(drop));
+  }
+
+  // Копия содержимого подряд в out (для отладки и проверок).
+  std::size_t copyTo(std::span<std::byte> out) const noexcept {
+    std::size_t copied = 0;
+    for (const BufferRef& part : parts_) {
+      const std::size_t n = std::min(part.size(), out.size() - copied);
+      std::memcpy(out.data() + copied, part.data().data(), n);
+      copied += n;
+    }
+    return copied;
+  }
+
+  // iovec'и кусков; живут, пока цепочка не меняется.
+  template <std::size_t N>
+  void toIovecs(SmallVector<iovec, N>& out) const {
+    out.clear();
+    out.reserve(parts_.size());
+    for (const BufferRef& part : parts_) {
+      out.push_back({const_cast<std::byte*>(part.data().data()), part.size()});
+    }
+  }
+
+  /**
+   * Пишет цепочку в fd через writev (по IOV_MAX кусков за вызов) и
+   * отбрасывает записанное. Возвращает число записанных байт; на
+   * неблокирующем fd останавливается на EAGAIN.
+   */
+  std::size_t writeTo(int fd) {
+    std::size_t written = 0;
+    SmallVector<iovec, 16> iov;
+    while (!empty()) {
+      toIovecs(iov);
+      const auto count =
+          static_cast<int>(std::min<std::size_t>(iov.size(), IOV_MAX));
+      const ssize_t n = ::writev(fd, iov.data(), count);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          break;
+        }
+        privat::throwErrno("writev");
+      }
+      consume(static_cast<std::size_t>(n));
+      written += static_cast<std::size_t>(n);
+    }
+    return written;
+  }
+
+ private:
+  SmallVector<BufferRef, 8> parts_;
+  std::size_t bytes_ = 0;
+};
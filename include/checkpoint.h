@@ -0,0 +1,774 @@
+#pragma once
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+#include "posix_error.h"
+#include "scope_guard.h"
+
+/**
+ * Инкрементальные чекпоинты состояния (Game Programming Gems 3: "save me",
+ * "journaling services").
+ *
+ * Состояние живёт в CheckpointArena - непрерывном mmap-регионе, который
+ * сохраняется постранично. Арена помнит, какие страницы менялись после
+ * предыдущего чекпоинта:
+ *  - DirtyTracking::mprotect - страницы защищены от записи, первая запись
+ *    ловится SIGSEGV-обработчиком, страница помечается и открывается;
+ *  - DirtyTracking::softDirty - биты soft-dirty ядра из /proc/self/pagemap
+ *    (нужен CONFIG_MEM_SOFT_DIRTY; сбрасываются сразу для всего процесса,
+ *    поэтому такая арена в процессе может быть только одна);
+ *  - DirtyTracking::none - грязным считается всё, полный снимок.
+ *
+ * CheckpointWriter дописывает в файл по записи на чекпоинт: только грязные
+ * страницы, с контрольной суммой. Заголовок записи пишется последним, так
+ * что оборванная запись при восстановлении просто отбрасывается.
+ * checkpointInBackground() делает fork(): дочерний процесс пишет страницы
+ * из своей copy-on-write копии, а родитель продолжает работу сразу после
+ * fork. replayCheckpoints() накатывает записи файла на пустую арену.
+ *
+ * Арена хранится побайтно, поэтому в ней лежат только тривиально
+ * копируемые объекты, а ссылки между ними - смещения (offsetOf/at): при
+ * восстановлении арена может оказаться по другому адресу. Чекпоинт и
+ * resetDirty() вызываются в точке, где состояние никто не меняет. Системные
+ * вызовы не должны писать в арену напрямую под mprotect-отслеживанием -
+ * ядро вернёт EFAULT вместо SIGSEGV. Только Linux.
+ */
+
+enum class DirtyTracking { none, mprotect, softDirty };
+
+class CheckpointArena;
+
+inline std::uint64_t replayCheckpoints(
+    const std::string& path, CheckpointArena& arena,
+    std::uint64_t upTo = std::numeric_limits<std::uint64_t>::max());
+
+namespace privat {
+
+inline std::size_t systemPageSize() noexcept {
+  static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+inline constexpr std::uint64_t kFnvOffset = 14695981039346656037ull;
+
+inline std::uint64_t fnv1a(std::uint64_t hash, const void* data,
+                           std::size_t size) noexcept {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Арены с mprotect-отслеживанием, которые просматривает обработчик SIGSEGV.
+inline constexpr std::size_t kMaxTrackedArenas = 64;
+inline std::atomic<CheckpointArena*> trackedArenas[kMaxTrackedArenas];
+inline struct sigaction previousSegvAction;
+
+void onSegv(int sig, siginfo_t* info, void* context);
+
+inline void installSegvHandler() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    struct sigaction action {};
+    action.sa_sigaction = &onSegv;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (::sigaction(SIGSEGV, &action, &previousSegvAction) != 0) {
+      throwErrno("sigaction");
+    }
+  });
+}
+
+// pwrite целиком; async-signal-safe, годится для дочернего процесса.
+inline bool writeAll(int fd, const void* data, std::size_t size,
+                     std::uint64_t offset) noexcept {
+  const auto* bytes = static_cast<const char*>(data);
+  while (size != 0) {
+    const ssize_t written =
+        ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= static_cast<std::size_t>(written);
+    offset += static_cast<std::uint64_t>(written);
+  }
+  return true;
+}
+
+inline bool readAll(int fd, void* data, std::size_t size,
+                    std::uint64_t offset) noexcept {
+  auto* bytes = static_cast<char*>(data);
+  while (size != 0) {
+    const ssize_t read = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+    if (read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read <= 0) {
+      return false;
+    }
+    bytes += read;
+    size -= static_cast<std::size_t>(read);
+    offset += static_cast<std::uint64_t>(read);
+  }
+  return true;
+}
+
+struct CheckpointFileHeader {
+  char magic[8];
+  std::uint32_t pageSize;
+  std::uint32_t reserved;
+  std::uint64_t capacity;
+};
+
+inline constexpr char kCheckpointMagic[8] = {'E', 'S', 'C', 'K', 'P', 'T',
+                                             '0', '1'};
+inline constexpr std::uint32_t kRecordMagic = 0x41544c44;  // "DLTA"
+
+/**
+ * Запись: заголовок, номера страниц (uint32, по возрастанию), страницы.
+ * checksum - FNV-1a от заголовка с нулевым checksum, номеров и страниц.
+ */
+struct CheckpointRecordHeader {
+  std::uint32_t magic;
+  std::uint32_t pageCount;
+  std::uint64_t sequence;
+  std::uint64_t used;
+  std::uint64_t checksum;
+};
+
+}  // namespace privat
+
+class CheckpointArena : private UncopyableUnmovable {
+ public:
+  CheckpointArena(std::size_t capacity, DirtyTracking tracking)
+      : pageSize_(privat::systemPageSize()),
+        capacity_((capacity + pageSize_ - 1) / pageSize_ * pageSize_),
+        tracking_(tracking) {
+    if (capacity_ == 0 ||
+        capacity_ / pageSize_ > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("CheckpointArena: bad capacity");
+    }
+    if (tracking_ == DirtyTracking::softDirty) {
+      if (!softDirtySupported()) {
+        throw std::system_error(ENOTSUP, std::generic_category(),
+                                "soft-dirty page tracking");
+      }
+      if (softDirtyArena().exchange(true)) {
+        throw std::logic_error("only one soft-dirty CheckpointArena");
+      }
+    }
+    SCOPE_FAIL {
+      if (tracking_ == DirtyTracking::softDirty) {
+        softDirtyArena().store(false);
+      }
+    };
+    void* data = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) {
+      privat::throwErrno("mmap");
+    }
+    data_ = static_cast<std::byte*>(data);
+    SCOPE_FAIL { ::munmap(data_, capacity_); };
+    SCOPE_FAIL {
+      if (pagemapFd_ >= 0) {
+        ::close(pagemapFd_);
+      }
+    };
+    if (tracking_ == DirtyTracking::mprotect) {
+      dirty_ = std::make_unique<std::atomic<std::uint8_t>[]>(pageCount());
+      privat::installSegvHandler();
+      // Первый resetDirty() защищает арену целиком.
+      overflow_.store(true, std::memory_order_relaxed);
+    } else if (tracking_ == DirtyTracking::softDirty) {
+      pagemapFd_ = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+      if (pagemapFd_ < 0) {
+        privat::throwErrno("open /proc/self/pagemap");
+      }
+    }
+    resetDirty();
+    if (tracking_ == DirtyTracking::mprotect) {
+      registerForFaults();
+    }
+  }
+
+  ~CheckpointArena() {
+    if (tracking_ == DirtyTracking::mprotect) {
+      privat::trackedArenas[slot_].store(nullptr, std::memory_order_release);
+    } else if (tracking_ == DirtyTracking::softDirty) {
+      ::close(pagemapFd_);
+      softDirtyArena().store(false);
+    }
+    ::munmap(data_, capacity_);
+  }
+
+  // Проверяет, что ядро действительно ведёт биты soft-dirty.
+  static bool softDirtySupported() noexcept {
+    static const bool supported = [] {
+      const std::size_t page = privat::systemPageSize();
+      void* p = ::mmap(nullptr, page, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+        return false;
+      }
+      SCOPE_EXIT { ::munmap(p, page); };
+      static_cast<volatile char*>(p)[0] = 1;
+      if (!clearSoftDirty()) {
+        return false;
+      }
+      static_cast<volatile char*>(p)[0] = 2;
+      const int fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        return false;
+      }
+      SCOPE_EXIT { ::close(fd); };
+      std::uint64_t entry = 0;
+      return privat::readAll(fd, &entry, sizeof(entry),
+                             reinterpret_cast<std::uintptr_t>(p) / page *
+                                 sizeof(entry)) &&
+             (entry >> 55 & 1) != 0;
+    }();
+    return supported;
+  }
+
+  void* allocate(std::size_t size,
+                 std::size_t align = alignof(std::max_align_t)) {
+    const std::size_t offset = (used_ + align - 1) & ~(align - 1);
+    if (offset > capacity_ || size > capacity_ - offset) {
+      throw std::bad_alloc();
+    }
+    used_ = offset + size;
+    return data_ + offset;
+  }
+
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "arena state is saved and restored byte-wise");
+    return ::new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  std::size_t offsetOf(const void* p) const noexcept {
+    return static_cast<std::size_t>(static_cast<const std::byte*>(p) - data_);
+  }
+  template <typename T>
+  T* at(std::size_t offset) const noexcept {
+    return std::launder(reinterpret_cast<T*>(data_ + offset));
+  }
+
+  std::byte* data() const noexcept { return data_; }
+  std::size_t capacity() const noexcept { return capacity_; }
+  std::size_t used() const noexcept { return used_; }
+  std::size_t pageSize() const noexcept { return pageSize_; }
+  std::size_t pageCount() const noexcept { return capacity_ / pageSize_; }
+  std::size_t usedPages() const noexcept {
+    return (used_ + pageSize_ - 1) / pageSize_;
+  }
+  DirtyTracking tracking() const noexcept { return tracking_; }
+
+  // Страницы (из занятых), изменённые после resetDirty(), по возрастанию.
+  std::vector<std::uint32_t> dirtyPages() const {
+    std::vector<std::uint32_t> pages;
+    const std::size_t count = usedPages();
+    if (tracking_ == DirtyTracking::none ||
+        (tracking_ == DirtyTracking::mprotect &&
+         overflow_.load(std::memory_order_relaxed))) {
+      pages.resize(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        pages[i] = static_cast<std::uint32_t>(i);
+      }
+    } else if (tracking_ == DirtyTracking::mprotect) {
+      for (std::size_t i = 0; i < count; ++i) {
+        if (dirty_[i].load(std::memory_order_relaxed)) {
+          pages.push_back(static_cast<std::uint32_t>(i));
+        }
+      }
+    } else {
+      constexpr std::size_t kBatch = 512;
+      std::uint64_t entries[kBatch];
+      const std::uint64_t first =
+          reinterpret_cast<std::uintptr_t>(data_) / pageSize_;
+      for (std::size_t i = 0; i < count; i += kBatch) {
+        const std::size_t n = std::min(kBatch, count - i);
+        if (!privat::readAll(pagemapFd_, entries, n * sizeof(std::uint64_t),
+                             (first + i) * sizeof(std::uint64_t))) {
+          privat::throwErrno("read /proc/self/pagemap");
+        }
+        for (std::size_t j = 0; j < n; ++j) {
+          if (entries[j] >> 55 & 1) {
+            pages.push_back(static_cast<std::uint32_t>(i + j));
+          }
+        }
+      }
+    }
+    return pages;
+  }
+
+  // Начинает новую эпоху: все страницы снова считаются чистыми.
+  void resetDirty() {
+    if (tracking_ == DirtyTracking::mprotect) {
+      if (overflow_.load(std::memory_order_relaxed)) {
+        for (std::size_t i = 0; i < pageCount(); ++i) {
+          dirty_[i].store(0, std::memory_order_relaxed);
+        }
+        protect(0, pageCount());
+        overflow_.store(false, std::memory_order_relaxed);
+        return;
+      }
+      // Закрываем грязные участки по одному, но если их много, один
+      // mprotect на всю арену дешевле сотен системных вызовов.
+      constexpr std::size_t kMaxProtectRuns = 64;
+      std::pair<std::size_t, std::size_t> runs[kMaxProtectRuns];
+      std::size_t runCount = 0;
+      bool wholeArena = false;
+      const std::size_t count = pageCount();
+      for (std::size_t i = 0; i < count;) {
+        if (!dirty_[i].load(std::memory_order_relaxed)) {
+          ++i;
+          continue;
+        }
+        std::size_t end = i;
+        for (; end < count && dirty_[end].load(std::memory_order_relaxed);
+             ++end) {
+          dirty_[end].store(0, std::memory_order_relaxed);
+        }
+        if (runCount < kMaxProtectRuns) {
+          runs[runCount++] = {i, end};
+        } else {
+          wholeArena = true;
+        }
+        i = end;
+      }
+      if (wholeArena) {
+        protect(0, count);
+      } else {
+        for (std::size_t i = 0; i < runCount; ++i) {
+          protect(runs[i].first, runs[i].second);
+        }
+      }
+    } else if (tracking_ == DirtyTracking::softDirty) {
+      if (!clearSoftDirty()) {
+        privat::throwErrno("write /proc/self/clear_refs");
+      }
+    }
+  }
+
+  // Обнуляет арену (перед восстановлением). Грязным считается всё.
+  void clear() {
+    if (tracking_ == DirtyTracking::mprotect) {
+      overflow_.store(true, std::memory_order_relaxed);
+      if (::mprotect(data_, capacity_, PROT_READ | PROT_WRITE) != 0) {
+        privat::throwErrno("mprotect");
+      }
+    }
+    ::madvise(data_, capacity_, MADV_DONTNEED);
+    used_ = 0;
+  }
+
+ private:
+  friend void privat::onSegv(int, siginfo_t*, void*);
+  friend std::uint64_t replayCheckpoints(const std::string&,
+                                         CheckpointArena&, std::uint64_t);
+
+  static std::atomic<bool>& softDirtyArena() noexcept {
+    static std::atomic<bool> exists{false};
+    return exists;
+  }
+
+  static bool clearSoftDirty() noexcept {
+    const int fd = ::open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    const bool ok = ::write(fd, "4", 1) == 1;
+    ::close(fd);
+    return ok;
+  }
+
+  void registerForFaults() {
+    for (std::size_t i = 0; i < privat::kMaxTrackedArenas; ++i) {
+      CheckpointArena* expected = nullptr;
+      if (privat::trackedArenas[i].compare_exchange_strong(
+              expected, this, std::memory_order_release)) {
+        slot_ = i;
+        return;
+      }
+    }
+    throw std::length_error("too many mprotect-tracked CheckpointArenas");
+  }
+
+  void protect(std::size_t firstPage, std::size_t endPage) {
+    if (::mprotect(data_ + firstPage * pageSize_,
+                   (endPage - firstPage) * pageSize_, PROT_READ) != 0) {
+      privat::throwErrno("mprotect");
+    }
+  }
+
+  // Вызывается из обработчика SIGSEGV.
+  bool onWriteFault(const void* address) noexcept {
+    const auto* p = static_cast<const std::byte*>(address);
+    if (p < data_ || p >= data_ + capacity_) {
+      return false;
+    }
+    const auto page = static_cast<std::size_t>(p - data_) / pageSize_;
+    dirty_[page].store(1, std::memory_order_relaxed);
+    if (::mprotect(data_ + page * pageSize_, pageSize_,
+                   PROT_READ | PROT_WRITE) == 0) {
+      return true;
+    }
+    // Каждая открытая страница - отдельный VMA; когда их лимит исчерпан,
+    // открываем арену целиком, а эпоха считается грязной полностью.
+    overflow_.store(true, std::memory_order_relaxed);
+    return ::mprotect(data_, capacity_, PROT_READ | PROT_WRITE) == 0;
+  }
+
+  std::size_t pageSize_;
+  std::size_t capacity_;
+  DirtyTracking tracking_;
+  std::byte* data_ = nullptr;
+  std::size_t used_ = 0;
+  std::unique_ptr<std::atomic<std::uint8_t>[]> dirty_;
+  std::atomic<bool> overflow_{false};
+  std::size_t slot_ = 0;
+  int pagemapFd_ = -1;
+};
+
+inline void privat::onSegv(int sig, siginfo_t* info, void* context) {
+  for (auto& slot : trackedArenas) {
+    CheckpointArena* arena = slot.load(std::memory_order_acquire);
+    if (arena && arena->onWriteFault(info->si_addr)) {
+      return;
+    }
+  }
+  // Чужой SIGSEGV: отдаём предыдущему обработчику, а если его нет -
+  // повторная попытка инструкции упадёт с действием по умолчанию.
+  const struct sigaction& previous = previousSegvAction;
+  if (previous.sa_flags & SA_SIGINFO) {
+    previous.sa_sigaction(sig, info, context);
+  } else if (previous.sa_handler != SIG_DFL &&
+             previous.sa_handler != SIG_IGN) {
+    previous.sa_handler(sig);
+  } else {
+    ::signal(sig, SIG_DFL);
+  }
+}
+
+struct CheckpointStats {
+  std::uint64_t sequence = 0;
+  std::size_t pages = 0;
+  std::size_t bytesWritten = 0;
+  // Сколько стоял вызывающий поток (для фонового режима - до fork).
+  std::chrono::nanoseconds pause{0};
+};
+
+class CheckpointWriter : private UncopyableUnmovable {
+ public:
+  // Создаёт (обрезает) файл чекпоинтов для арены.
+  CheckpointWriter(CheckpointArena& arena, const std::string& path)
+      : arena_(arena) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+      privat::throwErrno("open checkpoint file");
+    }
+    SCOPE_FAIL { ::close(fd_); };
+    privat::CheckpointFileHeader header{};
+    std::memcpy(header.magic, privat::kCheckpointMagic, sizeof(header.magic));
+    header.pageSize = static_cast<std::uint32_t>(arena.pageSize());
+    header.capacity = arena.capacity();
+    if (!privat::writeAll(fd_, &header, sizeof(header), 0)) {
+      privat::throwErrno("write checkpoint header");
+    }
+    offset_ = sizeof(header);
+  }
+
+  ~CheckpointWriter() {
+    try {
+      wait();
+    } catch (...) {
+    }
+    ::close(fd_);
+  }
+
+  // Синхронно пишет изменённые страницы; после сбоя записи - все.
+  CheckpointStats checkpoint() {
+    wait();
+    const auto start = std::chrono::steady_clock::now();
+    Record record = prepare(needsFull_ ? allPages() : arena_.dirtyPages());
+    if (!writeRecord(fd_, arena_, record)) {
+      privat::throwErrno("write checkpoint");
+    }
+    arena_.resetDirty();
+    return commit(record, start);
+  }
+
+  // Полный снимок всех занятых страниц (базовая линия, компактификация).
+  CheckpointStats checkpointFull() {
+    wait();
+    const auto start = std::chrono::steady_clock::now();
+    Record record = prepare(allPages());
+    if (!writeRecord(fd_, arena_, record)) {
+      privat::throwErrno("write checkpoint");
+    }
+    arena_.resetDirty();
+    return commit(record, start);
+  }
+
+  /**
+   * Пишет изменённые страницы из fork-копии процесса. Возвращает сразу
+   * после fork; ошибку дочернего процесса сообщит следующий wait(), а
+   * следующий чекпоинт тогда будет полным.
+   */
+  CheckpointStats checkpointInBackground() {
+    wait();
+    const auto start = std::chrono::steady_clock::now();
+    Record record = prepare(needsFull_ ? allPages() : arena_.dirtyPages());
+    // Защита до fork: открытые страницы - это тысячи отдельных VMA, и
+    // fork копировал бы каждую. Дочерний процесс арену только читает.
+    arena_.resetDirty();
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      needsFull_ = true;
+      privat::throwErrno("fork");
+    }
+    if (pid == 0) {
+      // Дочерний процесс: только async-signal-safe вызовы.
+      ::_exit(writeRecord(fd_, arena_, record) ? 0 : 1);
+    }
+    child_ = pid;
+    pendingOffset_ = record.offset;
+    return commit(record, start);
+  }
+
+  // Дожидается фонового чекпоинта; бросает, если он не записался.
+  void wait() {
+    if (child_ < 0) {
+      return;
+    }
+    int status = 0;
+    pid_t result = 0;
+    do {
+      result = ::waitpid(child_, &status, 0);
+    } while (result < 0 && errno == EINTR);
+    child_ = -1;
+    if (result < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      offset_ = pendingOffset_;
+      --sequence_;
+      needsFull_ = true;
+      throw std::runtime_error("background checkpoint failed");
+    }
+  }
+
+  // Сбрасывает записанное на диск.
+  void flush() {
+    wait();
+    if (::fdatasync(fd_) != 0) {
+      privat::throwErrno("fdatasync");
+    }
+  }
+
+  std::uint64_t sequence() const noexcept { return sequence_; }
+
+ private:
+  struct Record {
+    privat::CheckpointRecordHeader header;
+    std::vector<std::uint32_t> pages;
+    std::uint64_t offset;
+    std::size_t bytes;
+  };
+
+  std::vector<std::uint32_t> allPages() const {
+    std::vector<std::uint32_t> pages(arena_.usedPages());
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+      pages[i] = static_cast<std::uint32_t>(i);
+    }
+    return pages;
+  }
+
+  Record prepare(std::vector<std::uint32_t> pages) const {
+    Record record{};
+    record.header.magic = privat::kRecordMagic;
+    record.header.pageCount = static_cast<std::uint32_t>(pages.size());
+    record.header.sequence = sequence_ + 1;
+    record.header.used = arena_.used();
+    record.pages = std::move(pages);
+    record.offset = offset_;
+    record.bytes = sizeof(record.header) +
+                   record.pages.size() * sizeof(std::uint32_t) +
+                   record.pages.size() * arena_.pageSize();
+    return record;
+  }
+
+  CheckpointStats commit(const Record& record,
+                         std::chrono::steady_clock::time_point start) {
+    offset_ += record.bytes;
+    sequence_ = record.header.sequence;
+    needsFull_ = false;
+    CheckpointStats stats;
+    stats.sequence = sequence_;
+    stats.pages = record.pages.size();
+    stats.bytesWritten = record.bytes;
+    stats.pause = std::chrono::steady_clock::now() - start;
+    return stats;
+  }
+
+  // Не выделяет память: вызывается и в дочернем процессе после fork.
+  static bool writeRecord(int fd, const CheckpointArena& arena,
+                          const Record& record) noexcept {
+    const std::size_t pageSize = arena.pageSize();
+    const std::uint32_t* pages = record.pages.data();
+    const std::size_t count = record.pages.size();
+    privat::CheckpointRecordHeader header = record.header;
+    header.checksum = 0;
+    std::uint64_t hash = privat::fnv1a(privat::kFnvOffset, &header,
+                                       sizeof(header));
+    hash = privat::fnv1a(hash, pages, count * sizeof(std::uint32_t));
+    for (std::size_t i = 0; i < count; ++i) {
+      hash = privat::fnv1a(hash, arena.data() + pages[i] * pageSize,
+                           pageSize);
+    }
+    header.checksum = hash;
+
+    std::uint64_t offset = record.offset + sizeof(header);
+    if (!privat::writeAll(fd, pages, count * sizeof(std::uint32_t),
+                          offset)) {
+      return false;
+    }
+    offset += count * sizeof(std::uint32_t);
+    for (std::size_t i = 0; i < count;) {
+      std::size_t end = i + 1;
+      while (end < count && pages[end] == pages[end - 1] + 1) {
+        ++end;
+      }
+      const std::size_t bytes = (end - i) * pageSize;
+      if (!privat::writeAll(fd, arena.data() + pages[i] * pageSize, bytes,
+                            offset)) {
+        return false;
+      }
+      offset += bytes;
+      i = end;
+    }
+    // Заголовок последним: без него запись при восстановлении не видна.
+    return privat::writeAll(fd, &header, sizeof(header), record.offset);
+  }
+
+  CheckpointArena& arena_;
+  int fd_ = -1;
+  std::uint64_t offset_ = 0;
+  std::uint64_t pendingOffset_ = 0;
+  std::uint64_t sequence_ = 0;
+  pid_t child_ = -1;
+  bool needsFull_ = false;
+};
+
+/**
+ * Восстанавливает арену из файла чекпоинтов: обнуляет её и накатывает
+ * записи по порядку, до upTo включительно. Оборванный или повреждённый
+ * хвост файла отбрасывается. Возвращает номер последней применённой записи
+ * (0 - ни одной).
+ */
+inline std::uint64_t replayCheckpoints(const std::string& path,
+                                       CheckpointArena& arena,
+                                       std::uint64_t upTo) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    privat::throwErrno("open checkpoint file");
+  }
+  SCOPE_EXIT { ::close(fd); };
+  privat::CheckpointFileHeader file{};
+  if (!privat::readAll(fd, &file, sizeof(file), 0) ||
+      std::memcmp(file.magic, privat::kCheckpointMagic, sizeof(file.magic)) !=
+          0) {
+    throw std::runtime_error("not a checkpoint file: " + path);
+  }
+  if (file.pageSize != arena.pageSize() || file.capacity > arena.capacity()) {
+    throw std::runtime_error("checkpoint file does not fit the arena");
+  }
+
+  arena.clear();
+  const std::size_t pageSize = arena.pageSize();
+  std::uint64_t offset = sizeof(file);
+  std::uint64_t applied = 0;
+  std::vector<std::uint32_t> pages;
+  std::vector<std::byte> buffer(std::size_t{256} * pageSize);
+  for (;;) {
+    privat::CheckpointRecordHeader header{};
+    if (!privat::readAll(fd, &header, sizeof(header), offset) ||
+        header.magic != privat::kRecordMagic ||
+        header.sequence != applied + 1 || header.sequence > upTo ||
+        header.used > arena.capacity() ||
+        header.pageCount > arena.pageCount()) {
+      break;
+    }
+    pages.resize(header.pageCount);
+    const std::uint64_t pagesOffset = offset + sizeof(header);
+    const std::uint64_t dataOffset =
+        pagesOffset + pages.size() * sizeof(std::uint32_t);
+    if (!privat::readAll(fd, pages.data(),
+                         pages.size() * sizeof(std::uint32_t), pagesOffset)) {
+      break;
+    }
+    // Сначала проверяем запись целиком, потом накатываем: повреждённая
+    // запись не должна испортить уже восстановленное.
+    const std::uint64_t expected = std::exchange(header.checksum, 0);
+    std::uint64_t hash =
+        privat::fnv1a(privat::kFnvOffset, &header, sizeof(header));
+    hash = privat::fnv1a(hash, pages.data(),
+                         pages.size() * sizeof(std::uint32_t));
+    bool valid = true;
+    const std::size_t dataBytes = pages.size() * pageSize;
+    for (std::size_t done = 0; valid && done < dataBytes;) {
+      const std::size_t n = std::min(buffer.size(), dataBytes - done);
+      valid = privat::readAll(fd, buffer.data(), n, dataOffset + done);
+      hash = privat::fnv1a(hash, buffer.data(), n);
+      done += n;
+    }
+    for (std::uint32_t page : pages) {
+      valid = valid && page < arena.pageCount();
+    }
+    if (!valid || hash != expected) {
+      break;
+    }
+    for (std::size_t i = 0; i < pages.size();) {
+      std::size_t end = i + 1;
+      while (end < pages.size() && pages[end] == pages[end - 1] + 1) {
+        ++end;
+      }
+      if (!privat::readAll(fd, arena.data() + pages[i] * pageSize,
+                           (end - i) * pageSize, dataOffset + i * pageSize)) {
+        privat::throwErrno("read checkpoint");
+      }
+      i = end;
+    }
+    arena.used_ = static_cast<std::size_t>(header.used);
+    applied = header.sequence;
+    offset = dataOffset + dataBytes;
+  }
+  arena.resetDirty();
+  return applied;
+}
@@ -0,0 +1,300 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "core.h"
+
+/**
+ * Обёртки над вызываемыми объектами без лишних аллокаций.
+ *
+ * InplaceFunction<Sig, Capacity> хранит объект только внутри себя и никогда
+ * не выделяет память: слишком большое замыкание - ошибка компиляции. Она
+ * копируемая, как std::function, поэтому принимает только копируемые
+ * замыкания.
+ *
+ * UniqueFunction<Sig, InlineSize> - только перемещаемая, как
+ * std::move_only_function: принимает замыкания с unique_ptr и т.п.; то, что
+ * не влезает в InlineSize, кладётся в кучу.
+ *
+ * Sig может быть R(Args...) или R(Args...) noexcept. Вызов - один косвенный
+ * вызов через указатель, хранящийся прямо в объекте. Копируемость задаётся
+ * базой EnableCopyMove.
+ */
+
+inline constexpr std::size_t kDefaultFunctionCapacity = 4 * sizeof(void*);
+
+namespace privat {
+
+template <std::size_t Capacity, bool Copyable, bool AllowHeap, bool NoExcept,
+          typename R, typename... Args>
+class FunctionStorage {
+  static_assert(Capacity >= sizeof(void*), "Capacity is too small");
+
+  using Invoker = R (*)(void*, Args&&...) noexcept(NoExcept);
+
+  // Операции, нужные только при копировании, перемещении и разрушении.
+  struct Ops {
+    void (*relocate)(void* dst, void* src) noexcept;
+    void (*copy)(void* dst, const void* src);
+    void (*destroy)(void* buffer) noexcept;
+    bool heap;
+  };
+
+  static constexpr std::size_t kAlign = alignof(std::max_align_t);
+
+  template <typename D>
+  static constexpr bool kFitsInline = sizeof(D) <= Capacity &&
+                                      alignof(D) <= kAlign &&
+                                      std::is_nothrow_move_constructible_v<D>;
+
+  template <typename D>
+  static constexpr bool kIsCallable =
+      (NoExcept ? std::is_nothrow_invocable_r_v<R, D&, Args...>
+                : std::is_invocable_r_v<R, D&, Args...>) &&
+      (!Copyable || std::is_copy_constructible_v<D>) &&
+      !std::is_base_of_v<FunctionStorage, D>;
+
+  // Условие стоит в ограничении конструктора, а не в static_assert внутри
+  // него: иначе is_constructible_v врёт про слишком большие замыкания.
+  template <typename D>
+  static constexpr bool kAccepts =
+      kIsCallable<D> && (AllowHeap || kFitsInline<D>);
+
+  template <typename D>
+  static constexpr bool kTooBig =
+      kIsCallable<D> && !AllowHeap && !kFitsInline<D>;
+
+  template <typename D>
+  static D* object(void* buffer) noexcept {
+    return std::launder(static_cast<D*>(buffer));
+  }
+
+  template <typename D>
+  static R call(D& f, Args&&... args) noexcept(NoExcept) {
+    if constexpr (std::is_void_v<R>) {
+      std::invoke(f, std::forward<Args>(args)...);
+    } else {
+      return std::invoke(f, std::forward<Args>(args)...);
+    }
+  }
+
+  template <typename D>
+  static R invokeInline(void* buffer, Args&&... args) noexcept(NoExcept) {
+    return call(*object<D>(buffer), std::forward<Args>(args)...);
+  }
+
+  template <typename D>
+  static R invokeHeap(void* buffer, Args&&... args) noexcept(NoExcept) {
+    return call(**object<D*>(buffer), std::forward<Args>(args)...);
+  }
+
+  static R invokeEmpty(void*, Args&&...) noexcept(NoExcept) {
+    if constexpr (NoExcept) {
+      std::terminate();
+    } else {
+      throw std::bad_function_call();
+    }
+  }
+
+  template <typename D>
+  struct InlineOps {
+    static void relocate(void* dst, void* src) noexcept {
+      D* from = object<D>(src);
+      ::new (dst) D(std::move(*from));
+      from->~D();
+    }
+    static void copy(void* dst, const void* src) {
+      ::new (dst) D(*std::launder(static_cast<const D*>(src)));
+    }
+    static void destroy(void* buffer) noexcept { object<D>(buffer)->~D(); }
+  };
+
+  template <typename D>
+  struct HeapOps {
+    static void relocate(void* dst, void* src) noexcept {
+      ::new (dst) D*(*object<D*>(src));
+    }
+    static void copy(void* dst, const void* src) {
+      ::new (dst) D*(new D(**std::launder(static_cast<D* const*>(src))));
+    }
+    static void destroy(void* buffer) noexcept { delete *object<D*>(buffer); }
+  };
+
+  // copy берётся только у копируемых обёрток: у move-only замыканий его нет.
+  template <typename Impl>
+  static constexpr Ops makeOps(bool heap) noexcept {
+    if constexpr (Copyable) {
+      return {&Impl::relocate, &Impl::copy, &Impl::destroy, heap};
+    } else {
+      return {&Impl::relocate, nullptr, &Impl::destroy, heap};
+    }
+  }
+
+  template <typename D>
+  static constexpr Ops kInlineOps = makeOps<InlineOps<D>>(false);
+  template <typename D>
+  static constexpr Ops kHeapOps = makeOps<HeapOps<D>>(true);
+
+ public:
+  using result_type = R;
+
+  FunctionStorage() noexcept = default;
+  FunctionStorage(std::nullptr_t) noexcept {}
+
+  template <typename F, typename D = std::decay_t<F>,
+            typename = std::enable_if_t<kAccepts<D>>>
+  FunctionStorage(F&& f) {
+    if constexpr (std::is_pointer_v<D> || std::is_member_pointer_v<D>) {
+      if (f == nullptr) {
+        return;
+      }
+    }
+    if constexpr (kFitsInline<D>) {
+      ::new (static_cast<void*>(buffer_)) D(std::forward<F>(f));
+      ops_ = &kInlineOps<D>;
+      invoke_ = &invokeInline<D>;
+    } else {
+      ::new (static_cast<void*>(buffer_)) D*(new D(std::forward<F>(f)));
+      ops_ = &kHeapOps<D>;
+      invoke_ = &invokeHeap<D>;
+    }
+  }
+
+  // Замыкание не помещается в InplaceFunction: увеличьте Capacity или
+  // сделайте его конструктор перемещения noexcept.
+  template <typename F, typename D = std::decay_t<F>,
+            std::enable_if_t<kTooBig<D>, int> = 0>
+  FunctionStorage(F&& f) = delete;
+
+  FunctionStorage(const FunctionStorage& other) {
+    if (other.ops_) {
+      other.ops_->copy(buffer_, other.buffer_);
+      ops_ = other.ops_;
+      invoke_ = other.invoke_;
+    }
+  }
+
+  FunctionStorage(FunctionStorage&& other) noexcept { steal(other); }
+
+  FunctionStorage& operator=(const FunctionStorage& other) {
+    if (this != &other) {
+      FunctionStorage copy(other);
+      reset();
+      steal(copy);
+    }
+    return *this;
+  }
+
+  FunctionStorage& operator=(FunctionStorage&& other) noexcept {
+    if (this != &other) {
+      reset();
+      steal(other);
+    }
+    return *this;
+  }
+
+  FunctionStorage& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  template <typename F, typename D = std::decay_t<F>,
+            typename = std::enable_if_t<kAccepts<D>>>
+  FunctionStorage& operator=(F&& f) {
+    FunctionStorage fresh(std::forward<F>(f));
+    reset();
+    steal(fresh);
+    return *this;
+  }
+
+  ~FunctionStorage() { reset(); }
+
+  R operator()(Args... args) const noexcept(NoExcept) {
+    return invoke_(buffer_, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  friend bool operator==(const FunctionStorage& f, std::nullptr_t) noexcept {
+    return !f;
+  }
+
+  void swap(FunctionStorage& other) noexcept {
+    FunctionStorage tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Пустая обёртка или объект хранится внутри, без кучи.
+  bool isInline() const noexcept { return !ops_ || !ops_->heap; }
+
+ private:
+  void reset() noexcept {
+    if (ops_) {
+      ops_->destroy(buffer_);
+      ops_ = nullptr;
+      invoke_ = &invokeEmpty;
+    }
+  }
+
+  void steal(FunctionStorage& other) noexcept {
+    if (other.ops_) {
+      other.ops_->relocate(buffer_, other.buffer_);
+      ops_ = std::exchange(other.ops_, nullptr);
+      invoke_ = std::exchange(other.invoke_, &invokeEmpty);
+    }
+  }
+
+  Invoker invoke_ = &invokeEmpty;
+  const Ops* ops_ = nullptr;
+  alignas(kAlign) mutable unsigned char buffer_[Capacity];
+};
+
+template <typename Sig>
+struct FunctionSignature;
+
+template <typename R, typename... Args>
+struct FunctionSignature<R(Args...)> {
+  template <std::size_t Capacity, bool Copyable, bool AllowHeap>
+  using storage =
+      FunctionStorage<Capacity, Copyable, AllowHeap, false, R, Args...>;
+};
+
+template <typename R, typename... Args>
+struct FunctionSignature<R(Args...) noexcept> {
+  template <std::size_t Capacity, bool Copyable, bool AllowHeap>
+  using storage =
+      FunctionStorage<Capacity, Copyable, AllowHeap, true, R, Args...>;
+};
+
+}  // namespace privat
+
+template <typename Sig, std::size_t Capacity = kDefaultFunctionCapacity>
+class InplaceFunction
+    : public privat::FunctionSignature<Sig>::template storage<Capacity, true,
+                                                              false>,
+      private EnableCopyMove<true, true> {
+  using Base = typename privat::FunctionSignature<Sig>::template storage<
+      Capacity, true, false>;
+
+ public:
+  using Base::Base;
+  using Base::operator=;
+};
+
+template <typename Sig, std::size_t InlineSize = kDefaultFunctionCapacity>
+class UniqueFunction
+    : public privat::FunctionSignature<Sig>::template storage<InlineSize,
+                                                              false, true>,
+      private EnableCopyMove<false, true> {
+  using Base = typename privat::FunctionSignature<Sig>::template storage<
+      InlineSize, false, true>;
+
+ public:
+  using Base::Base;
+  using Base::operator=;
+};
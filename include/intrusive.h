@@ -0,0 +1,1245 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "core.h"
+#include "scope_guard.h"
+
+/**
+ * Интрусивные контейнеры: список, односвязный список, хеш-множество и
+ * красно-чёрное дерево. Узлы (хуки) живут внутри самих объектов, поэтому
+ * вставка и удаление не выделяют память, а удаление по ссылке на объект не
+ * требует поиска.
+ *
+ * Каждый хук хранит указатель на контейнер-владелец, благодаря чему size()
+ * всегда O(1), а хук в режиме LinkMode::auto_unlink сам выписывается из
+ * контейнера в деструкторе. В режиме LinkMode::safe деструктор хука лишь
+ * проверяет (assert), что объект уже не состоит в контейнере.
+ *
+ * Контейнеры не копируются и не перемещаются: хуки ссылаются на их адрес.
+ * Потокобезопасности нет, как и у std:: контейнеров.
+ */
+enum class LinkMode { safe, auto_unlink };
+
+/**
+ * Способ получить хук из объекта и объект из хука, когда T наследуется от
+ * хука (base hook).
+ */
+template <typename T, typename Hook>
+struct IntrusiveBaseHook {
+  using value_type = T;
+  using hook_type = Hook;
+
+  static Hook* toHook(T* value) noexcept { return static_cast<Hook*>(value); }
+  static T* toValue(Hook* hook) noexcept { return static_cast<T*>(hook); }
+};
+
+/**
+ * То же самое для хука, который является полем объекта (member hook):
+ * IntrusiveMemberHook<Foo, IntrusiveListHook<>, &Foo::hook_>.
+ */
+template <typename T, typename Hook, Hook T::*Member>
+struct IntrusiveMemberHook {
+  using value_type = T;
+  using hook_type = Hook;
+
+  static Hook* toHook(T* value) noexcept { return &(value->*Member); }
+  static T* toValue(Hook* hook) noexcept {
+    return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(hook) -
+                                offset());
+  }
+
+ private:
+  // Смещение поля внутри T. Компилятор сворачивает это в константу.
+  static std::ptrdiff_t offset() noexcept {
+    alignas(T) unsigned char storage[sizeof(T)];
+    T* object = reinterpret_cast<T*>(storage);
+    return reinterpret_cast<unsigned char*>(&(object->*Member)) - storage;
+  }
+};
+
+namespace privat {
+
+template <typename Traits, typename Node>
+typename Traits::value_type* nodeToValue(Node* node) noexcept {
+  return Traits::toValue(static_cast<typename Traits::hook_type*>(node));
+}
+
+template <typename Traits, typename Node>
+Node* valueToNode(typename Traits::value_type& value) noexcept {
+  return Traits::toHook(std::addressof(value));
+}
+
+// ---------------------------------------------------------------------------
+// Двусвязный список
+
+struct ListRoot;
+
+struct ListNode {
+  ListNode* prev_ = nullptr;
+  ListNode* next_ = nullptr;
+  ListRoot* owner_ = nullptr;
+};
+
+struct ListRoot : UncopyableUnmovable {
+  ListRoot() noexcept { sentinel_.prev_ = sentinel_.next_ = &sentinel_; }
+
+  void linkBefore(ListNode* pos, ListNode* node) noexcept {
+    assert(node->owner_ == nullptr && "node is already linked");
+    assert(pos->owner_ == this && "position belongs to another list");
+    node->prev_ = pos->prev_;
+    node->next_ = pos;
+    pos->prev_->next_ = node;
+    pos->prev_ = node;
+    node->owner_ = this;
+    ++size_;
+  }
+
+  void unlink(ListNode* node) noexcept {
+    assert(node->owner_ == this && "node belongs to another list");
+    node->prev_->next_ = node->next_;
+    node->next_->prev_ = node->prev_;
+    node->prev_ = node->next_ = nullptr;
+    node->owner_ = nullptr;
+    --size_;
+  }
+
+  ListNode sentinel_{nullptr, nullptr, this};
+  std::size_t size_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Односвязный список
+
+struct SListRoot;
+
+struct SListNode {
+  SListNode* next_ = nullptr;
+  SListRoot* owner_ = nullptr;
+};
+
+struct SListRoot : UncopyableUnmovable {
+  void linkAfter(SListNode* pos, SListNode* node) noexcept {
+    assert(node->owner_ == nullptr && "node is already linked");
+    assert(pos->owner_ == this && "position belongs to another list");
+    node->next_ = pos->next_;
+    pos->next_ = node;
+    node->owner_ = this;
+    ++size_;
+  }
+
+  void unlinkAfter(SListNode* pos) noexcept {
+    SListNode* node = pos->next_;
+    assert(node != nullptr && node->owner_ == this);
+    pos->next_ = node->next_;
+    node->next_ = nullptr;
+    node->owner_ = nullptr;
+    --size_;
+  }
+
+  // O(n): у односвязного списка предшественника приходится искать.
+  SListNode* previous(SListNode* node) noexcept {
+    SListNode* pos = &head_;
+    while (pos->next_ != node) {
+      pos = pos->next_;
+    }
+    return pos;
+  }
+
+  void unlink(SListNode* node) noexcept {
+    assert(node->owner_ == this && "node belongs to another list");
+    unlinkAfter(previous(node));
+  }
+
+  SListNode head_{nullptr, this};
+  std::size_t size_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Хеш-множество. Цепочки в корзинах - односвязные с указателем на
+// предыдущее поле next_ (как hlist в ядре Linux), что даёт O(1) удаление
+// без знания корзины.
+
+struct HashRoot;
+
+struct HashNode {
+  HashNode* next_ = nullptr;
+  HashNode** pprev_ = nullptr;
+  HashRoot* owner_ = nullptr;
+  std::size_t hash_ = 0;
+};
+
+struct HashRoot : UncopyableUnmovable {
+  std::size_t bucketIndex(std::size_t hash) const noexcept {
+    return hash & (bucketCount_ - 1);
+  }
+
+  void link(HashNode* node, std::size_t hash) noexcept {
+    assert(node->owner_ == nullptr && "node is already linked");
+    node->hash_ = hash;
+    pushFront(&buckets_[bucketIndex(hash)], node);
+    node->owner_ = this;
+    ++size_;
+  }
+
+  void unlink(HashNode* node) noexcept {
+    assert(node->owner_ == this && "node belongs to another set");
+    *node->pprev_ = node->next_;
+    if (node->next_) {
+      node->next_->pprev_ = node->pprev_;
+    }
+    node->next_ = nullptr;
+    node->pprev_ = nullptr;
+    node->owner_ = nullptr;
+    --size_;
+  }
+
+  // Хеш закэширован в узле, поэтому перераспределение не вызывает
+  // пользовательскую хеш-функцию и не бросает ничего, кроме bad_alloc.
+  void rehash(std::size_t count) {
+    std::size_t newCount = 8;
+    while (newCount < count) {
+      newCount *= 2;
+    }
+    if (newCount == bucketCount_) {
+      return;
+    }
+    std::unique_ptr<HashNode*[]> fresh(new HashNode*[newCount]());
+    std::unique_ptr<HashNode*[]> old =
+        std::exchange(buckets_, std::move(fresh));
+    const std::size_t oldCount = std::exchange(bucketCount_, newCount);
+    for (std::size_t i = 0; i < oldCount; ++i) {
+      HashNode* node = old[i];
+      while (node) {
+        HashNode* next = node->next_;
+        pushFront(&buckets_[bucketIndex(node->hash_)], node);
+        node = next;
+      }
+    }
+  }
+
+  static void pushFront(HashNode** head, HashNode* node) noexcept {
+    node->next_ = *head;
+    if (*head) {
+      (*head)->pprev_ = &node->next_;
+    }
+    *head = node;
+    node->pprev_ = head;
+  }
+
+  std::unique_ptr<HashNode*[]> buckets_;
+  std::size_t bucketCount_ = 0;
+  std::size_t size_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Красно-чёрное дерево (CLRS) с указателями на родителя.
+
+struct RBRoot;
+
+struct RBNode {
+  RBNode* parent_ = nullptr;
+  RBNode* left_ = nullptr;
+  RBNode* right_ = nullptr;
+  RBRoot* owner_ = nullptr;
+  bool red_ = false;
+};
+
+inline bool isRed(const RBNode* node) noexcept {
+  return node != nullptr && node->red_;
+}
+
+inline RBNode* rbMinimum(RBNode* node) noexcept {
+  while (node->left_) {
+    node = node->left_;
+  }
+  return node;
+}
+
+inline RBNode* rbMaximum(RBNode* node) noexcept {
+  while (node->right_) {
+    node = node->right_;
+  }
+  return node;
+}
+
+inline RBNode* rbNext(RBNode* node) noexcept {
+  if (node->right_) {
+    return rbMinimum(node->right_);
+  }
+  RBNode* parent = node->parent_;
+  while (parent && node == parent->right_) {
+    node = parent;
+    parent = parent->parent_;
+  }
+  return parent;
+}
+
+inline RBNode* rbPrev(RBNode* node) noexcept {
+  if (node->left_) {
+    return rbMaximum(node->left_);
+  }
+  RBNode* parent = node->parent_;
+  while (parent && node == parent->left_) {
+    node = parent;
+    parent = parent->parent_;
+  }
+  return parent;
+}
+
+struct RBRoot : UncopyableUnmovable {
+  void link(RBNode* parent, bool left, RBNode* node) noexcept {
+    assert(node->owner_ == nullptr && "node is already linked");
+    node->parent_ = parent;
+    node->left_ = node->right_ = nullptr;
+    node->red_ = true;
+    node->owner_ = this;
+    if (!parent) {
+      root_ = node;
+    } else if (left) {
+      parent->left_ = node;
+    } else {
+      parent->right_ = node;
+    }
+    insertFixup(node);
+    ++size_;
+  }
+
+  void unlink(RBNode* z) noexcept {
+    assert(z->owner_ == this && "node belongs to another tree");
+    RBNode* y = z;
+    bool removedRed = y->red_;
+    RBNode* x = nullptr;
+    RBNode* xParent = nullptr;
+    if (!z->left_) {
+      x = z->right_;
+      xParent = z->parent_;
+      transplant(z, z->right_);
+    } else if (!z->right_) {
+      x = z->left_;
+      xParent = z->parent_;
+      transplant(z, z->left_);
+    } else {
+      y = rbMinimum(z->right_);
+      removedRed = y->red_;
+      x = y->right_;
+      if (y->parent_ == z) {
+        xParent = y;
+      } else {
+        xParent = y->parent_;
+        transplant(y, y->right_);
+        y->right_ = z->right_;
+        y->right_->parent_ = y;
+      }
+      transplant(z, y);
+      y->left_ = z->left_;
+      y->left_->parent_ = y;
+      y->red_ = z->red_;
+    }
+    if (!removedRed) {
+      eraseFixup(x, xParent);
+    }
+    *z = RBNode{};
+    --size_;
+  }
+
+  void rotateLeft(RBNode* x) noexcept {
+    RBNode* y = x->right_;
+    x->right_ = y->left_;
+    if (y->left_) {
+      y->left_->parent_ = x;
+    }
+    transplant(x, y);
+    y->left_ = x;
+    x->parent_ = y;
+  }
+
+  void rotateRight(RBNode* x) noexcept {
+    RBNode* y = x->left_;
+    x->left_ = y->right_;
+    if (y->right_) {
+      y->right_->parent_ = x;
+    }
+    transplant(x, y);
+    y->right_ = x;
+    x->parent_ = y;
+  }
+
+  void transplant(RBNode* u, RBNode* v) noexcept {
+    if (!u->parent_) {
+      root_ = v;
+    } else if (u == u->parent_->left_) {
+      u->parent_->left_ = v;
+    } else {
+      u->parent_->right_ = v;
+    }
+    if (v) {
+      v->parent_ = u->parent_;
+    }
+  }
+
+  void insertFixup(RBNode* z) noexcept {
+    while (isRed(z->parent_)) {
+      RBNode* parent = z->parent_;
+      RBNode* grand = parent->parent_;
+      if (parent == grand->left_) {
+        RBNode* uncle = grand->right_;
+        if (isRed(uncle)) {
+          parent->red_ = uncle->red_ = false;
+          grand->red_ = true;
+          z = grand;
+          continue;
+        }
+        if (z == parent->right_) {
+          z = parent;
+          rotateLeft(z);
+          parent = z->parent_;
+        }
+        parent->red_ = false;
+        grand->red_ = true;
+        rotateRight(grand);
+      } else {
+        RBNode* uncle = grand->left_;
+        if (isRed(uncle)) {
+          parent->red_ = uncle->red_ = false;
+          grand->red_ = true;
+          z = grand;
+          continue;
+        }
+        if (z == parent->left_) {
+          z = parent;
+          rotateRight(z);
+          parent = z->parent_;
+        }
+        parent->red_ = false;
+        grand->red_ = true;
+        rotateLeft(grand);
+      }
+    }
+    root_->red_ = false;
+  }
+
+  void eraseFixup(RBNode* x, RBNode* parent) noexcept {
+    while (x != root_ && !isRed(x)) {
+      if (x == parent->left_) {
+        RBNode* w = parent->right_;
+        if (w->red_) {
+          w->red_ = false;
+          parent->red_ = true;
+          rotateLeft(parent);
+          w = parent->right_;
+        }
+        if (!isRed(w->left_) && !isRed(w->right_)) {
+          w->red_ = true;
+          x = parent;
+          parent = x->parent_;
+          continue;
+        }
+        if (!isRed(w->right_)) {
+          w->left_->red_ = false;
+          w->red_ = true;
+          rotateRight(w);
+          w = parent->right_;
+        }
+        w->red_ = parent->red_;
+        parent->red_ = false;
+        w->right_->red_ = false;
+        rotateLeft(parent);
+        x = root_;
+      } else {
+        RBNode* w = parent->left_;
+        if (w->red_) {
+          w->red_ = false;
+          parent->red_ = true;
+          rotateRight(parent);
+          w = parent->left_;
+        }
+        if (!isRed(w->left_) && !isRed(w->right_)) {
+          w->red_ = true;
+          x = parent;
+          parent = x->parent_;
+          continue;
+        }
+        if (!isRed(w->left_)) {
+          w->right_->red_ = false;
+          w->red_ = true;
+          rotateLeft(w);
+          w = parent->left_;
+        }
+        w->red_ = parent->red_;
+        parent->red_ = false;
+        w->left_->red_ = false;
+        rotateRight(parent);
+        x = root_;
+      }
+    }
+    if (x) {
+      x->red_ = false;
+    }
+  }
+
+  RBNode* root_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+/**
+ * Общая часть всех хуков: копия хука всегда не привязана к контейнеру,
+ * присваивание ничего не делает, деструктор в зависимости от режима либо
+ * выписывает узел, либо проверяет, что это уже сделано.
+ */
+template <typename Node, LinkMode Mode>
+class HookBase : public Node {
+ public:
+  HookBase() noexcept = default;
+  HookBase(const HookBase&) noexcept : Node() {}
+  HookBase& operator=(const HookBase&) noexcept { return *this; }
+
+  ~HookBase() {
+    if constexpr (Mode == LinkMode::auto_unlink) {
+      unlink();
+    } else {
+      assert(!isLinked() && "safe-mode hook destroyed while still linked");
+    }
+  }
+
+  bool isLinked() const noexcept { return this->owner_ != nullptr; }
+
+  void unlink() noexcept {
+    if (this->owner_) {
+      this->owner_->unlink(this);
+    }
+  }
+};
+
+}  // namespace privat
+
+/**
+ * Хуки. Tag позволяет держать объект сразу в нескольких контейнерах одного
+ * вида через несколько базовых хуков.
+ */
+template <typename Tag = void, LinkMode Mode = LinkMode::auto_unlink>
+class IntrusiveListHook : public privat::HookBase<privat::ListNode, Mode> {};
+
+template <typename Tag = void, LinkMode Mode = LinkMode::auto_unlink>
+class IntrusiveSListHook : public privat::HookBase<privat::SListNode, Mode> {
+};
+
+template <typename Tag = void, LinkMode Mode = LinkMode::auto_unlink>
+class IntrusiveHashSetHook : public privat::HookBase<privat::HashNode, Mode> {
+};
+
+template <typename Tag = void, LinkMode Mode = LinkMode::auto_unlink>
+class IntrusiveRBTreeHook : public privat::HookBase<privat::RBNode, Mode> {};
+
+template <typename T>
+class AutoList;
+
+// ---------------------------------------------------------------------------
+
+template <typename T,
+          typename Traits = IntrusiveBaseHook<T, IntrusiveListHook<>>>
+class IntrusiveList {
+  using Node = privat::ListNode;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    Iterator() noexcept = default;
+    explicit Iterator(Node* node) noexcept : node_(node) {}
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other) noexcept : node_(other.node_) {}
+
+    reference operator*() const noexcept {
+      return *privat::nodeToValue<Traits>(node_);
+    }
+    pointer operator->() const noexcept {
+      return privat::nodeToValue<Traits>(node_);
+    }
+    Iterator& operator++() noexcept {
+      node_ = node_->next_;
+      return *this;
+    }
+    Iterator operator++(int) noexcept {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    Iterator& operator--() noexcept {
+      node_ = node_->prev_;
+      return *this;
+    }
+    Iterator operator--(int) noexcept {
+      Iterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+    friend bool operator==(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ == b.node_;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ != b.node_;
+    }
+
+   private:
+    friend class IntrusiveList;
+    friend class Iterator<!Const>;
+    Node* node_ = nullptr;
+  };
+
+ public:
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  IntrusiveList() noexcept = default;
+  ~IntrusiveList() { clear(); }
+
+  iterator begin() noexcept { return iterator(root_.sentinel_.next_); }
+  iterator end() noexcept { return iterator(&root_.sentinel_); }
+  const_iterator begin() const noexcept {
+    return const_iterator(root_.sentinel_.next_);
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(const_cast<Node*>(&root_.sentinel_));
+  }
+
+  bool empty() const noexcept { return root_.size_ == 0; }
+  size_type size() const noexcept { return root_.size_; }
+
+  T& front() noexcept { return *begin(); }
+  T& back() noexcept { return *std::prev(end()); }
+
+  void push_front(T& value) noexcept { insert(begin(), value); }
+  void push_back(T& value) noexcept { insert(end(), value); }
+  void pop_front() noexcept { erase(begin()); }
+  void pop_back() noexcept { erase(std::prev(end())); }
+
+  iterator insert(const_iterator pos, T& value) noexcept {
+    Node* node = privat::valueToNode<Traits, Node>(value);
+    root_.linkBefore(pos.node_, node);
+    return iterator(node);
+  }
+
+  iterator erase(const_iterator pos) noexcept {
+    Node* next = pos.node_->next_;
+    root_.unlink(pos.node_);
+    return iterator(next);
+  }
+
+  void erase(T& value) noexcept {
+    root_.unlink(privat::valueToNode<Traits, Node>(value));
+  }
+
+  // Итератор на объект, который уже лежит в этом списке, за O(1).
+  iterator iteratorTo(T& value) noexcept {
+    Node* node = privat::valueToNode<Traits, Node>(value);
+    assert(node->owner_ == &root_ && "value is not in this list");
+    return iterator(node);
+  }
+
+  bool contains(const T& value) const noexcept {
+    return privat::valueToNode<Traits, Node>(const_cast<T&>(value))->owner_ ==
+           &root_;
+  }
+
+  void clear() noexcept {
+    while (!empty()) {
+      root_.unlink(root_.sentinel_.next_);
+    }
+  }
+
+  // Выписывает все элементы и передаёт каждый в disposer (например, delete).
+  template <typename Disposer>
+  void clearAndDispose(Disposer disposer) {
+    while (!empty()) {
+      T* value = privat::nodeToValue<Traits>(root_.sentinel_.next_);
+      root_.unlink(root_.sentinel_.next_);
+      disposer(value);
+    }
+  }
+
+  // Привязывает объект на время жизни возвращаемого guard'а.
+  [[nodiscard]] auto scopedPushBack(T& value) noexcept {
+    push_back(value);
+    return makeGuard([this, node = privat::valueToNode<Traits, Node>(value)] {
+      if (node->owner_ == &root_) {
+        root_.unlink(node);
+      }
+    });
+  }
+
+ private:
+  template <typename>
+  friend class AutoList;
+
+  privat::ListRoot root_;
+};
+
+// ---------------------------------------------------------------------------
+
+template <typename T,
+          typename Traits = IntrusiveBaseHook<T, IntrusiveSListHook<>>>
+class IntrusiveSList {
+  using Node = privat::SListNode;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    Iterator() noexcept = default;
+    explicit Iterator(Node* node) noexcept : node_(node) {}
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other) noexcept : node_(other.node_) {}
+
+    reference operator*() const noexcept {
+      return *privat::nodeToValue<Traits>(node_);
+    }
+    pointer operator->() const noexcept {
+      return privat::nodeToValue<Traits>(node_);
+    }
+    Iterator& operator++() noexcept {
+      node_ = node_->next_;
+      return *this;
+    }
+    Iterator operator++(int) noexcept {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    friend bool operator==(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ == b.node_;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ != b.node_;
+    }
+
+   private:
+    friend class IntrusiveSList;
+    friend class Iterator<!Const>;
+    Node* node_ = nullptr;
+  };
+
+ public:
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  IntrusiveSList() noexcept = default;
+  ~IntrusiveSList() { clear(); }
+
+  iterator before_begin() noexcept { return iterator(&root_.head_); }
+  iterator begin() noexcept { return iterator(root_.head_.next_); }
+  iterator end() noexcept { return iterator(nullptr); }
+  const_iterator begin() const noexcept {
+    return const_iterator(root_.head_.next_);
+  }
+  const_iterator end() const noexcept { return const_iterator(nullptr); }
+
+  bool empty() const noexcept { return root_.size_ == 0; }
+  size_type size() const noexcept { return root_.size_; }
+
+  T& front() noexcept { return *begin(); }
+  void push_front(T& value) noexcept { insert_after(before_begin(), value); }
+  void pop_front() noexcept { erase_after(before_begin()); }
+
+  iterator insert_after(const_iterator pos, T& value) noexcept {
+    Node* node = privat::valueToNode<Traits, Node>(value);
+    root_.linkAfter(pos.node_, node);
+    return iterator(node);
+  }
+
+  iterator erase_after(const_iterator pos) noexcept {
+    root_.unlinkAfter(pos.node_);
+    return iterator(pos.node_->next_);
+  }
+
+  // O(n): ищет предшественника.
+  void erase(T& value) noexcept {
+    root_.unlink(privat::valueToNode<Traits, Node>(value));
+  }
+
+  void clear() noexcept {
+    while (!empty()) {
+      root_.unlinkAfter(&root_.head_);
+    }
+  }
+
+  template <typename Disposer>
+  void clearAndDispose(Disposer disposer) {
+    while (!empty()) {
+      T* value = privat::nodeToValue<Traits>(root_.head_.next_);
+      root_.unlinkAfter(&root_.head_);
+      disposer(value);
+    }
+  }
+
+ private:
+  privat::SListRoot root_;
+};
+
+// ---------------------------------------------------------------------------
+
+template <typename T,
+          typename Traits = IntrusiveBaseHook<T, IntrusiveHashSetHook<>>,
+          typename Hash = std::hash<T>, typename Equal = std::equal_to<>>
+class IntrusiveHashSet {
+  using Node = privat::HashNode;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    Iterator() noexcept = default;
+    Iterator(const privat::HashRoot* root, Node* node) noexcept
+        : root_(root), node_(node) {}
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other) noexcept
+        : root_(other.root_), node_(other.node_) {}
+
+    reference operator*() const noexcept {
+      return *privat::nodeToValue<Traits>(node_);
+    }
+    pointer operator->() const noexcept {
+      return privat::nodeToValue<Traits>(node_);
+    }
+    Iterator& operator++() noexcept {
+      if (node_->next_) {
+        node_ = node_->next_;
+      } else {
+        node_ = firstFrom(root_, root_->bucketIndex(node_->hash_) + 1);
+      }
+      return *this;
+    }
+    Iterator operator++(int) noexcept {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    friend bool operator==(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ == b.node_;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ != b.node_;
+    }
+
+   private:
+    friend class IntrusiveHashSet;
+    friend class Iterator<!Const>;
+    const privat::HashRoot* root_ = nullptr;
+    Node* node_ = nullptr;
+  };
+
+  static Node* firstFrom(const privat::HashRoot* root,
+                         std::size_t bucket) noexcept {
+    for (; bucket < root->bucketCount_; ++bucket) {
+      if (root->buckets_[bucket]) {
+        return root->buckets_[bucket];
+      }
+    }
+    return nullptr;
+  }
+
+ public:
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  explicit IntrusiveHashSet(size_type buckets = 0, const Hash& hash = Hash(),
+                            const Equal& equal = Equal())
+      : hash_(hash), equal_(equal) {
+    root_.rehash(buckets);
+  }
+  ~IntrusiveHashSet() { clear(); }
+
+  iterator begin() noexcept { return iterator(&root_, firstFrom(&root_, 0)); }
+  iterator end() noexcept { return iterator(&root_, nullptr); }
+  const_iterator begin() const noexcept {
+    return const_iterator(&root_, firstFrom(&root_, 0));
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(&root_, nullptr);
+  }
+
+  bool empty() const noexcept { return root_.size_ == 0; }
+  size_type size() const noexcept { return root_.size_; }
+  size_type bucket_count() const noexcept { return root_.bucketCount_; }
+
+  /**
+   * Вставка уникального значения. Хеш и сравнение вызываются до того, как
+   * узел привязан, а рост таблицы - до привязки, так что при исключении
+   * контейнер не меняется.
+   */
+  std::pair<iterator, bool> insert(T& value) {
+    const std::size_t hash = hash_(value);
+    if (Node* found = findNode(value, hash)) {
+      return {iterator(&root_, found), false};
+    }
+    if (root_.size_ + 1 > root_.bucketCount_) {
+      root_.rehash(root_.bucketCount_ * 2);
+    }
+    Node* node = privat::valueToNode<Traits, Node>(value);
+    root_.link(node, hash);
+    return {iterator(&root_, node), true};
+  }
+
+  template <typename Key>
+  iterator find(const Key& key) {
+    return iterator(&root_, findNode(key, hash_(key)));
+  }
+
+  template <typename Key>
+  const_iterator find(const Key& key) const {
+    return const_iterator(&root_, findNode(key, hash_(key)));
+  }
+
+  template <typename Key>
+  bool contains(const Key& key) const {
+    return find(key) != end();
+  }
+
+  iterator erase(const_iterator pos) noexcept {
+    iterator next(&root_, pos.node_);
+    ++next;
+    root_.unlink(pos.node_);
+    return next;
+  }
+
+  void erase(T& value) noexcept {
+    root_.unlink(privat::valueToNode<Traits, Node>(value));
+  }
+
+  template <typename Key>
+  size_type eraseKey(const Key& key) {
+    Node* node = findNode(key, hash_(key));
+    if (!node) {
+      return 0;
+    }
+    root_.unlink(node);
+    return 1;
+  }
+
+  void rehash(size_type buckets) {
+    root_.rehash(std::max(buckets, root_.size_));
+  }
+
+  void clear() noexcept {
+    for (std::size_t i = 0; i < root_.bucketCount_; ++i) {
+      while (root_.buckets_[i]) {
+        root_.unlink(root_.buckets_[i]);
+      }
+    }
+  }
+
+  template <typename Disposer>
+  void clearAndDispose(Disposer disposer) {
+    for (std::size_t i = 0; i < root_.bucketCount_; ++i) {
+      while (Node* node = root_.buckets_[i]) {
+        root_.unlink(node);
+        disposer(privat::nodeToValue<Traits>(node));
+      }
+    }
+  }
+
+ private:
+  template <typename Key>
+  Node* findNode(const Key& key, std::size_t hash) const {
+    for (Node* node = root_.buckets_[root_.bucketIndex(hash)]; node;
+         node = node->next_) {
+      if (node->hash_ == hash &&
+          equal_(*privat::nodeToValue<Traits>(node), key)) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  privat::HashRoot root_;
+  Hash hash_;
+  Equal equal_;
+};
+
+// ---------------------------------------------------------------------------
+
+template <typename T,
+          typename Traits = IntrusiveBaseHook<T, IntrusiveRBTreeHook<>>,
+          typename Compare = std::less<>>
+class IntrusiveRBTree {
+  using Node = privat::RBNode;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    Iterator() noexcept = default;
+    Iterator(const privat::RBRoot* root, Node* node) noexcept
+        : root_(root), node_(node) {}
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false>& other) noexcept
+        : root_(other.root_), node_(other.node_) {}
+
+    reference operator*() const noexcept {
+      return *privat::nodeToValue<Traits>(node_);
+    }
+    pointer operator->() const noexcept {
+      return privat::nodeToValue<Traits>(node_);
+    }
+    Iterator& operator++() noexcept {
+      node_ = privat::rbNext(node_);
+      return *this;
+    }
+    Iterator operator++(int) noexcept {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    // --end() даёт последний элемент, поэтому итератор помнит дерево.
+    Iterator& operator--() noexcept {
+      node_ = node_ ? privat::rbPrev(node_) : privat::rbMaximum(root_->root_);
+      return *this;
+    }
+    Iterator operator--(int) noexcept {
+      Iterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+    friend bool operator==(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ == b.node_;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b) noexcept {
+      return a.node_ != b.node_;
+    }
+
+   private:
+    friend class IntrusiveRBTree;
+    friend class Iterator<!Const>;
+    const privat::RBRoot* root_ = nullptr;
+    Node* node_ = nullptr;
+  };
+
+ public:
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  explicit IntrusiveRBTree(const Compare& compare = Compare())
+      : compare_(compare) {}
+  ~IntrusiveRBTree() { clear(); }
+
+  iterator begin() noexcept { return iterator(&root_, leftmost()); }
+  iterator end() noexcept { return iterator(&root_, nullptr); }
+  const_iterator begin() const noexcept {
+    return const_iterator(&root_, leftmost());
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(&root_, nullptr);
+  }
+
+  bool empty() const noexcept { return root_.size_ == 0; }
+  size_type size() const noexcept { return root_.size_; }
+
+  // Уникальная вставка, как у std::set.
+  std::pair<iterator, bool> insert(T& value) {
+    Node* parent = nullptr;
+    bool left = true;
+    Node* node = root_.root_;
+    while (node) {
+      parent = node;
+      const T& current = *privat::nodeToValue<Traits>(node);
+      if (compare_(value, current)) {
+        left = true;
+        node = node->left_;
+      } else if (compare_(current, value)) {
+        left = false;
+        node = node->right_;
+      } else {
+        return {iterator(&root_, node), false};
+      }
+    }
+    Node* fresh = privat::valueToNode<Traits, Node>(value);
+    root_.link(parent, left, fresh);
+    return {iterator(&root_, fresh), true};
+  }
+
+  // Вставка с повторами, как у std::multiset: после равных элементов.
+  iterator insertEqual(T& value) {
+    Node* parent = nullptr;
+    bool left = true;
+    for (Node* node = root_.root_; node;) {
+      parent = node;
+      left = compare_(value, *privat::nodeToValue<Traits>(node));
+      node = left ? node->left_ : node->right_;
+    }
+    Node* fresh = privat::valueToNode<Traits, Node>(value);
+    root_.link(parent, left, fresh);
+    return iterator(&root_, fresh);
+  }
+
+  template <typename Key>
+  iterator lower_bound(const Key& key) {
+    Node* result = nullptr;
+    for (Node* node = root_.root_; node;) {
+      if (compare_(*privat::nodeToValue<Traits>(node), key)) {
+        node = node->right_;
+      } else {
+        result = node;
+        node = node->left_;
+      }
+    }
+    return iterator(&root_, result);
+  }
+
+  template <typename Key>
+  iterator upper_bound(const Key& key) {
+    Node* result = nullptr;
+    for (Node* node = root_.root_; node;) {
+      if (compare_(key, *privat::nodeToValue<Traits>(node))) {
+        result = node;
+        node = node->left_;
+      } else {
+        node = node->right_;
+      }
+    }
+    return iterator(&root_, result);
+  }
+
+  template <typename Key>
+  iterator find(const Key& key) {
+    iterator it = lower_bound(key);
+    if (it != end() && compare_(key, *it)) {
+      return end();
+    }
+    return it;
+  }
+
+  template <typename Key>
+  bool contains(const Key& key) {
+    return find(key) != end();
+  }
+
+  iterator erase(const_iterator pos) noexcept {
+    iterator next(&root_, privat::rbNext(pos.node_));
+    root_.unlink(pos.node_);
+    return next;
+  }
+
+  void erase(T& value) noexcept {
+    root_.unlink(privat::valueToNode<Traits, Node>(value));
+  }
+
+  iterator iteratorTo(T& value) noexcept {
+    Node* node = privat::valueToNode<Traits, Node>(value);
+    assert(node->owner_ == &root_ && "value is not in this tree");
+    return iterator(&root_, node);
+  }
+
+  void clear() noexcept {
+    clearAndDispose([](T*) noexcept {});
+  }
+
+  // Разбирает дерево снизу вверх без ребалансировки.
+  template <typename Disposer>
+  void clearAndDispose(Disposer disposer) {
+    Node* node = std::exchange(root_.root_, nullptr);
+    root_.size_ = 0;
+    auto detachLeaf = [&node]() noexcept {
+      while (node->left_ || node->right_) {
+        node = node->left_ ? node->left_ : node->right_;
+      }
+      Node* leaf = node;
+      node = leaf->parent_;
+      if (node) {
+        (node->left_ == leaf ? node->left_ : node->right_) = nullptr;
+      }
+      *leaf = Node{};
+      return privat::nodeToValue<Traits>(leaf);
+    };
+    // Если disposer бросит, остаток дерева просто отвязывается.
+    SCOPE_FAIL {
+      while (node) {
+        detachLeaf();
+      }
+    };
+    while (node) {
+      disposer(detachLeaf());
+    }
+  }
+
+ private:
+  Node* leftmost() const noexcept {
+    return root_.root_ ? privat::rbMinimum(root_.root_) : nullptr;
+  }
+
+  privat::RBRoot root_;
+  Compare compare_;
+};
+
+// ---------------------------------------------------------------------------
+
+/**
+ * CRTP-база, которая держит все живые экземпляры T в интрусивном списке
+ * (autolist из Game Programming Gems 3). Регистрация не выделяет память,
+ * выписывание происходит в деструкторе хука. Не потокобезопасно.
+ *
+ *   class Enemy : public AutoList<Enemy> { ... };
+ *   for (Enemy& e : Enemy::instances()) { ... }
+ */
+template <typename T>
+class AutoList : public IntrusiveListHook<AutoList<T>> {
+  using Hook = IntrusiveListHook<AutoList<T>>;
+
+ public:
+  using list_type = IntrusiveList<T, IntrusiveBaseHook<T, Hook>>;
+
+  static list_type& instances() noexcept {
+    static list_type list;
+    return list;
+  }
+
+ protected:
+  // Привязываем хук, а не T: объект T ещё не сконструирован.
+  AutoList() noexcept {
+    privat::ListRoot& root = instances().root_;
+    root.linkBefore(&root.sentinel_, static_cast<Hook*>(this));
+  }
+  AutoList(const AutoList&) noexcept : AutoList() {}
+  AutoList& operator=(const AutoList&) noexcept { return *this; }
+  ~AutoList() = default;
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+#include "core.h"
+#include "reclamation.h"
+
+/**
+ * Стек Трайбера. Узлы освобождаются через домен Reclaimer (EpochDomain или
+ * HazardPointerDomain), поэтому pop() не читает освобождённую память и не
+ * страдает от ABA: узел не может быть переиспользован, пока его кто-то
+ * защищает.
+ */
+template <typename T, typename Reclaimer = EpochDomain>
+class TreiberStack : UncopyableUnmovable {
+  struct Node {
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+    T value;
+    Node* next = nullptr;
+  };
+
+ public:
+  explicit TreiberStack(Reclaimer& domain = Reclaimer::global()) noexcept
+      : domain_(domain) {}
+
+  // Вызывается, когда со стеком уже никто не работает.
+  ~TreiberStack() {
+    Node* node = head_.load(std::memory_order_relaxed);
+    while (node) {
+      delete std::exchange(node, node->next);
+    }
+  }
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    Node* node = new Node(std::forward<Args>(args)...);
+    node->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  void push(const T& value) { emplace(value); }
+  void push(T&& value) { emplace(std::move(value)); }
+
+  std::optional<T> pop() {
+    typename Reclaimer::template Guard<1> guard(domain_);
+    while (true) {
+      Node* top = guard.protect(head_);
+      if (!top) {
+        return std::nullopt;
+      }
+      if (head_.compare_exchange_weak(top, top->next,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+        std::optional<T> result(std::move(top->value));
+        guard.dismiss();
+        domain_.retire(top);
+        return result;
+      }
+    }
+  }
+
+  bool empty() const noexcept {
+    return head_.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  std::atomic<Node*> head_{nullptr};
+  Reclaimer& domain_;
+};
+
+/**
+ * Очередь Майкла-Скотта с фиктивным головным узлом. Значение лежит в узле,
+ * следующем за головой; после успешного dequeue бывшая голова удаляется, а
+ * узел со значением становится новой фиктивной головой.
+ */
+template <typename T, typename Reclaimer = EpochDomain>
+class MichaelScottQueue : UncopyableUnmovable {
+  struct Node {
+    std::optional<T> value;
+    std::atomic<Node*> next{nullptr};
+  };
+
+ public:
+  explicit MichaelScottQueue(Reclaimer& domain = Reclaimer::global())
+      : domain_(domain) {
+    Node* dummy = new Node();
+    head_.store(dummy, std::memory_order_relaxed);
+    tail_.store(dummy, std::memory_order_relaxed);
+  }
+
+  ~MichaelScottQueue() {
+    Node* node = head_.load(std::memory_order_relaxed);
+    while (node) {
+      delete std::exchange(node, node->next.load(std::memory_order_relaxed));
+    }
+  }
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    Node* node = new Node();
+    node->value.emplace(std::forward<Args>(args)...);
+    typename Reclaimer::template Guard<1> guard(domain_);
+    while (true) {
+      Node* tail = guard.protect(tail_);
+      Node* next = tail->next.load(std::memory_order_acquire);
+      if (tail != tail_.load(std::memory_order_acquire)) {
+        continue;
+      }
+      if (next) {
+        // Хвост отстал - помогаем его продвинуть.
+        tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                    std::memory_order_relaxed);
+        continue;
+      }
+      if (tail->next.compare_exchange_weak(next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        tail_.compare_exchange_strong(tail, node, std::memory_order_release,
+                                      std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  void push(const T& value) { emplace(value); }
+  void push(T&& value) { emplace(std::move(value)); }
+
+  std::optional<T> pop() {
+    typename Reclaimer::template Guard<2> guard(domain_);
+    while (true) {
+      Node* head = guard.protect(head_, 0);
+      Node* tail = tail_.load(std::memory_order_acquire);
+      Node* next = guard.protect(head->next, 1);
+      if (head != head_.load(std::memory_order_acquire)) {
+        continue;
+      }
+      if (!next) {
+        return std::nullopt;
+      }
+      if (head == tail) {
+        tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                    std::memory_order_relaxed);
+        continue;
+      }
+      if (head_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+        // next защищён guard'ом, а значение забирает только победитель CAS.
+        std::optional<T> result(std::move(next->value));
+        next->value.reset();
+        guard.dismiss();
+        domain_.retire(head);
+        return result;
+      }
+    }
+  }
+
+  bool empty() const {
+    typename Reclaimer::template Guard<1> guard(domain_);
+    Node* head = guard.protect(head_);
+    return head->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  alignas(64) std::atomic<Node*> head_{nullptr};
+  alignas(64) std::atomic<Node*> tail_{nullptr};
+  Reclaimer& domain_;
+};
@@ -0,0 +1,671 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+#include "posix_error.h"
+#include "scope_guard.h"
+
+/**
+ * Метрики: счётчики, gauge и HDR-гистограммы (gems5: remote debug logger).
+ *
+ * Все значения живут прямо в разделяемом mmap-сегменте. Сегмент - это
+ * заголовок, таблица дескрипторов (имя, тип, где лежат ячейки) и матрица
+ * ячеек shards x maxCells: у каждого шарда своя строка, поток пишет только
+ * в строку своего шарда, поэтому обновление - один relaxed fetch_add в
+ * "свою" кэш-линию. Поток получает наименьший свободный номер и отдаёт его
+ * при выходе, так что пока живых потоков не больше шардов, шарды у них
+ * разные и конкуренции нет. Поток, получивший номер, когда живых было
+ * больше, делит шард с другим до своего выхода. Чтение складывает строки
+ * всех шардов.
+ *
+ * Сегмент можно открыть по имени (shm_open) из другого процесса через
+ * MetricsReader: он сам читает ячейки из своего отображения, так что сбор
+ * метрик не стоит наблюдаемому процессу ни системного вызова, ни
+ * блокировки. Снимок не атомарен целиком: значения разных ячеек могут
+ * относиться к немного разным моментам.
+ *
+ * Регистрация метрик берёт мьютекс и не предназначена для горячего пути:
+ * хэндлы Counter/Gauge/Histogram получают один раз и хранят.
+ */
+
+enum class MetricKind : std::uint32_t { counter = 1, gauge = 2, histogram = 3 };
+
+namespace privat {
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "cells are shared between processes");
+
+inline constexpr char kMetricsMagic[8] = {'E', 'S', 'M', 'E',
+                                          'T', 'R', '0', '1'};
+inline constexpr std::size_t kMetricNameSize = 64;
+inline constexpr unsigned kMaxSubBucketBits = 10;
+inline constexpr std::size_t kMetricsCacheLine = 64;
+inline constexpr std::size_t kCellsPerLine =
+    kMetricsCacheLine / sizeof(std::uint64_t);
+
+using MetricCell = std::atomic<std::uint64_t>;
+
+struct MetricsHeader {
+  char magic[8];
+  std::uint32_t shards;
+  std::uint32_t maxMetrics;
+  std::uint32_t maxCells;  // ячеек в строке одного шарда
+  std::uint32_t reserved;
+  std::uint64_t cellsOffset;
+  // Публикуется с release после того, как дескриптор полностью записан.
+  std::atomic<std::uint32_t> count;
+};
+
+struct MetricDescriptor {
+  char name[kMetricNameSize];
+  MetricKind kind;
+  std::uint32_t firstCell;
+  std::uint32_t cellCount;
+  std::uint32_t subBucketBits;  // только у гистограмм
+};
+
+/**
+ * Лог-линейные корзины HDR: значения меньше 2^subBits - каждое в своей
+ * корзине, дальше на каждую степень двойки по 2^subBits корзин, то есть
+ * относительная погрешность не больше 2^-subBits.
+ */
+constexpr std::size_t histogramBucket(std::uint64_t value,
+                                      unsigned subBits) noexcept {
+  const std::uint64_t subBuckets = std::uint64_t{1} << subBits;
+  if (value < subBuckets) {
+    return static_cast<std::size_t>(value);
+  }
+  const auto exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+  const std::uint64_t mantissa = (value >> (exponent - subBits)) - subBuckets;
+  return static_cast<std::size_t>((exponent - subBits + 1) * subBuckets +
+                                  mantissa);
+}
+
+// Наименьшее значение корзины.
+constexpr std::uint64_t histogramBucketLow(std::size_t bucket,
+                                           unsigned subBits) noexcept {
+  const std::uint64_t subBuckets = std::uint64_t{1} << subBits;
+  if (bucket < subBuckets) {
+    return bucket;
+  }
+  const std::uint64_t group = bucket / subBuckets;  // >= 1
+  const std::uint64_t mantissa = bucket % subBuckets;
+  return (subBuckets + mantissa) << (group - 1);
+}
+
+// Наибольшее значение корзины.
+constexpr std::uint64_t histogramBucketHigh(std::size_t bucket,
+                                            unsigned subBits) noexcept {
+  const std::uint64_t subBuckets = std::uint64_t{1} << subBits;
+  if (bucket < subBuckets) {
+    return bucket;
+  }
+  return histogramBucketLow(bucket, subBits) +
+         ((std::uint64_t{1} << (bucket / subBuckets - 1)) - 1);
+}
+
+inline constexpr std::size_t kMetricsThreadSlots = 4096;
+
+// Занятые номера потоков, бит на номер.
+inline std::atomic<std::uint64_t>* metricsSlotBits() noexcept {
+  static std::atomic<std::uint64_t> bits[kMetricsThreadSlots / 64] = {};
+  return bits;
+}
+
+/**
+ * Номер потока для выбора шарда: наименьший свободный при первом
+ * обращении, освобождается при выходе потока. Если заняты все
+ * kMetricsThreadSlots, номера раздаются по кругу и не возвращаются.
+ */
+inline std::uint32_t metricsThreadIndex() noexcept {
+  struct Slot {
+    Slot() noexcept {
+      std::atomic<std::uint64_t>* bits = metricsSlotBits();
+      for (std::size_t word = 0; word < kMetricsThreadSlots / 64; ++word) {
+        std::uint64_t current = bits[word].load(std::memory_order_relaxed);
+        while (current != ~std::uint64_t{0}) {
+          const int bit = std::countr_one(current);
+          if (bits[word].compare_exchange_weak(
+                  current, current | (std::uint64_t{1} << bit),
+                  std::memory_order_relaxed)) {
+            index = static_cast<std::uint32_t>(word * 64) +
+                    static_cast<std::uint32_t>(bit);
+            owned = true;
+            return;
+          }
+        }
+      }
+      static std::atomic<std::uint32_t> overflow{0};
+      index = overflow.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~Slot() {
+      if (owned) {
+        metricsSlotBits()[index / 64].fetch_and(
+            ~(std::uint64_t{1} << (index % 64)), std::memory_order_relaxed);
+      }
+    }
+    std::uint32_t index = 0;
+    bool owned = false;
+  };
+  thread_local const Slot slot;
+  return slot.index;
+}
+
+// Ячейки одной метрики: cells[shard * stride + i].
+struct MetricCells {
+  MetricCell* base = nullptr;
+  std::size_t stride = 0;
+  std::uint32_t shardMask = 0;
+
+  MetricCell& local(std::size_t i) const noexcept {
+    return base[(metricsThreadIndex() & shardMask) * stride + i];
+  }
+  std::uint64_t sum(std::size_t i) const noexcept {
+    std::uint64_t total = 0;
+    for (std::size_t shard = 0; shard <= shardMask; ++shard) {
+      total += base[shard * stride + i].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+};
+
+}  // namespace privat
+
+// Складываемый снимок гистограммы.
+struct HistogramSnapshot {
+  unsigned subBucketBits = 0;
+  std::uint64_t count = 0;
+  std::uint64_t sum = 0;
+  std::vector<std::uint64_t> buckets;
+
+  double mean() const noexcept {
+    return count == 0 ? 0.0
+                      : static_cast<double>(sum) / static_cast<double>(count);
+  }
+
+  /**
+   * Значение, не больше которого q-я доля записей (q в [0, 1]): верхняя
+   * граница корзины, как в HdrHistogram.
+   */
+  std::uint64_t percentile(double q) const noexcept {
+    if (count == 0) {
+      return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(
+               std::clamp(q, 0.0, 1.0) * static_cast<double>(count) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return privat::histogramBucketHigh(i, subBucketBits);
+      }
+    }
+    return privat::histogramBucketHigh(buckets.size() - 1, subBucketBits);
+  }
+};
+
+namespace privat {
+
+// Ячейки гистограммы: [сумма значений, корзины...].
+inline HistogramSnapshot histogramSnapshot(const MetricCells& cells,
+                                           unsigned subBucketBits,
+                                           std::size_t buckets) {
+  HistogramSnapshot result;
+  result.subBucketBits = subBucketBits;
+  result.sum = cells.sum(0);
+  result.buckets.resize(buckets);
+  for (std::size_t i = 0; i < buckets; ++i) {
+    result.buckets[i] = cells.sum(1 + i);
+    result.count += result.buckets[i];
+  }
+  return result;
+}
+
+}  // namespace privat
+
+// Монотонный счётчик.
+class Counter {
+ public:
+  Counter() noexcept = default;
+
+  void inc(std::uint64_t n = 1) const noexcept {
+    cells_.local(0).fetch_add(n, std::memory_order_relaxed);
+  }
+  std::uint64_t value() const noexcept { return cells_.sum(0); }
+
+ private:
+  friend class MetricsRegistry;
+  explicit Counter(privat::MetricCells cells) noexcept : cells_(cells) {}
+
+  privat::MetricCells cells_;
+};
+
+/**
+ * Текущий уровень (размер очереди, число соединений). Ячейка одна на все
+ * шарды: set() не раскладывается по шардам, поэтому gauge обновляют реже
+ * счётчиков.
+ */
+class Gauge {
+ public:
+  Gauge() noexcept = default;
+
+  void set(std::int64_t value) const noexcept {
+    cell_->store(static_cast<std::uint64_t>(value), std::memory_order_relaxed);
+  }
+  void add(std::int64_t delta) const noexcept {
+    cell_->fetch_add(static_cast<std::uint64_t>(delta),
+                     std::memory_order_relaxed);
+  }
+  std::int64_t value() const noexcept {
+    return static_cast<std::int64_t>(cell_->load(std::memory_order_relaxed));
+  }
+
+ private:
+  friend class MetricsRegistry;
+  explicit Gauge(privat::MetricCell* cell) noexcept : cell_(cell) {}
+
+  privat::MetricCell* cell_ = nullptr;
+};
+
+/**
+ * Гистограмма неотрицательных целых (обычно наносекунд). Раскладка ячеек
+ * в строке шарда: сумма значений, затем корзины; значения больше
+ * maxValue попадают в последнюю корзину.
+ */
+class Histogram {
+ public:
+  Histogram() noexcept = default;
+
+  void record(std::uint64_t value) const noexcept {
+    cells_.local(0).fetch_add(value, std::memory_order_relaxed);
+    const std::size_t bucket = std::min(
+        privat::histogramBucket(value, subBucketBits_), buckets_ - 1);
+    cells_.local(1 + bucket).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Замер длительности до конца области видимости. Это ScopeGuard: его
+   * можно dismiss(), тогда ничего не запишется.
+   *   auto timer = histogram.startTimer();
+   */
+  [[nodiscard]] auto startTimer() const noexcept {
+    return makeGuard([histogram = *this,
+                      start = std::chrono::steady_clock::now()]() noexcept {
+      histogram.record(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+    });
+  }
+
+  HistogramSnapshot snapshot() const {
+    return privat::histogramSnapshot(cells_, subBucketBits_, buckets_);
+  }
+
+ private:
+  friend class MetricsRegistry;
+  Histogram(privat::MetricCells cells, unsigned subBucketBits,
+            std::size_t buckets) noexcept
+      : cells_(cells), subBucketBits_(subBucketBits), buckets_(buckets) {}
+
+  privat::MetricCells cells_;
+  unsigned subBucketBits_ = 0;
+  std::size_t buckets_ = 1;
+};
+
+// Замер длительности текущей области видимости в гистограмму.
+#define METRICS_SCOPED_TIMER(histogram) \
+  auto ANONYMOUS_VARIABLE(METRICS_TIMER) = (histogram).startTimer()
+
+// Значение метрики в снимке; value - для счётчиков и gauge.
+struct MetricSample {
+  std::string name;
+  MetricKind kind;
+  std::int64_t value = 0;
+  HistogramSnapshot histogram;
+};
+
+namespace privat {
+
+// Разбор сегмента: общий для своего процесса и для MetricsReader.
+class MetricsView {
+ public:
+  MetricsView() noexcept = default;
+  MetricsView(std::byte* base, std::size_t bytes) : base_(base) {
+    if (bytes < sizeof(MetricsHeader) ||
+        std::memcmp(header()->magic, kMetricsMagic, sizeof(kMetricsMagic)) !=
+            0) {
+      throw std::runtime_error("not a metrics segment");
+    }
+    // Сегмент пишет другой процесс: смещения и размеры проверяются, а не
+    // берутся на веру.
+    const MetricsHeader& h = *header();
+    if (h.shards == 0 || !std::has_single_bit(h.shards) ||
+        h.cellsOffset != cellsOffset(h.maxMetrics) || h.cellsOffset > bytes ||
+        (bytes - h.cellsOffset) / sizeof(MetricCell) / h.shards <
+            h.maxCells) {
+      throw std::runtime_error("corrupted metrics segment");
+    }
+  }
+
+  static std::size_t descriptorsOffset() noexcept {
+    return (sizeof(MetricsHeader) + kMetricsCacheLine - 1) /
+           kMetricsCacheLine * kMetricsCacheLine;
+  }
+  static std::size_t cellsOffset(std::size_t maxMetrics) noexcept {
+    const std::size_t end =
+        descriptorsOffset() + maxMetrics * sizeof(MetricDescriptor);
+    return (end + kMetricsCacheLine - 1) / kMetricsCacheLine *
+           kMetricsCacheLine;
+  }
+  static std::size_t segmentBytes(std::size_t shards, std::size_t maxMetrics,
+                                  std::size_t maxCells) noexcept {
+    return cellsOffset(maxMetrics) + shards * maxCells * sizeof(MetricCell);
+  }
+
+  MetricsHeader* header() const noexcept {
+    return reinterpret_cast<MetricsHeader*>(base_);
+  }
+  MetricDescriptor* descriptors() const noexcept {
+    return reinterpret_cast<MetricDescriptor*>(base_ + descriptorsOffset());
+  }
+  MetricCells cells(const MetricDescriptor& d) const noexcept {
+    auto* cells =
+        reinterpret_cast<MetricCell*>(base_ + header()->cellsOffset);
+    return {cells + d.firstCell, header()->maxCells, header()->shards - 1};
+  }
+
+  std::vector<MetricSample> snapshot() const {
+    const std::uint32_t count =
+        std::min(header()->count.load(std::memory_order_acquire),
+                 header()->maxMetrics);
+    std::vector<MetricSample> samples;
+    samples.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+      const MetricDescriptor& d = descriptors()[i];
+      if (!valid(d)) {
+        continue;  // испорченный дескриптор, его ячейки читать нельзя
+      }
+      MetricSample& sample = samples.emplace_back();
+      sample.name.assign(d.name, strnlen(d.name, kMetricNameSize));
+      sample.kind = d.kind;
+      const MetricCells c = cells(d);
+      switch (d.kind) {
+        case MetricKind::counter:
+          sample.value = static_cast<std::int64_t>(c.sum(0));
+          break;
+        case MetricKind::gauge:
+          sample.value = static_cast<std::int64_t>(
+              c.base->load(std::memory_order_relaxed));
+          break;
+        case MetricKind::histogram:
+          sample.histogram =
+              histogramSnapshot(c, d.subBucketBits, d.cellCount - 1);
+          break;
+        default:
+          break;  // тип из более новой версии сегмента
+      }
+    }
+    return samples;
+  }
+
+ private:
+  // Ячейки лежат в строке шарда; гистограмме нужны сумма и хотя бы одна
+  // корзина. Неизвестный тип проверять не на что, его значение не читается.
+  bool valid(const MetricDescriptor& d) const noexcept {
+    if (std::uint64_t{d.firstCell} + d.cellCount > header()->maxCells) {
+      return false;
+    }
+    switch (d.kind) {
+      case MetricKind::counter:
+      case MetricKind::gauge:
+        return d.cellCount >= 1;
+      case MetricKind::histogram:
+        return d.cellCount >= 2 && d.subBucketBits >= 1 &&
+               d.subBucketBits <= kMaxSubBucketBits;
+      default:
+        return true;
+    }
+  }
+
+  std::byte* base_ = nullptr;
+};
+
+}  // namespace privat
+
+/**
+ * Реестр метрик поверх сегмента. С пустым именем сегмент анонимный (виден
+ * только своему процессу и fork-потомкам), иначе - shm_open(name), его
+ * удаляет деструктор реестра. Занятое имя - ошибка (EEXIST): чужой живой
+ * сегмент не обнуляется. Options::replace забирает имя себе, отвязав
+ * старый сегмент; его процесс и читатели продолжают работать со старым.
+ * Хэндлы метрик живут не дольше реестра.
+ */
+class MetricsRegistry : private UncopyableUnmovable {
+ public:
+  struct Options {
+    std::uint32_t shards = 0;  // 0 - по числу ядер, до степени двойки
+    std::uint32_t maxMetrics = 256;
+    std::uint32_t maxCells = 1 << 14;  // на шард, по 8 байт
+    bool replace = false;              // отвязать существующий сегмент
+  };
+
+  explicit MetricsRegistry(std::string shmName = {})
+      : MetricsRegistry(std::move(shmName), Options()) {}
+
+  MetricsRegistry(std::string shmName, Options options)
+      : shmName_(std::move(shmName)) {
+    if (options.shards == 0) {
+      const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+      options.shards = std::min(64u, std::bit_ceil(cores));
+    }
+    options.shards = std::bit_ceil(options.shards);
+    options.maxCells = static_cast<std::uint32_t>(
+        (options.maxCells + privat::kCellsPerLine - 1) /
+        privat::kCellsPerLine * privat::kCellsPerLine);
+    bytes_ = privat::MetricsView::segmentBytes(
+        options.shards, options.maxMetrics, options.maxCells);
+
+    int fd = -1;
+    if (!shmName_.empty()) {
+      if (options.replace) {
+        ::shm_unlink(shmName_.c_str());
+      }
+      fd = ::shm_open(shmName_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+                      0600);
+      if (fd < 0) {
+        privat::throwErrno("shm_open");
+      }
+      struct stat st {};
+      if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        ::shm_unlink(shmName_.c_str());
+        privat::throwErrno("fstat");
+      }
+      shmId_ = {st.st_dev, st.st_ino};
+    }
+    SCOPE_EXIT {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    };
+    SCOPE_FAIL {
+      if (fd >= 0) {
+        ::shm_unlink(shmName_.c_str());
+      }
+    };
+    if (fd >= 0 && ::ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+      privat::throwErrno("ftruncate");
+    }
+    void* base = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                        fd >= 0 ? MAP_SHARED : MAP_SHARED | MAP_ANONYMOUS, fd,
+                        0);
+    if (base == MAP_FAILED) {
+      privat::throwErrno("mmap");
+    }
+    base_ = static_cast<std::byte*>(base);
+
+    // Сегмент обнулён: нули - корректные начальные значения всех ячеек.
+    auto* header = new (base_) privat::MetricsHeader{};
+    header->shards = options.shards;
+    header->maxMetrics = options.maxMetrics;
+    header->maxCells = options.maxCells;
+    header->cellsOffset = privat::MetricsView::cellsOffset(options.maxMetrics);
+    std::memcpy(header->magic, privat::kMetricsMagic,
+                sizeof(privat::kMetricsMagic));
+    view_ = privat::MetricsView(base_, bytes_);
+  }
+
+  ~MetricsRegistry() {
+    ::munmap(base_, bytes_);
+    if (!shmName_.empty() && ownsName()) {
+      ::shm_unlink(shmName_.c_str());
+    }
+  }
+
+  // Повторная регистрация того же имени и типа возвращает ту же метрику.
+  Counter counter(std::string_view name) {
+    return Counter(view_.cells(add(name, MetricKind::counter, 1, 0)));
+  }
+
+  Gauge gauge(std::string_view name) {
+    return Gauge(view_.cells(add(name, MetricKind::gauge, 1, 0)).base);
+  }
+
+  /**
+   * subBucketBits задаёт точность (погрешность до 2^-subBucketBits),
+   * maxValue - верхнюю границу различимых значений.
+   */
+  Histogram histogram(std::string_view name, unsigned subBucketBits = 4,
+                      std::uint64_t maxValue = std::uint64_t{1} << 36) {
+    if (subBucketBits == 0 || subBucketBits > privat::kMaxSubBucketBits) {
+      throw std::invalid_argument("histogram: subBucketBits out of range");
+    }
+    const std::size_t buckets =
+        privat::histogramBucket(std::max<std::uint64_t>(maxValue, 1),
+                                subBucketBits) +
+        1;
+    const privat::MetricDescriptor& d =
+        add(name, MetricKind::histogram, 1 + buckets, subBucketBits);
+    return Histogram(view_.cells(d), d.subBucketBits, d.cellCount - 1);
+  }
+
+  std::vector<MetricSample> snapshot() const { return view_.snapshot(); }
+
+  const std::string& shmName() const noexcept { return shmName_; }
+  std::size_t segmentBytes() const noexcept { return bytes_; }
+  std::uint32_t shards() const noexcept { return view_.header()->shards; }
+
+ private:
+  // Имя всё ещё наше, а не перехвачено реестром с Options::replace.
+  bool ownsName() const noexcept {
+    const int fd = ::shm_open(shmName_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st {};
+    const bool same = ::fstat(fd, &st) == 0 && st.st_dev == shmId_.first &&
+                      st.st_ino == shmId_.second;
+    ::close(fd);
+    return same;
+  }
+
+  const privat::MetricDescriptor& add(std::string_view name, MetricKind kind,
+                                      std::size_t cells,
+                                      std::uint32_t subBucketBits) {
+    if (name.empty() || name.size() >= privat::kMetricNameSize) {
+      throw std::invalid_argument("metric name length");
+    }
+    std::lock_guard lock(mutex_);
+    privat::MetricsHeader& header = *view_.header();
+    const std::uint32_t count = header.count.load(std::memory_order_relaxed);
+    privat::MetricDescriptor* descriptors = view_.descriptors();
+    for (std::uint32_t i = 0; i < count; ++i) {
+      if (name == descriptors[i].name) {
+        if (descriptors[i].kind != kind ||
+            descriptors[i].cellCount != cells) {
+          throw std::logic_error("metric re-registered with another type");
+        }
+        return descriptors[i];
+      }
+    }
+    if (count == header.maxMetrics || nextCell_ + cells > header.maxCells) {
+      throw std::length_error("metrics segment is full");
+    }
+    privat::MetricDescriptor& d = descriptors[count];
+    std::memcpy(d.name, name.data(), name.size());
+    d.kind = kind;
+    d.firstCell = static_cast<std::uint32_t>(nextCell_);
+    d.cellCount = static_cast<std::uint32_t>(cells);
+    d.subBucketBits = subBucketBits;
+    // Каждая метрика с новой кэш-линии: горячие ячейки разных метрик
+    // одного шарда не делят линию с редкими.
+    nextCell_ += (cells + privat::kCellsPerLine - 1) / privat::kCellsPerLine *
+                 privat::kCellsPerLine;
+    header.count.store(count + 1, std::memory_order_release);
+    return d;
+  }
+
+  std::string shmName_;
+  std::pair<dev_t, ino_t> shmId_{};
+  std::byte* base_ = nullptr;
+  std::size_t bytes_ = 0;
+  privat::MetricsView view_;
+  std::mutex mutex_;
+  std::size_t nextCell_ = 0;
+};
+
+/**
+ * Снимки чужого сегмента по имени, только чтение: наблюдаемый процесс
+ * ничего не делает ради сбора, все загрузки ячеек идут отсюда.
+ */
+class MetricsReader : private UncopyableUnmovable {
+ public:
+  explicit MetricsReader(const std::string& shmName) {
+    const int fd = ::shm_open(shmName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+      privat::throwErrno("shm_open");
+    }
+    SCOPE_EXIT { ::close(fd); };
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      privat::throwErrno("fstat");
+    }
+    bytes_ = static_cast<std::size_t>(st.st_size);
+    void* base = ::mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      privat::throwErrno("mmap");
+    }
+    base_ = static_cast<std::byte*>(base);
+    SCOPE_FAIL { ::munmap(base_, bytes_); };
+    view_ = privat::MetricsView(base_, bytes_);
+  }
+  ~MetricsReader() { ::munmap(base_, bytes_); }
+
+  std::vector<MetricSample> snapshot() const { return view_.snapshot(); }
+
+ private:
+  std::byte* base_ = nullptr;
+  std::size_t bytes_ = 0;
+  privat::MetricsView view_;
+};
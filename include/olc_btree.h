@@ -0,0 +1,501 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "core.h"
+#include "scope_guard.h"
+
+/**
+ * OlcBTreeMap - B+дерево для сценария "много читателей, редкие писатели" с
+ * оптимистичной блокировкой узлов (optimistic lock coupling).
+ *
+ * Читатели не пишут в разделяемую память: каждый узел несёт счётчик версий,
+ * читатель запоминает версию, читает узел и перепроверяет её, а при спуске
+ * проверяет версию родителя уже после чтения версии ребёнка. Конфликт с
+ * писателем - повтор с корня. Писатели упорядочены мьютексом и помечают
+ * изменяемые узлы нечётной версией на время изменения.
+ *
+ * Ограничения ради простоты и корректности без UB:
+ *  - Key и T тривиально копируемые и lock-free как std::atomic: читатель
+ *    получает копию значения, а не ссылку;
+ *  - erase не сливает узлы, и узлы не освобождаются до clear() или
+ *    разрушения дерева, поэтому читатель никогда не трогает освобождённую
+ *    память и обходится без схемы отложенного освобождения;
+ *  - clear() и деструктор нельзя вызывать параллельно с читателями.
+ */
+
+namespace privat {
+
+// Seqlock-версия узла: нечётное значение - узел изменяется писателем.
+class OptimisticLock {
+ public:
+  std::uint64_t readBegin() const noexcept {
+    std::uint64_t v = version_.load(std::memory_order_acquire);
+    while (v & 1) {
+      v = version_.load(std::memory_order_acquire);
+    }
+    return v;
+  }
+
+  bool validate(std::uint64_t v) const noexcept {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == v;
+  }
+
+  // Писатели сериализованы снаружи, поэтому CAS не нужен.
+  void lock() noexcept {
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void unlock() noexcept {
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+  }
+
+ private:
+  std::atomic<std::uint64_t> version_{0};
+};
+
+}  // namespace privat
+
+template <typename Key, typename T, std::size_t NodeBytes = 256>
+class OlcBTreeMap : private UncopyableUnmovable {
+  static_assert(std::is_trivially_copyable_v<Key> &&
+                    std::is_trivially_copyable_v<T>,
+                "OlcBTreeMap stores trivially copyable keys and values");
+  static_assert(std::atomic<Key>::is_always_lock_free &&
+                    std::atomic<T>::is_always_lock_free,
+                "OlcBTreeMap needs lock-free atomic keys and values");
+  static_assert(NodeBytes >= 128, "NodeBytes is too small");
+
+  static constexpr std::size_t kCacheLine = 64;
+
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using size_type = std::size_t;
+
+  static constexpr std::size_t kLeafCapacity = std::max<std::size_t>(
+      4, (NodeBytes - 4 * sizeof(void*)) / (sizeof(Key) + sizeof(T)));
+  static constexpr std::size_t kInnerCapacity = std::max<std::size_t>(
+      4, (NodeBytes - 3 * sizeof(void*)) / (sizeof(Key) + sizeof(void*)));
+
+  OlcBTreeMap() = default;
+  ~OlcBTreeMap() { clear(); }
+
+  std::optional<T> find(const Key& key) const {
+    while (true) {
+      auto [leaf, version] = findLeaf(key);
+      if (!leaf) {
+        return std::nullopt;
+      }
+      const std::size_t size = clampSize(leaf, kLeafCapacity);
+      const std::size_t pos = countLess(leaf->keys, size, key);
+      const bool found =
+          pos < size && leaf->keys[pos].load(std::memory_order_relaxed) == key;
+      const T value = found ? leaf->values[pos].load(std::memory_order_relaxed)
+                            : T{};
+      if (leaf->lock.validate(version)) {
+        return found ? std::optional<T>(value) : std::nullopt;
+      }
+    }
+  }
+
+  bool contains(const Key& key) const { return find(key).has_value(); }
+
+  /**
+   * Вызывает fn(key, value) для не более чем limit элементов с ключами не
+   * меньше from по возрастанию. Каждый лист копируется и проверяется
+   * целиком, fn видит только согласованные данные, но не единый снимок
+   * дерева: параллельные изменения в уже пройденных листьях не видны.
+   */
+  template <typename Fn>
+  std::size_t scan(const Key& from, std::size_t limit, Fn&& fn) const {
+    std::size_t emitted = 0;
+    Key lower = from;
+    bool inclusive = true;
+    Key keys[kLeafCapacity];
+    T values[kLeafCapacity];
+    while (emitted < limit) {
+      auto [leaf, version] = findLeaf(lower);
+      while (leaf && emitted < limit) {
+        const std::size_t size = clampSize(leaf, kLeafCapacity);
+        for (std::size_t i = 0; i < size; ++i) {
+          keys[i] = leaf->keys[i].load(std::memory_order_relaxed);
+          values[i] = leaf->values[i].load(std::memory_order_relaxed);
+        }
+        const Leaf* next = leaf->next.load(std::memory_order_acquire);
+        const std::uint64_t nextVersion = next ? next->lock.readBegin() : 0;
+        if (!leaf->lock.validate(version)) {
+          break;  // лист изменился: спускаемся заново от последнего ключа
+        }
+        for (std::size_t i = 0; i < size && emitted < limit; ++i) {
+          if (keys[i] < lower || (!inclusive && !(lower < keys[i]))) {
+            continue;
+          }
+          fn(keys[i], values[i]);
+          ++emitted;
+          lower = keys[i];
+          inclusive = false;
+        }
+        leaf = next;
+        version = nextVersion;
+      }
+      if (!leaf) {
+        break;
+      }
+    }
+    return emitted;
+  }
+
+  size_type size() const noexcept {
+    return size_.load(std::memory_order_relaxed);
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+  // true, если ключа не было; существующее значение не трогает.
+  bool insert(const Key& key, const T& value) {
+    return put</*Assign=*/false>(key, value);
+  }
+
+  // Вставляет или перезаписывает; true, если ключа не было.
+  bool insertOrAssign(const Key& key, const T& value) {
+    return put</*Assign=*/true>(key, value);
+  }
+
+  // Узлы не сливаются: лист может опустеть, но остаётся в дереве.
+  bool erase(const Key& key) {
+    std::lock_guard lock(writer_);
+    if (!root_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    Path path;
+    std::size_t depth = 0;
+    Leaf* leaf = descend(key, path, depth);
+    const std::size_t size = load(leaf->size);
+    const std::size_t pos = countLess(leaf->keys, size, key);
+    if (pos == size || !(load(leaf->keys[pos]) == key)) {
+      return false;
+    }
+    leaf->lock.lock();
+    for (std::size_t i = pos + 1; i < size; ++i) {
+      store(leaf->keys[i - 1], load(leaf->keys[i]));
+      store(leaf->values[i - 1], load(leaf->values[i]));
+    }
+    store(leaf->size, size - 1);
+    leaf->lock.unlock();
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void clear() {
+    std::lock_guard lock(writer_);
+    if (Node* node = root_.exchange(nullptr, std::memory_order_relaxed)) {
+      destroy(node);
+    }
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  struct Node;
+  struct Leaf;
+  struct Inner;
+
+  template <bool Assign>
+  bool put(const Key& key, const T& value) {
+    std::lock_guard lock(writer_);
+    Node* rootNode = root_.load(std::memory_order_relaxed);
+    if (!rootNode) {
+      Leaf* leaf = new Leaf();
+      store(leaf->keys[0], key);
+      store(leaf->values[0], value);
+      store(leaf->size, std::size_t{1});
+      root_.store(leaf, std::memory_order_release);
+      size_.store(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    Path path;
+    std::size_t depth = 0;
+    Leaf* leaf = descend(key, path, depth);
+    const std::size_t size = load(leaf->size);
+    std::size_t pos = countLess(leaf->keys, size, key);
+    if (pos < size && load(leaf->keys[pos]) == key) {
+      if constexpr (Assign) {
+        leaf->lock.lock();
+        store(leaf->values[pos], value);
+        leaf->lock.unlock();
+      }
+      return false;
+    }
+
+    // Узлы для разделения выделяются до первого изменения: если new бросит
+    // после разделения листа, правая половина будет видна только через next.
+    SplitNodes spare;
+    if (size == kLeafCapacity) {
+      reserveSplit(path, depth, spare);
+    }
+
+    // Все изменённые узлы остаются заблокированными, пока родители не
+    // получат новый разделитель: иначе читатель пройдёт в половину листа.
+    Node* locked[64 + 2];
+    std::size_t lockedCount = 0;
+    SCOPE_EXIT {
+      for (std::size_t i = 0; i < lockedCount; ++i) {
+        locked[i]->lock.unlock();
+      }
+    };
+    leaf->lock.lock();
+    locked[lockedCount++] = leaf;
+
+    if (size < kLeafCapacity) {
+      leafInsert(leaf, pos, key, value);
+    } else {
+      Leaf* right = std::exchange(spare.leaf, nullptr);
+      const std::size_t keep = size / 2;
+      for (std::size_t i = keep; i < size; ++i) {
+        store(right->keys[i - keep], load(leaf->keys[i]));
+        store(right->values[i - keep], load(leaf->values[i]));
+      }
+      store(right->size, size - keep);
+      right->next.store(leaf->next.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+      store(leaf->size, keep);
+      leaf->next.store(right, std::memory_order_release);
+      if (pos > keep) {
+        leafInsert(right, pos - keep, key, value);
+      } else {
+        leafInsert(leaf, pos, key, value);
+      }
+      insertIntoParent(path, depth, load(right->keys[0]), right, spare,
+                       locked, lockedCount);
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  struct Node {
+    explicit Node(bool isLeaf) noexcept : leaf(isLeaf) {}
+    privat::OptimisticLock lock;
+    std::atomic<std::size_t> size{0};
+    const bool leaf;
+  };
+
+  struct alignas(kCacheLine) Leaf : Node {
+    Leaf() noexcept : Node(true) {}
+    std::atomic<Leaf*> next{nullptr};
+    std::atomic<Key> keys[kLeafCapacity];
+    std::atomic<T> values[kLeafCapacity];
+  };
+
+  struct alignas(kCacheLine) Inner : Node {
+    Inner() noexcept : Node(false) {}
+    std::atomic<Key> keys[kInnerCapacity];
+    std::atomic<Node*> children[kInnerCapacity + 1];
+  };
+
+  struct PathEntry {
+    Inner* node;
+    std::size_t idx;
+  };
+  using Path = PathEntry[64];
+
+  struct LeafVersion {
+    const Leaf* leaf;
+    std::uint64_t version;
+  };
+
+  // Писатель - единственный, кто меняет узлы, ему достаточно relaxed.
+  template <typename U>
+  static U load(const std::atomic<U>& a) noexcept {
+    return a.load(std::memory_order_relaxed);
+  }
+  template <typename U>
+  static void store(std::atomic<U>& a, U value) noexcept {
+    a.store(value, std::memory_order_relaxed);
+  }
+
+  // Размер, прочитанный без блокировки, может быть мусорным - до проверки
+  // версии его нельзя использовать как индекс без ограничения.
+  static std::size_t clampSize(const Node* node, std::size_t cap) noexcept {
+    return std::min(load(node->size), cap);
+  }
+
+  static std::size_t countLess(const std::atomic<Key>* keys, std::size_t n,
+                               const Key& key) noexcept {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      count += static_cast<std::size_t>(load(keys[i]) < key);
+    }
+    return count;
+  }
+
+  static std::size_t childIndex(const Inner* inner, std::size_t n,
+                                const Key& key) noexcept {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      count += static_cast<std::size_t>(!(key < load(inner->keys[i])));
+    }
+    return count;
+  }
+
+  LeafVersion findLeaf(const Key& key) const {
+  restart:
+    const Node* node = root_.load(std::memory_order_acquire);
+    if (!node) {
+      return {nullptr, 0};
+    }
+    std::uint64_t version = node->lock.readBegin();
+    if (root_.load(std::memory_order_acquire) != node) {
+      goto restart;
+    }
+    while (!node->leaf) {
+      const Inner* inner = static_cast<const Inner*>(node);
+      const std::size_t idx =
+          childIndex(inner, clampSize(inner, kInnerCapacity), key);
+      const Node* child = inner->children[idx].load(std::memory_order_acquire);
+      if (!inner->lock.validate(version)) {
+        goto restart;
+      }
+      const std::uint64_t childVersion = child->lock.readBegin();
+      if (!inner->lock.validate(version)) {
+        goto restart;
+      }
+      node = child;
+      version = childVersion;
+    }
+    return {static_cast<const Leaf*>(node), version};
+  }
+
+  Leaf* descend(const Key& key, Path& path, std::size_t& depth) const {
+    Node* node = root_.load(std::memory_order_relaxed);
+    while (!node->leaf) {
+      Inner* inner = static_cast<Inner*>(node);
+      const std::size_t idx = childIndex(inner, load(inner->size), key);
+      path[depth++] = {inner, idx};
+      node = load(inner->children[idx]);
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  static void leafInsert(Leaf* leaf, std::size_t pos, const Key& key,
+                         const T& value) noexcept {
+    const std::size_t size = load(leaf->size);
+    for (std::size_t i = size; i > pos; --i) {
+      store(leaf->keys[i], load(leaf->keys[i - 1]));
+      store(leaf->values[i], load(leaf->values[i - 1]));
+    }
+    store(leaf->keys[pos], key);
+    store(leaf->values[pos], value);
+    store(leaf->size, size + 1);
+  }
+
+  // Запас на одно разделение: лист, внутренние узлы для полных уровней пути
+  // снизу вверх и корень, если полон весь путь. Неиспользованное удаляется.
+  struct SplitNodes : private UncopyableUnmovable {
+    ~SplitNodes() {
+      delete leaf;
+      for (std::size_t i = 0; i < count; ++i) {
+        delete inners[i];
+      }
+    }
+
+    Inner* takeInner() noexcept { return inners[--count]; }
+
+    Leaf* leaf = nullptr;
+    Inner* inners[std::extent_v<Path> + 1] = {};
+    std::size_t count = 0;
+  };
+
+  static void reserveSplit(const Path& path, std::size_t depth,
+                           SplitNodes& spare) {
+    spare.leaf = new Leaf();
+    while (depth > 0 && load(path[depth - 1].node->size) == kInnerCapacity) {
+      spare.inners[spare.count++] = new Inner();
+      --depth;
+    }
+    if (depth == 0) {
+      spare.inners[spare.count++] = new Inner();
+    }
+  }
+
+  void insertIntoParent(Path& path, std::size_t depth, Key separator,
+                        Node* right, SplitNodes& spare, Node** locked,
+                        std::size_t& lockedCount) noexcept {
+    while (depth > 0) {
+      auto [parent, idx] = path[--depth];
+      parent->lock.lock();
+      locked[lockedCount++] = parent;
+      const std::size_t size = load(parent->size);
+      if (size < kInnerCapacity) {
+        for (std::size_t i = size; i > idx; --i) {
+          store(parent->keys[i], load(parent->keys[i - 1]));
+          store(parent->children[i + 1], load(parent->children[i]));
+        }
+        store(parent->keys[idx], separator);
+        store(parent->children[idx + 1], right);
+        store(parent->size, size + 1);
+        return;
+      }
+
+      Key keys[kInnerCapacity + 1];
+      Node* children[kInnerCapacity + 2];
+      for (std::size_t i = 0, j = 0; i <= kInnerCapacity; ++i) {
+        keys[i] = i == idx ? separator : load(parent->keys[j++]);
+      }
+      for (std::size_t i = 0, j = 0; i <= kInnerCapacity + 1; ++i) {
+        children[i] = i == idx + 1 ? right : load(parent->children[j++]);
+      }
+      const std::size_t mid = (kInnerCapacity + 1) / 2;
+      Inner* sibling = spare.takeInner();
+      for (std::size_t i = 0; i < mid; ++i) {
+        store(parent->keys[i], keys[i]);
+        store(parent->children[i], children[i]);
+      }
+      store(parent->children[mid], children[mid]);
+      store(parent->size, mid);
+      const std::size_t rightSize = kInnerCapacity - mid;
+      for (std::size_t i = 0; i < rightSize; ++i) {
+        store(sibling->keys[i], keys[mid + 1 + i]);
+        store(sibling->children[i], children[mid + 1 + i]);
+      }
+      store(sibling->children[rightSize], children[kInnerCapacity + 1]);
+      store(sibling->size, rightSize);
+      separator = keys[mid];
+      right = sibling;
+    }
+
+    // Новый корень публикуется, пока старый ещё заблокирован: читатель,
+    // успевший взять старый корень, перепроверит указатель и начнёт заново.
+    Inner* root = spare.takeInner();
+    store(root->keys[0], separator);
+    store(root->children[0], root_.load(std::memory_order_relaxed));
+    store(root->children[1], right);
+    store(root->size, std::size_t{1});
+    root_.store(root, std::memory_order_release);
+  }
+
+  static void destroy(Node* node) noexcept {
+    if (node->leaf) {
+      delete static_cast<Leaf*>(node);
+      return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for (std::size_t i = 0; i <= load(inner->size); ++i) {
+      destroy(load(inner->children[i]));
+    }
+    delete inner;
+  }
+
+  std::atomic<Node*> root_{nullptr};
+  std::atomic<std::size_t> size_{0};
+  std::mutex writer_;
+};
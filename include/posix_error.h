@@ -0,0 +1,12 @@
+#pragma once
+#include <cerrno>
+#include <system_error>
+
+namespace privat {
+
+// Ошибка системного вызова: errno в std::system_error.
+[[noreturn]] inline void throwErrno(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+}  // namespace privat
@@ -0,0 +1,630 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+#include "scope_guard.h"
+
+/**
+ * Безопасное освобождение памяти для lock-free структур.
+ *
+ * EpochDomain - эпохи (Fraser): чтение стоит одной записи в свою ячейку и
+ * одного барьера на вход в критическую секцию, удалённые объекты копятся в
+ * пер-поточных пачках и освобождаются, когда все активные потоки сдвинулись
+ * на две эпохи вперёд. Зависший читатель задерживает всё освобождение.
+ *
+ * HazardPointerDomain - hazard pointers (Michael): каждый защищаемый
+ * указатель публикуется отдельно, зато количество неосвобождённого мусора
+ * ограничено O(потоков * слотов).
+ *
+ * Оба домена принимают удаляемые объекты вместе с deleter'ом: по умолчанию
+ * это delete, но можно передать, например, пул. Домен должен пережить все
+ * операции над ним; при разрушении домена всё накопленное освобождается.
+ */
+
+namespace privat {
+
+/**
+ * Удалённый объект вместе со способом его освободить. context указывает на
+ * deleter с состоянием (например, пул), для stateless deleter'а он пуст.
+ */
+struct Retired {
+  void* ptr;
+  void (*reclaim)(void* ptr, void* context);
+  void* context;
+  std::uint64_t epoch;
+
+  void operator()() const { reclaim(ptr, context); }
+};
+
+template <typename T, typename Deleter>
+Retired makeRetired(T* ptr) noexcept {
+  static_assert(std::is_empty_v<Deleter> &&
+                    std::is_default_constructible_v<Deleter>,
+                "pass deleters with state by reference");
+  return {ptr, [](void* p, void*) { Deleter{}(static_cast<T*>(p)); }, nullptr,
+          0};
+}
+
+template <typename T, typename Deleter>
+Retired makeRetired(T* ptr, Deleter& deleter) noexcept {
+  return {ptr,
+          [](void* p, void* context) {
+            (*static_cast<Deleter*>(context))(static_cast<T*>(p));
+          },
+          std::addressof(deleter), 0};
+}
+
+/**
+ * Данные потока, привязанные к конкретному домену. Кэш потока держит только
+ * weak_ptr на состояние домена: разрушение домена сразу освобождает его
+ * состояние, а записи мёртвых доменов выбрасываются из кэша при следующем
+ * промахе. При выходе потока его записи возвращаются ещё живым доменам;
+ * lock() не даёт состоянию умереть посреди releaseLocal.
+ */
+template <typename State>
+typename State::Local& threadLocalFor(const std::shared_ptr<State>& state) {
+  struct Entry {
+    std::weak_ptr<State> state;
+    // Адрес сравнивается только у живых записей: пока weak_ptr не истёк,
+    // по этому адресу не может оказаться другое состояние.
+    const State* key;
+    typename State::Local* local;
+  };
+  struct Cache {
+    ~Cache() {
+      for (Entry& entry : entries) {
+        if (std::shared_ptr<State> alive = entry.state.lock()) {
+          alive->releaseLocal(entry.local);
+        }
+      }
+    }
+    std::vector<Entry> entries;
+  };
+  thread_local Cache cache;
+  for (Entry& entry : cache.entries) {
+    if (entry.key == state.get() && !entry.state.expired()) {
+      return *entry.local;
+    }
+  }
+  // Записи мёртвых доменов указывают в уже освобождённую память.
+  std::erase_if(cache.entries,
+                [](const Entry& entry) { return entry.state.expired(); });
+  typename State::Local* local = state->acquireLocal();
+  cache.entries.push_back({state, state.get(), local});
+  return *local;
+}
+
+/**
+ * Lock-free список записей, которые никогда не удаляются до разрушения
+ * состояния домена: освободившиеся записи переиспользуются другими потоками.
+ */
+template <typename Record>
+class RecordList : UncopyableUnmovable {
+ public:
+  RecordList() noexcept = default;
+  ~RecordList() {
+    Record* record = head_.load(std::memory_order_acquire);
+    while (record) {
+      delete std::exchange(record, record->next_);
+    }
+  }
+
+  Record* acquire() {
+    for (Record* r = head(); r; r = r->next_) {
+      bool expected = false;
+      if (!r->inUse_.load(std::memory_order_relaxed) &&
+          r->inUse_.compare_exchange_strong(expected, true,
+                                            std::memory_order_acquire)) {
+        return r;
+      }
+    }
+    Record* record = new Record();
+    record->inUse_.store(true, std::memory_order_relaxed);
+    record->next_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(record->next_, record,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return record;
+  }
+
+  static void release(Record* record) noexcept {
+    record->inUse_.store(false, std::memory_order_release);
+  }
+
+  Record* head() const noexcept {
+    return head_.load(std::memory_order_acquire);
+  }
+  std::size_t count() const noexcept {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<Record*> head_{nullptr};
+  std::atomic<std::size_t> count_{0};
+};
+
+/**
+ * Мусор потоков, которые завершились, не дождавшись его освобождения.
+ * Забирается любым потоком при следующей чистке.
+ */
+class OrphanList {
+ public:
+  void adopt(std::vector<Retired>& retired) {
+    if (retired.empty()) {
+      return;
+    }
+    std::lock_guard lock(mutex_);
+    orphans_.insert(orphans_.end(), retired.begin(), retired.end());
+    retired.clear();
+    nonEmpty_.store(true, std::memory_order_release);
+  }
+
+  void takeInto(std::vector<Retired>& retired) {
+    if (!nonEmpty_.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::unique_lock lock(mutex_, std::try_to_lock);
+    if (!lock) {
+      return;
+    }
+    retired.insert(retired.end(), orphans_.begin(), orphans_.end());
+    orphans_.clear();
+    nonEmpty_.store(false, std::memory_order_relaxed);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<Retired> orphans_;
+  std::atomic<bool> nonEmpty_{false};
+};
+
+/**
+ * Освобождает из retired всё, что разрешает predicate, и оставляет
+ * остальное. Deleter может сам вызвать retire: новые записи попадают в
+ * retired уже после того, как готовые вынесены во временный буфер.
+ */
+template <typename Predicate>
+void reclaimIf(std::vector<Retired>& retired, std::vector<Retired>& scratch,
+               Predicate canReclaim) {
+  auto keep = std::partition(retired.begin(), retired.end(),
+                             [&](const Retired& r) { return !canReclaim(r); });
+  scratch.assign(keep, retired.end());
+  retired.erase(keep, retired.end());
+  SCOPE_EXIT { scratch.clear(); };
+  for (const Retired& r : scratch) {
+    r();
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+struct EpochState : UncopyableUnmovable {
+  // Глобальная эпоха начинается с 1, 0 - поток вне критической секции.
+  static constexpr std::uint64_t kQuiescent = 0;
+
+  struct Local {
+    std::atomic<std::uint64_t> epoch_{kQuiescent};
+    std::atomic<bool> inUse_{false};
+    Local* next_ = nullptr;
+    std::uint32_t nesting_ = 0;
+    bool reclaiming_ = false;
+    std::vector<Retired> retired_;
+    std::vector<Retired> scratch_;
+  };
+
+  explicit EpochState(std::size_t batch) : batch_(batch) {}
+
+  ~EpochState() { drain(); }
+
+  // Освобождает весь мусор всех потоков. Вызывается, когда доменом уже
+  // никто не пользуется.
+  void drain() {
+    std::vector<Retired> all;
+    orphans_.takeInto(all);
+    for (Local* local = records_.head(); local; local = local->next_) {
+      all.insert(all.end(), local->retired_.begin(), local->retired_.end());
+      local->retired_.clear();
+    }
+    for (const Retired& r : all) {
+      r();
+    }
+  }
+
+  Local* acquireLocal() { return records_.acquire(); }
+
+  void releaseLocal(Local* local) {
+    assert(local->nesting_ == 0 && "thread exited inside a critical section");
+    orphans_.adopt(local->retired_);
+    RecordList<Local>::release(local);
+  }
+
+  void enter(Local& local) noexcept {
+    if (local.nesting_++ != 0) {
+      return;
+    }
+    std::uint64_t epoch = global_.load(std::memory_order_relaxed);
+    while (true) {
+      local.epoch_.store(epoch, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const std::uint64_t now = global_.load(std::memory_order_relaxed);
+      if (now == epoch) {
+        break;
+      }
+      epoch = now;
+    }
+  }
+
+  void exit(Local& local) noexcept {
+    assert(local.nesting_ > 0);
+    if (--local.nesting_ == 0) {
+      local.epoch_.store(kQuiescent, std::memory_order_release);
+    }
+  }
+
+  void retire(Local& local, Retired retired) {
+    retired.epoch = global_.load(std::memory_order_acquire);
+    local.retired_.push_back(retired);
+    if (local.retired_.size() >= batch_) {
+      collect(local);
+    }
+  }
+
+  // Эпоха сдвигается, только если все активные потоки уже в текущей.
+  bool tryAdvance() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t epoch = global_.load(std::memory_order_relaxed);
+    for (Local* local = records_.head(); local; local = local->next_) {
+      const std::uint64_t seen = local->epoch_.load(std::memory_order_acquire);
+      if (seen != kQuiescent && seen != epoch) {
+        return false;
+      }
+    }
+    return global_.compare_exchange_strong(epoch, epoch + 1,
+                                           std::memory_order_acq_rel);
+  }
+
+  void collect(Local& local) {
+    if (local.reclaiming_) {
+      return;
+    }
+    local.reclaiming_ = true;
+    SCOPE_EXIT { local.reclaiming_ = false; };
+    orphans_.takeInto(local.retired_);
+    tryAdvance();
+    const std::uint64_t epoch = global_.load(std::memory_order_acquire);
+    reclaimIf(local.retired_, local.scratch_,
+              [epoch](const Retired& r) { return r.epoch + 2 <= epoch; });
+  }
+
+  std::atomic<std::uint64_t> global_{1};
+  const std::size_t batch_;
+  RecordList<Local> records_;
+  OrphanList orphans_;
+};
+
+// ---------------------------------------------------------------------------
+
+struct HazardState : UncopyableUnmovable {
+  struct Slot {
+    std::atomic<const void*> ptr_{nullptr};
+    std::atomic<bool> inUse_{false};
+    Slot* next_ = nullptr;
+  };
+
+  struct Local {
+    std::atomic<bool> inUse_{false};
+    Local* next_ = nullptr;
+    bool reclaiming_ = false;
+    std::vector<Slot*> freeSlots_;
+    std::vector<Retired> retired_;
+    std::vector<Retired> scratch_;
+    std::vector<const void*> hazards_;
+  };
+
+  explicit HazardState(std::size_t batch) : batch_(batch) {}
+
+  ~HazardState() { drain(); }
+
+  // Освобождает весь мусор всех потоков. Вызывается, когда доменом уже
+  // никто не пользуется.
+  void drain() {
+    std::vector<Retired> all;
+    orphans_.takeInto(all);
+    for (Local* local = locals_.head(); local; local = local->next_) {
+      all.insert(all.end(), local->retired_.begin(), local->retired_.end());
+      local->retired_.clear();
+    }
+    for (const Retired& r : all) {
+      r();
+    }
+  }
+
+  Local* acquireLocal() { return locals_.acquire(); }
+
+  void releaseLocal(Local* local) {
+    for (Slot* slot : local->freeSlots_) {
+      RecordList<Slot>::release(slot);
+    }
+    local->freeSlots_.clear();
+    orphans_.adopt(local->retired_);
+    RecordList<Local>::release(local);
+  }
+
+  Slot* acquireSlot(Local& local) {
+    if (!local.freeSlots_.empty()) {
+      Slot* slot = local.freeSlots_.back();
+      local.freeSlots_.pop_back();
+      return slot;
+    }
+    return slots_.acquire();
+  }
+
+  // Слот остаётся за потоком, чтобы следующий захват обошёлся без CAS.
+  void releaseSlot(Local& local, Slot* slot) {
+    slot->ptr_.store(nullptr, std::memory_order_release);
+    local.freeSlots_.push_back(slot);
+  }
+
+  void retire(Local& local, Retired retired) {
+    local.retired_.push_back(retired);
+    if (local.retired_.size() >= threshold()) {
+      collect(local);
+    }
+  }
+
+  // Порог пропорционален числу слотов: так мусор остаётся ограниченным,
+  // а каждая чистка освобождает хотя бы половину списка.
+  std::size_t threshold() const noexcept {
+    return std::max(batch_, 2 * slots_.count());
+  }
+
+  void collect(Local& local) {
+    if (local.reclaiming_) {
+      return;
+    }
+    local.reclaiming_ = true;
+    SCOPE_EXIT { local.reclaiming_ = false; };
+    orphans_.takeInto(local.retired_);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    local.hazards_.clear();
+    for (Slot* slot = slots_.head(); slot; slot = slot->next_) {
+      if (const void* p = slot->ptr_.load(std::memory_order_acquire)) {
+        local.hazards_.push_back(p);
+      }
+    }
+    std::sort(local.hazards_.begin(), local.hazards_.end());
+    reclaimIf(local.retired_, local.scratch_, [&](const Retired& r) {
+      return !std::binary_search(local.hazards_.begin(), local.hazards_.end(),
+                                 static_cast<const void*>(r.ptr));
+    });
+  }
+
+  const std::size_t batch_;
+  RecordList<Local> locals_;
+  RecordList<Slot> slots_;
+  OrphanList orphans_;
+};
+
+}  // namespace privat
+
+class EpochDomain;
+class HazardPointerDomain;
+
+/**
+ * RAII критическая секция эпохи. Устроена как ScopeGuard: выход из секции
+ * выполняется в деструкторе, dismiss() выходит раньше. Вложенные секции
+ * допустимы. protect() нужен для единообразия с HazardGuard: внутри секции
+ * достаточно обычной acquire-загрузки.
+ */
+class EpochGuard : Moveonly {
+ public:
+  explicit EpochGuard(EpochDomain& domain);
+  EpochGuard(EpochGuard&& other) noexcept
+      : state_(other.state_), local_(std::exchange(other.local_, nullptr)) {}
+  EpochGuard& operator=(EpochGuard&&) = delete;
+  ~EpochGuard() { dismiss(); }
+
+  void dismiss() noexcept {
+    if (local_) {
+      state_->exit(*std::exchange(local_, nullptr));
+    }
+  }
+
+  template <typename T>
+  T* protect(const std::atomic<T*>& src, std::size_t = 0) const noexcept {
+    return src.load(std::memory_order_acquire);
+  }
+
+ private:
+  void* operator new(size_t) = delete;
+  void* operator new[](size_t) = delete;
+
+  privat::EpochState* state_;
+  privat::EpochState::Local* local_;
+};
+
+class EpochDomain : UncopyableUnmovable {
+ public:
+  template <std::size_t>
+  using Guard = EpochGuard;
+
+  // batch - сколько объектов поток копит перед попыткой освобождения.
+  explicit EpochDomain(std::size_t batch = 64)
+      : state_(std::make_shared<privat::EpochState>(batch)) {}
+  ~EpochDomain() { state_->drain(); }
+
+  static EpochDomain& global() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  template <typename T, typename Deleter = std::default_delete<T>>
+  void retire(T* ptr) {
+    state_->retire(local(), privat::makeRetired<T, Deleter>(ptr));
+  }
+
+  template <typename T, typename Deleter>
+  void retire(T* ptr, Deleter& deleter) {
+    state_->retire(local(), privat::makeRetired<T>(ptr, deleter));
+  }
+
+  // Принудительная попытка освободить мусор текущего потока.
+  void collect() { state_->collect(local()); }
+
+  std::uint64_t epoch() const noexcept {
+    return state_->global_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class EpochGuard;
+
+  privat::EpochState::Local& local() {
+    return privat::threadLocalFor(state_);
+  }
+
+  std::shared_ptr<privat::EpochState> state_;
+};
+
+inline EpochGuard::EpochGuard(EpochDomain& domain)
+    : state_(domain.state_.get()), local_(&domain.local()) {
+  state_->enter(*local_);
+}
+
+/**
+ * Набор из N hazard pointer'ов на время жизни объекта. protect() публикует
+ * указатель и перечитывает источник, пока они не совпадут; после этого
+ * объект не будет освобождён, пока слот не сброшен или guard не разрушен.
+ */
+template <std::size_t N>
+class HazardGuard : Moveonly {
+ public:
+  explicit HazardGuard(HazardPointerDomain& domain);
+  HazardGuard(HazardGuard&& other) noexcept
+      : state_(other.state_),
+        local_(std::exchange(other.local_, nullptr)),
+        slots_(other.slots_) {}
+  HazardGuard& operator=(HazardGuard&&) = delete;
+  ~HazardGuard() { dismiss(); }
+
+  void dismiss() noexcept {
+    if (local_) {
+      for (privat::HazardState::Slot* slot : slots_) {
+        state_->releaseSlot(*local_, slot);
+      }
+      local_ = nullptr;
+    }
+  }
+
+  template <typename T>
+  T* protect(const std::atomic<T*>& src, std::size_t index = 0) noexcept {
+    assert(index < N);
+    T* ptr = src.load(std::memory_order_relaxed);
+    while (true) {
+      slots_[index]->ptr_.store(ptr, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      T* again = src.load(std::memory_order_acquire);
+      if (again == ptr) {
+        return ptr;
+      }
+      ptr = again;
+    }
+  }
+
+  // Публикует указатель, достоверность которого вызывающий проверит сам.
+  template <typename T>
+  void set(T* ptr, std::size_t index = 0) noexcept {
+    slots_[index]->ptr_.store(ptr, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void reset(std::size_t index = 0) noexcept {
+    slots_[index]->ptr_.store(nullptr, std::memory_order_release);
+  }
+
+ private:
+  void* operator new(size_t) = delete;
+  void* operator new[](size_t) = delete;
+
+  privat::HazardState* state_;
+  privat::HazardState::Local* local_;
+  privat::HazardState::Slot* slots_[N];
+};
+
+class HazardPointerDomain : UncopyableUnmovable {
+ public:
+  template <std::size_t N>
+  using Guard = HazardGuard<N>;
+
+  // batch - нижняя граница числа объектов, после которой поток сканирует
+  // hazard pointer'ы всех потоков.
+  explicit HazardPointerDomain(std::size_t batch = 64)
+      : state_(std::make_shared<privat::HazardState>(batch)) {}
+  ~HazardPointerDomain() { state_->drain(); }
+
+  static HazardPointerDomain& global() {
+    static HazardPointerDomain domain;
+    return domain;
+  }
+
+  template <typename T, typename Deleter = std::default_delete<T>>
+  void retire(T* ptr) {
+    state_->retire(local(), privat::makeRetired<T, Deleter>(ptr));
+  }
+
+  template <typename T, typename Deleter>
+  void retire(T* ptr, Deleter& deleter) {
+    state_->retire(local(), privat::makeRetired<T>(ptr, deleter));
+  }
+
+  void collect() { state_->collect(local()); }
+
+  std::size_t pending() { return local().retired_.size(); }
+
+ private:
+  template <std::size_t>
+  friend class HazardGuard;
+
+  privat::HazardState::Local& local() {
+    return privat::threadLocalFor(state_);
+  }
+
+  std::shared_ptr<privat::HazardState> state_;
+};
+
+template <std::size_t N>
+HazardGuard<N>::HazardGuard(HazardPointerDomain& domain)
+    : state_(domain.state_.get()), local_(&domain.local()), slots_() {
+  std::size_t acquired = 0;
+  SCOPE_FAIL {
+    for (std::size_t i = 0; i < acquired; ++i) {
+      state_->releaseSlot(*local_, slots_[i]);
+    }
+  };
+  for (; acquired < N; ++acquired) {
+    slots_[acquired] = state_->acquireSlot(*local_);
+  }
+}
+
+[[nodiscard]] inline EpochGuard makeEpochGuard(EpochDomain& domain) {
+  return EpochGuard(domain);
+}
+
+template <std::size_t N = 1>
+[[nodiscard]] HazardGuard<N> makeHazardGuard(HazardPointerDomain& domain) {
+  return HazardGuard<N>(domain);
+}
+
+// Критическая секция эпохи до конца текущей области видимости.
+#define SCOPE_EPOCH(domain) \
+  EpochGuard ANONYMOUS_VARIABLE(SCOPE_EPOCH_STATE)(domain)
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "traits.h"
+
+/**
+ * Алгоритмы перемещения объектов в сырую память ("relocation"): перенос =
+ * move-конструирование в новом месте плюс разрушение старого объекта. Для
+ * тривиально перемещаемых типов (is_trivially_relocatable) это один memcpy
+ * или memmove на весь диапазон вместо цикла по элементам.
+ *
+ * После переноса исходная память считается сырой: деструкторы у неё
+ * вызывать нельзя.
+ */
+
+template <typename T>
+inline constexpr bool is_nothrow_relocatable_v =
+    is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>;
+
+// Переносит *src в сырую память dst.
+template <typename T>
+T* relocate_at(T* src, T* dst) noexcept(is_nothrow_relocatable_v<T>) {
+  if constexpr (is_trivially_relocatable_v<T>) {
+    std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src),
+                sizeof(T));
+    return std::launder(dst);
+  } else {
+    T* result = ::new (static_cast<void*>(dst)) T(std::move(*src));
+    std::destroy_at(src);
+    return result;
+  }
+}
+
+/**
+ * Переносит [first, last) в сырую память, начинающуюся с dest; диапазоны не
+ * пересекаются. Возвращает конец нового диапазона.
+ *
+ * Если перенос может бросить, сначала все элементы конструируются в dest и
+ * только потом разрушаются исходные: при исключении построенное удаляется,
+ * а копируемый исходный диапазон остаётся нетронутым (строгая гарантия).
+ */
+template <typename T>
+T* uninitialized_relocate(T* first, T* last, T* dest) noexcept(
+    is_nothrow_relocatable_v<T>) {
+  const auto count = static_cast<std::size_t>(last - first);
+  if constexpr (is_trivially_relocatable_v<T>) {
+    if (count != 0) {
+      std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first),
+                  count * sizeof(T));
+    }
+    return dest + count;
+  } else if constexpr (std::is_nothrow_move_constructible_v<T>) {
+    for (; first != last; ++first, ++dest) {
+      ::new (static_cast<void*>(dest)) T(std::move(*first));
+      std::destroy_at(first);
+    }
+    return dest;
+  } else {
+    // Как std::move_if_noexcept: копия, если она есть, не портит источник.
+    T* end = nullptr;
+    if constexpr (std::is_copy_constructible_v<T>) {
+      end = std::uninitialized_copy(first, last, dest);
+    } else {
+      end = std::uninitialized_move(first, last, dest);
+    }
+    std::destroy(first, last);
+    return end;
+  }
+}
+
+/**
+ * Переносит [first, last) в dest с учётом перекрытия (как memmove): вставка
+ * и удаление в середине вектора сдвигают хвост на месте. Требует
+ * небросающего переноса, иначе при исключении в середине остались бы дыры.
+ */
+template <typename T>
+T* relocate(T* first, T* last, T* dest) noexcept {
+  static_assert(is_nothrow_relocatable_v<T>,
+                "overlapping relocate needs a nothrow move constructor or a "
+                "trivially relocatable type");
+  const auto count = static_cast<std::size_t>(last - first);
+  if constexpr (is_trivially_relocatable_v<T>) {
+    if (count != 0) {
+      std::memmove(static_cast<void*>(dest), static_cast<const void*>(first),
+                   count * sizeof(T));
+    }
+  } else if (dest < first) {
+    for (std::size_t i = 0; i < count; ++i) {
+      relocate_at(first + i, dest + i);
+    }
+  } else if (dest > first) {
+    for (std::size_t i = count; i > 0; --i) {
+      relocate_at(first + i - 1, dest + i - 1);
+    }
+  }
+  return dest + count;
+}
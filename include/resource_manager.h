@@ -0,0 +1,440 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+#include "function.h"
+#include "intrusive.h"
+#include "metrics.h"
+#include "posix_error.h"
+#include "scope_guard.h"
+
+/**
+ * Асинхронный менеджер ресурсов (gems1: resource manager).
+ *
+ * Файлы под корневым каталогом грузятся в фоне пулом потоков и отдаются
+ * без копирования: Resource - это mmap файла (MAP_POPULATE, так что
+ * страницы уже в памяти к моменту готовности). Ключ - путь относительно
+ * корня.
+ *  - Повторные запросы ключа, пока он грузится, ждут ту же загрузку.
+ *  - Готовые ресурсы лежат в LRU-кэше с бюджетом памяти.
+ *  - Ресурс - shared_ptr: вытесненный из кэша остаётся жив, пока его
+ *    держат, но в бюджет уже не входит.
+ *  - prefetch() ставит загрузку в фоновую очередь, которую пул берёт
+ *    только когда срочных загрузок нет; load() того же ключа поднимает
+ *    её в срочную.
+ * Попадания, промахи, вытеснения и время загрузки пишутся в метрики
+ * (metrics.h), их же возвращает stats().
+ */
+
+// Файл, отображённый в память только для чтения.
+class MappedFile : private Moveonly {
+ public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      privat::throwErrno(("open " + path).c_str());
+    }
+    SCOPE_EXIT { ::close(fd); };
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      privat::throwErrno("fstat");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ == 0) {
+      return;  // mmap нулевой длины не бывает
+    }
+    void* data =
+        ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (data == MAP_FAILED) {
+      privat::throwErrno(("mmap " + path).c_str());
+    }
+    data_ = static_cast<const std::byte*>(data);
+  }
+
+  MappedFile(MappedFile&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~MappedFile() {
+    if (data_) {
+      ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+  }
+
+  std::span<const std::byte> data() const noexcept { return {data_, size_}; }
+  std::size_t size() const noexcept { return size_; }
+
+ private:
+  const std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+class Resource : private UncopyableUnmovable {
+ public:
+  const std::string& key() const noexcept { return key_; }
+  std::span<const std::byte> data() const noexcept { return file_.data(); }
+  std::size_t size() const noexcept { return file_.size(); }
+  std::string_view text() const noexcept {
+    return {reinterpret_cast<const char*>(file_.data().data()), file_.size()};
+  }
+
+ private:
+  friend class ResourceManager;
+  Resource(std::string key, MappedFile file) noexcept
+      : key_(std::move(key)), file_(std::move(file)) {}
+
+  std::string key_;
+  MappedFile file_;
+};
+
+using ResourceHandle = std::shared_ptr<const Resource>;
+
+struct ResourceStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  std::uint64_t deduplicated = 0;  // запрос присоединился к идущей загрузке
+  std::uint64_t prefetches = 0;
+  std::uint64_t evictions = 0;
+  std::uint64_t failures = 0;
+  std::size_t residentBytes = 0;
+  std::size_t residentCount = 0;
+  HistogramSnapshot loadLatency;  // нс от первого запроса до готовности
+
+  double hitRate() const noexcept {
+    const std::uint64_t total = hits + misses + deduplicated;
+    return total == 0 ? 0.0
+                      : static_cast<double>(hits) / static_cast<double>(total);
+  }
+};
+
+namespace privat {
+
+/**
+ * Пул потоков с двумя очередями: фоновая берётся, только когда срочная
+ * пуста. При разрушении срочные задачи доделываются, фоновые
+ * отбрасываются.
+ */
+class WorkerPool : private UncopyableUnmovable {
+ public:
+  using Job = UniqueFunction<void()>;
+
+  explicit WorkerPool(std::size_t threads) {
+    threads_.reserve(threads);
+    SCOPE_FAIL { stop(); };
+    for (std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i) {
+      threads_.emplace_back([this] { run(); });
+    }
+  }
+  ~WorkerPool() { stop(); }
+
+  void submit(Job job, bool background) {
+    {
+      std::lock_guard lock(mutex_);
+      (background ? background_ : urgent_).push_back(std::move(job));
+    }
+    ready_.release();
+  }
+
+ private:
+  // Семафор считает задачи плюс по одному пробуждению на поток при stop().
+  void run() {
+    for (;;) {
+      ready_.acquire();
+      Job job;
+      {
+        std::lock_guard lock(mutex_);
+        if (!urgent_.empty()) {
+          job = std::move(urgent_.front());
+          urgent_.pop_front();
+        } else if (stopping_) {
+          return;
+        } else if (!background_.empty()) {
+          job = std::move(background_.front());
+          background_.pop_front();
+        } else {
+          continue;
+        }
+      }
+      job();
+    }
+  }
+
+  void stop() noexcept {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.release(static_cast<std::ptrdiff_t>(threads_.size()));
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+  std::mutex mutex_;
+  std::counting_semaphore<> ready_{0};
+  std::deque<Job> urgent_;
+  std::deque<Job> background_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+struct StringHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view s) const noexcept {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+}  // namespace privat
+
+class ResourceManager : private UncopyableUnmovable {
+ public:
+  struct Options {
+    std::size_t memoryBudget = std::size_t{256} << 20;
+    std::size_t workers = 2;
+    // Куда писать метрики; nullptr - в собственный анонимный реестр.
+    MetricsRegistry* metrics = nullptr;
+  };
+
+  // Вызывается из потока пула (или сразу, если ресурс уже в кэше).
+  using Callback = UniqueFunction<void(ResourceHandle, std::exception_ptr)>;
+
+  explicit ResourceManager(std::filesystem::path root)
+      : ResourceManager(std::move(root), Options()) {}
+
+  ResourceManager(std::filesystem::path root, Options options)
+      : root_(std::move(root)),
+        budget_(options.memoryBudget),
+        ownMetrics_(options.metrics ? nullptr
+                                    : std::make_unique<MetricsRegistry>()),
+        metrics_(options.metrics ? *options.metrics : *ownMetrics_),
+        hits_(metrics_.counter("resource_hits")),
+        misses_(metrics_.counter("resource_misses")),
+        deduplicated_(metrics_.counter("resource_deduplicated")),
+        prefetches_(metrics_.counter("resource_prefetches")),
+        evictions_(metrics_.counter("resource_evictions")),
+        failures_(metrics_.counter("resource_failures")),
+        residentBytes_(metrics_.gauge("resource_resident_bytes")),
+        loadLatency_(metrics_.histogram("resource_load_ns")),
+        pool_(options.workers) {}
+
+  /**
+   * Ресурс по ключу: из кэша, из уже идущей загрузки или новой загрузкой.
+   * Ошибка загрузки (нет файла и т.п.) приходит исключением из get();
+   * неудачные загрузки не кэшируются.
+   */
+  std::shared_future<ResourceHandle> load(std::string_view key) {
+    std::lock_guard lock(mutex_);
+    return request(key, false).future;
+  }
+
+  // То же с обратным вызовом вместо future.
+  void load(std::string_view key, Callback callback) {
+    ResourceHandle ready;
+    {
+      std::lock_guard lock(mutex_);
+      Entry& entry = request(key, false);
+      if (!entry.resource) {
+        entry.callbacks.push_back(std::move(callback));
+        return;
+      }
+      ready = entry.resource;
+    }
+    callback(std::move(ready), nullptr);
+  }
+
+  // Синхронная загрузка: ждёт готовности.
+  ResourceHandle get(std::string_view key) { return load(key).get(); }
+
+  // Только из кэша, без загрузки и без учёта в статистике.
+  ResourceHandle find(std::string_view key) {
+    std::lock_guard lock(mutex_);
+    const auto it = entries_.find(key);
+    return it == entries_.end() ? nullptr : it->second->resource;
+  }
+
+  // Подсказка: ресурс скоро понадобится, грузить, когда пул свободен.
+  void prefetch(std::string_view key) {
+    std::lock_guard lock(mutex_);
+    request(key, true);
+  }
+
+  ResourceStats stats() const {
+    ResourceStats result;
+    result.hits = hits_.value();
+    result.misses = misses_.value();
+    result.deduplicated = deduplicated_.value();
+    result.prefetches = prefetches_.value();
+    result.evictions = evictions_.value();
+    result.failures = failures_.value();
+    result.loadLatency = loadLatency_.snapshot();
+    std::lock_guard lock(mutex_);
+    result.residentBytes = resident_;
+    result.residentCount = lru_.size();
+    return result;
+  }
+
+  const std::filesystem::path& root() const noexcept { return root_; }
+  std::size_t memoryBudget() const noexcept { return budget_; }
+
+ private:
+  struct Entry : IntrusiveListHook<> {
+    std::string key;
+    std::promise<ResourceHandle> promise;
+    std::shared_future<ResourceHandle> future;
+    ResourceHandle resource;  // пуст, пока грузится
+    std::vector<Callback> callbacks;
+    bool started = false;
+    bool urgent = false;  // срочная задача уже в очереди
+    std::chrono::steady_clock::time_point requested;
+  };
+
+  Entry& request(std::string_view key, bool background) {
+    if (const auto it = entries_.find(key); it != entries_.end()) {
+      Entry& entry = *it->second;
+      if (entry.resource) {
+        if (!background) {
+          hits_.inc();
+          lru_.erase(entry);
+          lru_.push_back(entry);
+        }
+      } else if (!background) {
+        deduplicated_.inc();
+        if (!entry.urgent && !entry.started) {
+          schedule(entry, false);  // prefetch, а ресурс уже нужен
+        }
+      }
+      return entry;
+    }
+    const std::filesystem::path relative(key);
+    if (key.empty() || relative.is_absolute() ||
+        *relative.lexically_normal().begin() == "..") {
+      throw std::invalid_argument("resource key outside of root: " +
+                                  std::string(key));
+    }
+    (background ? prefetches_ : misses_).inc();
+    auto owned = std::make_unique<Entry>();
+    Entry& entry = *owned;
+    entry.key = key;
+    entry.future = entry.promise.get_future().share();
+    entry.requested = std::chrono::steady_clock::now();
+    const auto it = entries_.emplace(entry.key, std::move(owned)).first;
+    SCOPE_FAIL { entries_.erase(it); };
+    schedule(entry, background);
+    return entry;
+  }
+
+  void schedule(Entry& entry, bool background) {
+    entry.urgent = entry.urgent || !background;
+    // Задача ищет запись по ключу заново: к её запуску запись могла
+    // исчезнуть или уже грузиться другой задачей.
+    pool_.submit([this, key = entry.key] { loadEntry(key); }, background);
+  }
+
+  void loadEntry(const std::string& key) {
+    {
+      std::lock_guard lock(mutex_);
+      const auto it = entries_.find(key);
+      if (it == entries_.end() || it->second->started) {
+        return;
+      }
+      it->second->started = true;
+    }
+    ResourceHandle resource;
+    std::exception_ptr error;
+    try {
+      resource.reset(new Resource(key, MappedFile((root_ / key).string())));
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::vector<Callback> callbacks;
+    {
+      std::lock_guard lock(mutex_);
+      const auto it = entries_.find(key);
+      Entry& entry = *it->second;
+      callbacks = std::move(entry.callbacks);
+      loadLatency_.record(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - entry.requested)
+              .count()));
+      if (error) {
+        failures_.inc();
+        entry.promise.set_exception(error);
+        entries_.erase(it);
+      } else {
+        entry.resource = resource;
+        entry.promise.set_value(resource);
+        lru_.push_back(entry);
+        resident_ += resource->size();
+        evict(entry);
+        residentBytes_.set(static_cast<std::int64_t>(resident_));
+      }
+    }
+    for (Callback& callback : callbacks) {
+      callback(resource, error);
+    }
+  }
+
+  // Вытесняет давно не использованное; только что загруженное - последним.
+  void evict(const Entry& keep) {
+    while (resident_ > budget_ && &lru_.front() != &keep) {
+      Entry& entry = lru_.front();
+      resident_ -= entry.resource->size();
+      evictions_.inc();
+      entries_.erase(entries_.find(entry.key));
+    }
+  }
+
+  const std::filesystem::path root_;
+  const std::size_t budget_;
+  std::unique_ptr<MetricsRegistry> ownMetrics_;
+  MetricsRegistry& metrics_;
+  const Counter hits_;
+  const Counter misses_;
+  const Counter deduplicated_;
+  const Counter prefetches_;
+  const Counter evictions_;
+  const Counter failures_;
+  const Gauge residentBytes_;
+  const Histogram loadLatency_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Entry>, privat::StringHash,
+                     std::equal_to<>>
+      entries_;
+  IntrusiveList<Entry> lru_;  // готовые; давно не использованные в начале
+  std::size_t resident_ = 0;
+
+  // Последним: потоки пула останавливаются раньше, чем разрушается кэш.
+  privat::WorkerPool pool_;
+};
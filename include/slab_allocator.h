@@ -0,0 +1,978 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "core.h"
+#include "intrusive.h"
+
+/**
+ * Slab-аллокатор общего назначения (Game Programming Gems 3/4: "custom STL
+ * allocator", "memory fragmentation").
+ *
+ * Память берётся у ОС чанками по 4 МиБ и режется на span'ы по 64 КиБ,
+ * выровненные по своему размеру: заголовок span'а находится по адресу
+ * объекта, обнулением младших бит. Каждый span отдаёт объекты одного
+ * размерного класса (16..256 байт с шагом 16, дальше по 4 класса на
+ * удвоение до 8 КиБ). Всё крупнее и всё с выравниванием больше 64 байт
+ * отображается отдельным mmap. Размер такого отображения округляется
+ * (4 шага на удвоение), а освобождённые отображения до 4 МиБ оседают в
+ * небольшом кэше PageHeap (до 16 штук и 32 МиБ) и достаются следующему
+ * крупному объекту того же размера: растущие std::vector и std::string не
+ * платят за mmap/munmap на каждое выделение и не плодят отображения.
+ * Отображения крупнее 4 МиБ возвращаются ОС сразу.
+ *
+ * У каждого потока свой ThreadHeap со своими span'ами: выделение и
+ * освобождение своих объектов идут без атомарных RMW и блокировок.
+ * Объект, освобождённый чужим потоком, кладётся в lock-free очередь
+ * remoteFree своего span'а, владелец забирает её целиком при следующем
+ * пополнении. Опустевший span возвращается в общий PageHeap; сверх
+ * небольшого запаса его страницы отдаются ОС через madvise(MADV_DONTNEED)
+ * (страница заголовка остаётся). При выходе потока его span'ы становятся
+ * "сиротами" и достаются первому потоку, которому нужен тот же класс.
+ *
+ * SlabHeap - точка входа, SlabAllocator<T> - STL-аллокатор поверх него,
+ * src/slab_new_delete.cpp - необязательная замена глобальных operator
+ * new/delete (CMake-цель slab_new_delete). Только Linux.
+ */
+
+struct SlabStats {
+  std::size_t mappedBytes = 0;     // получено у ОС через mmap
+  std::size_t committedBytes = 0;  // из них не возвращено через madvise
+  std::size_t allocatedBytes = 0;  // занято живыми объектами (по классам)
+  std::size_t largeBytes = 0;      // из них крупными объектами
+  std::size_t releasedBytes = 0;   // страницы занятых span'ов, отданные ОС
+  std::size_t activeSpans = 0;
+  std::size_t freeSpans = 0;         // свободны, память на месте
+  std::size_t decommittedSpans = 0;  // свободны, страницы отданы ОС
+
+  // Доля удерживаемой памяти, не занятой объектами.
+  double fragmentation() const noexcept {
+    return committedBytes == 0
+               ? 0.0
+               : 1.0 - static_cast<double>(allocatedBytes) /
+                           static_cast<double>(committedBytes);
+  }
+};
+
+namespace privat {
+
+inline constexpr std::size_t kSlabPage = 4096;
+inline constexpr std::size_t kSpanSize = std::size_t{1} << 16;
+inline constexpr std::size_t kSpanPages = kSpanSize / kSlabPage;
+inline constexpr std::size_t kChunkSpans = 64;
+inline constexpr std::size_t kChunkSize = kSpanSize * kChunkSpans;
+inline constexpr std::size_t kMaxChunks = 16384;  // 64 ГиБ в span'ах
+inline constexpr std::size_t kRetainedSpans = 16;
+inline constexpr std::size_t kMaxSmallSize = 8192;
+inline constexpr std::size_t kMaxSmallAlign = 64;
+inline constexpr std::size_t kSizeClasses = 36;
+inline constexpr std::size_t kFullSpansScan = 4;
+inline constexpr std::size_t kMaxCachedLarge = std::size_t{4} << 20;
+inline constexpr std::size_t kLargeCacheBytes = std::size_t{32} << 20;
+inline constexpr std::size_t kLargeCacheSpans = 16;
+
+constexpr std::size_t slabSizeClass(std::size_t size) noexcept {
+  if (size <= 256) {
+    return size == 0 ? 0 : (size - 1) / 16;
+  }
+  const auto bits = static_cast<std::size_t>(std::bit_width(size - 1));
+  return 16 + (bits - 9) * 4 + ((size - 1) >> (bits - 3)) - 4;
+}
+
+constexpr std::size_t slabClassSize(std::size_t cls) noexcept {
+  if (cls < 16) {
+    return (cls + 1) * 16;
+  }
+  const std::size_t base = std::size_t{256} << ((cls - 16) / 4);
+  return base + ((cls - 16) % 4 + 1) * (base / 4);
+}
+
+static_assert(slabSizeClass(kMaxSmallSize) == kSizeClasses - 1);
+static_assert(slabClassSize(kSizeClasses - 1) == kMaxSmallSize);
+
+// Спинлок без деструктора: глобальное состояние аллокатора живёт дольше
+// любых статических объектов, которые могут освобождать память.
+class SlabSpinLock {
+ public:
+  void lock() noexcept {
+    while (flag_.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+  void unlock() noexcept { flag_.clear(std::memory_order_release); }
+
+ private:
+  std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+struct FreeObject {
+  FreeObject* next;
+};
+
+class ThreadHeap;
+
+enum class SpanKind : std::uint8_t { free, small, large };
+
+/**
+ * Заголовок span'а. Поля, которые читает stats() из других потоков, -
+ * атомарные; used меняет только владелец обычными load/store.
+ */
+struct alignas(64) Span : IntrusiveListHook<> {
+  std::atomic<SpanKind> kind{SpanKind::free};
+  std::atomic<bool> decommitted{false};
+  std::atomic<std::uint32_t> objectSize{0};
+  std::atomic<std::uint32_t> used{0};
+  std::atomic<ThreadHeap*> owner{nullptr};
+  // Страницы, отданные ОС при trim, пока в span'е есть живые объекты.
+  std::atomic<std::uint16_t> releasedPages{0};
+  std::size_t sizeClass = 0;
+  std::size_t mappedBytes = 0;  // только у крупных объектов
+  char* bump = nullptr;         // ещё ни разу не выданная часть span'а
+  char* limit = nullptr;
+  FreeObject* freeList = nullptr;
+  bool inFull = false;
+
+  // Отдельная кэш-линия: сюда пишут чужие потоки.
+  alignas(64) std::atomic<FreeObject*> remoteFree{nullptr};
+};
+
+inline constexpr std::size_t kSpanHeader = sizeof(Span);
+static_assert(kSpanHeader % kMaxSmallAlign == 0);
+
+// Объект никогда не начинается с начала span'а: там заголовок. Исключение -
+// крупный объект с выравниванием от kSpanSize, его заголовок занимает
+// предыдущий span целиком.
+inline Span* spanOf(const void* p) noexcept {
+  const auto addr = reinterpret_cast<std::uintptr_t>(p);
+  std::uintptr_t base = addr & ~(std::uintptr_t{kSpanSize} - 1);
+  if (base == addr) {
+    base -= kSpanSize;
+  }
+  return reinterpret_cast<Span*>(base);
+}
+
+inline void setUsed(Span* span, std::uint32_t used) noexcept {
+  span->used.store(used, std::memory_order_relaxed);
+}
+
+inline std::uint32_t usedOf(const Span* span) noexcept {
+  return span->used.load(std::memory_order_relaxed);
+}
+
+inline void* popObject(Span* span) noexcept {
+  if (FreeObject* obj = span->freeList) {
+    span->freeList = obj->next;
+    setUsed(span, usedOf(span) + 1);
+    return obj;
+  }
+  const std::size_t size = span->objectSize.load(std::memory_order_relaxed);
+  if (static_cast<std::size_t>(span->limit - span->bump) >= size) {
+    void* p = span->bump;
+    span->bump += size;
+    setUsed(span, usedOf(span) + 1);
+    return p;
+  }
+  return nullptr;
+}
+
+inline bool hasFree(const Span* span) noexcept {
+  return span->freeList ||
+         span->releasedPages.load(std::memory_order_relaxed) != 0 ||
+         static_cast<std::size_t>(span->limit - span->bump) >=
+             span->objectSize.load(std::memory_order_relaxed);
+}
+
+inline void pushRemote(Span* span, void* p) noexcept {
+  auto* obj = static_cast<FreeObject*>(p);
+  FreeObject* head = span->remoteFree.load(std::memory_order_relaxed);
+  do {
+    obj->next = head;
+  } while (!span->remoteFree.compare_exchange_weak(
+      head, obj, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// Забирает объекты, освобождённые чужими потоками; возвращает их число.
+inline std::uint32_t drainRemote(Span* span) noexcept {
+  FreeObject* list =
+      span->remoteFree.exchange(nullptr, std::memory_order_acquire);
+  std::uint32_t count = 0;
+  while (list) {
+    FreeObject* next = list->next;
+    list->next = span->freeList;
+    span->freeList = list;
+    list = next;
+    ++count;
+  }
+  setUsed(span, usedOf(span) - count);
+  return count;
+}
+
+// Маска страниц span'а, которые задевает объект index.
+inline std::uint32_t objectPages(std::size_t index, std::size_t size) noexcept {
+  const std::size_t first = (kSpanHeader + index * size) / kSlabPage;
+  const std::size_t last = (kSpanHeader + (index + 1) * size - 1) / kSlabPage;
+  return ((std::uint32_t{2} << last) - 1) & ~((std::uint32_t{1} << first) - 1);
+}
+
+/**
+ * Отдаёт ОС страницы span'а, на которых нет живых объектов. Свободные
+ * объекты с этих страниц убираются из freeList ("паркуются"): запись
+ * указателя next в них вернула бы страницу обратно. Все паркованные
+ * объекты свободны, поэтому их не нужно запоминать - restoreParked
+ * восстанавливает их по маске releasedPages.
+ */
+inline void releaseFreePages(Span* span) noexcept {
+  constexpr std::size_t kMaxObjects = (kSpanSize - kSpanHeader) / 16;
+  char* base = reinterpret_cast<char*>(span) + kSpanHeader;
+  const std::size_t size = span->objectSize.load(std::memory_order_relaxed);
+  const auto count = static_cast<std::size_t>(span->bump - base) / size;
+  const std::uint32_t released =
+      span->releasedPages.load(std::memory_order_relaxed);
+  std::bitset<kMaxObjects> free;
+  for (FreeObject* obj = span->freeList; obj; obj = obj->next) {
+    free.set(static_cast<std::size_t>(reinterpret_cast<char*>(obj) - base) /
+             size);
+  }
+  // Страница заголовка и ещё не выданный хвост: bump пишет туда без
+  // оглядки на маску.
+  const auto bumpPage =
+      static_cast<std::size_t>(span->bump - reinterpret_cast<char*>(span)) /
+      kSlabPage;
+  std::uint32_t busy = 1 | ~((std::uint32_t{1} << bumpPage) - 1);
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::uint32_t pages = objectPages(i, size);
+    if (!free[i] && (pages & released) == 0) {
+      busy |= pages;
+    }
+  }
+  const std::uint32_t release =
+      ((std::uint32_t{1} << kSpanPages) - 1) & ~busy & ~released;
+  if (release == 0) {
+    return;
+  }
+  for (std::size_t page = 1; page < kSpanPages;) {
+    if ((release >> page & 1) == 0) {
+      ++page;
+      continue;
+    }
+    std::size_t end = page;
+    while (end < kSpanPages && (release >> end & 1)) {
+      ++end;
+    }
+    ::madvise(reinterpret_cast<char*>(span) + page * kSlabPage,
+              (end - page) * kSlabPage, MADV_DONTNEED);
+    page = end;
+  }
+  const std::uint32_t parked = released | release;
+  span->releasedPages.store(static_cast<std::uint16_t>(parked),
+                            std::memory_order_relaxed);
+  FreeObject* list = nullptr;
+  for (std::size_t i = count; i-- > 0;) {
+    if (free[i] && (objectPages(i, size) & parked) == 0) {
+      auto* obj = reinterpret_cast<FreeObject*>(base + i * size);
+      obj->next = list;
+      list = obj;
+    }
+  }
+  span->freeList = list;
+}
+
+// Возвращает паркованные объекты в freeList; false, если их не было.
+inline bool restoreParked(Span* span) noexcept {
+  const std::uint32_t parked =
+      span->releasedPages.exchange(0, std::memory_order_relaxed);
+  if (parked == 0) {
+    return false;
+  }
+  char* base = reinterpret_cast<char*>(span) + kSpanHeader;
+  const std::size_t size = span->objectSize.load(std::memory_order_relaxed);
+  const auto count = static_cast<std::size_t>(span->bump - base) / size;
+  for (std::size_t i = count; i-- > 0;) {
+    if (objectPages(i, size) & parked) {
+      auto* obj = reinterpret_cast<FreeObject*>(base + i * size);
+      obj->next = span->freeList;
+      span->freeList = obj;
+    }
+  }
+  return span->freeList != nullptr;
+}
+
+// Отображает size байт по адресу, который после сдвига на skew кратен align.
+inline void* mapAligned(std::size_t size, std::size_t align = kSpanSize,
+                        std::size_t skew = 0) noexcept {
+  const std::size_t padded = size + align;
+  void* raw = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+  const auto start = reinterpret_cast<std::uintptr_t>(raw);
+  const std::uintptr_t aligned =
+      ((start + skew + align - 1) & ~(std::uintptr_t{align} - 1)) - skew;
+  if (aligned != start) {
+    ::munmap(raw, aligned - start);
+  }
+  const std::uintptr_t tail = start + padded - (aligned + size);
+  if (tail != 0) {
+    ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+  }
+  return reinterpret_cast<void*>(aligned);
+}
+
+// Размер отображения крупного объекта: страницы, а до kMaxCachedLarge ещё
+// и 4 шага на удвоение, чтобы кэшированное отображение подходило под
+// близкие размеры.
+inline std::size_t largeMappedSize(std::size_t bytes) noexcept {
+  bytes = (bytes + kSlabPage - 1) & ~(kSlabPage - 1);
+  if (bytes > kMaxCachedLarge) {
+    return bytes;
+  }
+  const std::size_t step = std::max(kSlabPage, std::bit_floor(bytes) / 4);
+  return (bytes + step - 1) & ~(step - 1);
+}
+
+// Общий источник span'ов и крупных блоков. Никогда не разрушается.
+class PageHeap : private UncopyableUnmovable {
+ public:
+  static PageHeap& instance() noexcept {
+    alignas(PageHeap) static unsigned char storage[sizeof(PageHeap)];
+    static PageHeap* heap = ::new (static_cast<void*>(storage)) PageHeap();
+    return *heap;
+  }
+
+  Span* acquire() noexcept {
+    {
+      std::lock_guard lock(lock_);
+      if (!retained_.empty()) {
+        Span& span = retained_.front();
+        retained_.pop_front();
+        return &span;
+      }
+      if (!decommitted_.empty()) {
+        Span& span = decommitted_.front();
+        decommitted_.pop_front();
+        span.decommitted.store(false, std::memory_order_relaxed);
+        return &span;
+      }
+    }
+    char* chunk = static_cast<char*>(mapAligned(kChunkSize));
+    if (!chunk) {
+      return nullptr;
+    }
+    for (std::size_t i = 0; i < kChunkSpans; ++i) {
+      ::new (static_cast<void*>(chunk + i * kSpanSize)) Span();
+    }
+    std::lock_guard lock(lock_);
+    const std::size_t index = chunkCount_.load(std::memory_order_relaxed);
+    if (index < kMaxChunks) {
+      chunks_[index].store(chunk, std::memory_order_relaxed);
+      chunkCount_.store(index + 1, std::memory_order_release);
+    }
+    for (std::size_t i = 1; i < kChunkSpans; ++i) {
+      retained_.push_back(*reinterpret_cast<Span*>(chunk + i * kSpanSize));
+    }
+    return reinterpret_cast<Span*>(chunk);
+  }
+
+  void release(Span* span) noexcept {
+    span->kind.store(SpanKind::free, std::memory_order_release);
+    span->objectSize.store(0, std::memory_order_relaxed);
+    setUsed(span, 0);
+    span->owner.store(nullptr, std::memory_order_relaxed);
+    {
+      std::lock_guard lock(lock_);
+      if (retained_.size() < kRetainedSpans) {
+        retained_.push_front(*span);
+        return;
+      }
+    }
+    decommit(span);
+    std::lock_guard lock(lock_);
+    decommitted_.push_front(*span);
+  }
+
+  // Отдаёт ОС страницы всех свободных span'ов и кэшированных крупных
+  // отображений; сами отображения остаются.
+  void decommitRetained() noexcept {
+    IntrusiveList<Span> spans;
+    IntrusiveList<Span> large;
+    {
+      std::lock_guard lock(lock_);
+      while (!retained_.empty()) {
+        Span& span = retained_.front();
+        retained_.pop_front();
+        spans.push_back(span);
+      }
+      while (!largeCache_.empty()) {
+        Span& span = largeCache_.front();
+        largeCache_.pop_front();
+        large.push_back(span);
+      }
+    }
+    for (Span& span : spans) {
+      decommit(&span);
+    }
+    for (Span& span : large) {
+      if (!span.decommitted.load(std::memory_order_relaxed)) {
+        ::madvise(reinterpret_cast<char*>(&span) + kSlabPage,
+                  span.mappedBytes - kSlabPage, MADV_DONTNEED);
+        span.decommitted.store(true, std::memory_order_relaxed);
+        largeCacheReleased_.fetch_add(span.mappedBytes - kSlabPage,
+                                      std::memory_order_relaxed);
+      }
+    }
+    std::lock_guard lock(lock_);
+    while (!spans.empty()) {
+      Span& span = spans.front();
+      spans.pop_front();
+      decommitted_.push_front(span);
+    }
+    // В конец: такие отображения вытесняются первыми.
+    while (!large.empty()) {
+      Span& span = large.front();
+      large.pop_front();
+      largeCache_.push_back(span);
+    }
+  }
+
+  void* allocateLarge(std::size_t size, std::size_t align) noexcept {
+    // При выравнивании от kSpanSize объект сам стоит на границе span'а, и
+    // заголовку отводится весь предыдущий span (см. spanOf).
+    const bool spanAligned = align >= kSpanSize;
+    const std::size_t offset =
+        spanAligned ? kSpanSize : (kSpanHeader + align - 1) & ~(align - 1);
+    if (size > std::numeric_limits<std::size_t>::max() / 2 ||
+        align > std::numeric_limits<std::size_t>::max() / 4) {
+      return nullptr;
+    }
+    const std::size_t mapped = largeMappedSize(offset + size);
+    Span* span = takeCachedLarge(mapped, offset, align);
+    if (!span) {
+      char* base = static_cast<char*>(
+          spanAligned ? mapAligned(mapped, align, offset) : mapAligned(mapped));
+      if (!base) {
+        return nullptr;
+      }
+      span = ::new (static_cast<void*>(base)) Span();
+      span->mappedBytes = mapped;
+      span->kind.store(SpanKind::large, std::memory_order_relaxed);
+    }
+    largeMapped_.fetch_add(mapped, std::memory_order_relaxed);
+    return reinterpret_cast<char*>(span) + offset;
+  }
+
+  void freeLarge(Span* span) noexcept {
+    const std::size_t mapped = span->mappedBytes;
+    largeMapped_.fetch_sub(mapped, std::memory_order_relaxed);
+    if (mapped > kMaxCachedLarge) {
+      ::munmap(span, mapped);
+      return;
+    }
+    IntrusiveList<Span> evicted;
+    {
+      std::lock_guard lock(lock_);
+      largeCache_.push_front(*span);
+      largeCached_.fetch_add(mapped, std::memory_order_relaxed);
+      while (largeCache_.size() > kLargeCacheSpans ||
+             largeCached_.load(std::memory_order_relaxed) >
+                 kLargeCacheBytes) {
+        Span& old = largeCache_.back();
+        largeCache_.pop_back();
+        forgetCachedLarge(old);
+        evicted.push_back(old);
+      }
+    }
+    while (!evicted.empty()) {
+      Span& old = evicted.front();
+      evicted.pop_front();
+      ::munmap(&old, old.mappedBytes);
+    }
+  }
+
+  SlabStats stats() const noexcept {
+    SlabStats stats;
+    const std::size_t chunks = chunkCount_.load(std::memory_order_acquire);
+    for (std::size_t c = 0; c < chunks; ++c) {
+      char* chunk = chunks_[c].load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < kChunkSpans; ++i) {
+        const auto* span =
+            reinterpret_cast<const Span*>(chunk + i * kSpanSize);
+        if (span->kind.load(std::memory_order_acquire) == SpanKind::small) {
+          ++stats.activeSpans;
+          stats.releasedBytes +=
+              static_cast<std::size_t>(std::popcount(
+                  span->releasedPages.load(std::memory_order_relaxed))) *
+              kSlabPage;
+          stats.allocatedBytes +=
+              std::size_t{usedOf(span)} *
+              span->objectSize.load(std::memory_order_relaxed);
+        } else if (span->decommitted.load(std::memory_order_relaxed)) {
+          ++stats.decommittedSpans;
+        } else {
+          ++stats.freeSpans;
+        }
+      }
+    }
+    stats.largeBytes = largeMapped_.load(std::memory_order_relaxed);
+    stats.allocatedBytes += stats.largeBytes;
+    stats.mappedBytes = chunks * kChunkSize + stats.largeBytes +
+                        largeCached_.load(std::memory_order_relaxed);
+    stats.committedBytes =
+        stats.mappedBytes - stats.releasedBytes -
+        stats.decommittedSpans * (kSpanSize - kSlabPage) -
+        largeCacheReleased_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  PageHeap() = default;
+
+  static void decommit(Span* span) noexcept {
+    ::madvise(reinterpret_cast<char*>(span) + kSlabPage,
+              kSpanSize - kSlabPage, MADV_DONTNEED);
+    span->decommitted.store(true, std::memory_order_relaxed);
+  }
+
+  // Подходит отображение того же размера, где объект по offset выровнен.
+  Span* takeCachedLarge(std::size_t mapped, std::size_t offset,
+                        std::size_t align) noexcept {
+    std::lock_guard lock(lock_);
+    for (Span& span : largeCache_) {
+      const auto object = reinterpret_cast<std::uintptr_t>(&span) + offset;
+      if (span.mappedBytes == mapped && (object & (align - 1)) == 0) {
+        largeCache_.erase(span);
+        forgetCachedLarge(span);
+        return &span;
+      }
+    }
+    return nullptr;
+  }
+
+  // Под lock_: отображение покидает кэш (выдаётся или вытесняется).
+  void forgetCachedLarge(Span& span) noexcept {
+    largeCached_.fetch_sub(span.mappedBytes, std::memory_order_relaxed);
+    if (span.decommitted.load(std::memory_order_relaxed)) {
+      span.decommitted.store(false, std::memory_order_relaxed);
+      largeCacheReleased_.fetch_sub(span.mappedBytes - kSlabPage,
+                                    std::memory_order_relaxed);
+    }
+  }
+
+  SlabSpinLock lock_;
+  IntrusiveList<Span> retained_;
+  IntrusiveList<Span> decommitted_;
+  IntrusiveList<Span> largeCache_;  // свежие в начале
+  std::atomic<std::size_t> chunkCount_{0};
+  std::atomic<std::size_t> largeMapped_{0};
+  std::atomic<std::size_t> largeCached_{0};         // отображено в кэше
+  std::atomic<std::size_t> largeCacheReleased_{0};  // из них отдано ОС
+  std::atomic<char*> chunks_[kMaxChunks] = {};
+};
+
+// Span'ы завершившихся потоков, ждущие нового владельца.
+class OrphanSpans : private UncopyableUnmovable {
+ public:
+  static OrphanSpans& instance() noexcept {
+    alignas(OrphanSpans) static unsigned char storage[sizeof(OrphanSpans)];
+    static OrphanSpans* orphans =
+        ::new (static_cast<void*>(storage)) OrphanSpans();
+    return *orphans;
+  }
+
+  void add(Span* span) noexcept {
+    span->owner.store(nullptr, std::memory_order_release);
+    std::lock_guard lock(lock_);
+    bins_[span->sizeClass].push_back(*span);
+    count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Отдаёт span со свободными объектами новому владельцу. Полностью
+  // освободившиеся по дороге span'ы возвращаются в PageHeap.
+  Span* adopt(std::size_t cls, ThreadHeap* heap) noexcept {
+    if (count_.load(std::memory_order_relaxed) == 0) {
+      return nullptr;
+    }
+    std::lock_guard lock(lock_);
+    IntrusiveList<Span>& bin = bins_[cls];
+    for (std::size_t scanned = 0; scanned < bin.size();) {
+      Span* span = &bin.front();
+      bin.pop_front();
+      drainRemote(span);
+      if (usedOf(span) == 0) {
+        count_.fetch_sub(1, std::memory_order_relaxed);
+        PageHeap::instance().release(span);
+      } else if (hasFree(span)) {
+        count_.fetch_sub(1, std::memory_order_relaxed);
+        span->owner.store(heap, std::memory_order_relaxed);
+        return span;
+      } else {
+        bin.push_back(*span);
+        ++scanned;
+      }
+    }
+    return nullptr;
+  }
+
+  void trim() noexcept {
+    std::lock_guard lock(lock_);
+    for (IntrusiveList<Span>& bin : bins_) {
+      for (auto it = bin.begin(); it != bin.end();) {
+        Span* span = &*it++;
+        drainRemote(span);
+        if (usedOf(span) == 0) {
+          bin.erase(*span);
+          count_.fetch_sub(1, std::memory_order_relaxed);
+          PageHeap::instance().release(span);
+        } else {
+          releaseFreePages(span);
+        }
+      }
+    }
+  }
+
+ private:
+  OrphanSpans() = default;
+
+  SlabSpinLock lock_;
+  std::atomic<std::size_t> count_{0};
+  IntrusiveList<Span> bins_[kSizeClasses];
+};
+
+/**
+ * Кэш потока: по активному span'у на класс плюс списки частично занятых и
+ * полностью занятых span'ов. Полные span'ы просматриваются на предмет
+ * удалённых освобождений понемногу, по kFullSpansScan за пополнение.
+ */
+class ThreadHeap : private UncopyableUnmovable {
+ public:
+  void* allocate(std::size_t cls) noexcept {
+    if (Span* span = bins_[cls].active) {
+      if (void* p = popObject(span)) {
+        return p;
+      }
+    }
+    return refill(cls);
+  }
+
+  void deallocate(Span* span, void* p) noexcept {
+    auto* obj = static_cast<FreeObject*>(p);
+    obj->next = span->freeList;
+    span->freeList = obj;
+    const std::uint32_t used = usedOf(span) - 1;
+    setUsed(span, used);
+    Bin& bin = bins_[span->sizeClass];
+    if (span == bin.active) {
+      return;
+    }
+    if (used == 0) {
+      span->unlink();
+      span->inFull = false;
+      PageHeap::instance().release(span);
+    } else if (span->inFull) {
+      span->unlink();
+      span->inFull = false;
+      bin.partial.push_back(*span);
+    }
+  }
+
+  /**
+   * Возвращает в PageHeap все span'ы, где не осталось живых объектов; с
+   * releasePages ещё и отдаёт ОС свободные страницы остальных span'ов.
+   */
+  void trim(bool releasePages) noexcept {
+    for (Bin& bin : bins_) {
+      if (Span* span = bin.active) {
+        drainRemote(span);
+        if (usedOf(span) == 0) {
+          bin.active = nullptr;
+          PageHeap::instance().release(span);
+        } else if (releasePages) {
+          releaseFreePages(span);
+        }
+      }
+      for (IntrusiveList<Span>* list : {&bin.partial, &bin.full}) {
+        for (auto it = list->begin(); it != list->end();) {
+          Span* span = &*it++;
+          drainRemote(span);
+          if (usedOf(span) == 0) {
+            list->erase(*span);
+            span->inFull = false;
+            PageHeap::instance().release(span);
+          } else if (releasePages) {
+            releaseFreePages(span);
+          }
+        }
+      }
+    }
+  }
+
+  // Вызывается при выходе потока: живые span'ы уходят в сироты.
+  void abandon() noexcept {
+    trim(false);
+    for (Bin& bin : bins_) {
+      if (Span* span = std::exchange(bin.active, nullptr)) {
+        OrphanSpans::instance().add(span);
+      }
+      for (IntrusiveList<Span>* list : {&bin.partial, &bin.full}) {
+        while (!list->empty()) {
+          Span& span = list->front();
+          list->pop_front();
+          span.inFull = false;
+          OrphanSpans::instance().add(&span);
+        }
+      }
+    }
+  }
+
+ private:
+  struct Bin {
+    Span* active = nullptr;
+    IntrusiveList<Span> partial;
+    IntrusiveList<Span> full;
+  };
+
+  void* refill(std::size_t cls) noexcept {
+    Bin& bin = bins_[cls];
+    if (Span* span = bin.active) {
+      if (drainRemote(span) != 0 || restoreParked(span)) {
+        return popObject(span);
+      }
+      span->inFull = true;
+      bin.full.push_back(*span);
+      bin.active = nullptr;
+    }
+    Span* next = nullptr;
+    if (!bin.partial.empty()) {
+      next = &bin.partial.front();
+      bin.partial.pop_front();
+    }
+    for (std::size_t i = 0; !next && i < kFullSpansScan && !bin.full.empty();
+         ++i) {
+      Span* span = &bin.full.front();
+      bin.full.pop_front();
+      if (span->remoteFree.load(std::memory_order_relaxed)) {
+        drainRemote(span);
+        span->inFull = false;
+        next = span;
+      } else {
+        bin.full.push_back(*span);
+      }
+    }
+    if (!next) {
+      next = OrphanSpans::instance().adopt(cls, this);
+    }
+    if (!next) {
+      next = PageHeap::instance().acquire();
+      if (!next) {
+        return nullptr;
+      }
+      startSpan(next, cls);
+    }
+    bin.active = next;
+    if (void* p = popObject(next)) {
+      return p;
+    }
+    restoreParked(next);
+    return popObject(next);
+  }
+
+  void startSpan(Span* span, std::size_t cls) noexcept {
+    span->sizeClass = cls;
+    span->objectSize.store(static_cast<std::uint32_t>(slabClassSize(cls)),
+                           std::memory_order_relaxed);
+    setUsed(span, 0);
+    span->bump = reinterpret_cast<char*>(span) + kSpanHeader;
+    span->limit = reinterpret_cast<char*>(span) + kSpanSize;
+    span->freeList = nullptr;
+    span->inFull = false;
+    span->releasedPages.store(0, std::memory_order_relaxed);
+    span->owner.store(this, std::memory_order_relaxed);
+    span->kind.store(SpanKind::small, std::memory_order_release);
+  }
+
+  Bin bins_[kSizeClasses];
+};
+
+// Кэш потока создаётся при первом выделении и разбирается при его выходе.
+inline thread_local ThreadHeap* tlsHeap = nullptr;
+inline thread_local bool tlsHeapGone = false;
+
+struct ThreadHeapHolder : private UncopyableUnmovable {
+  ThreadHeapHolder() noexcept { tlsHeap = &heap; }
+  ~ThreadHeapHolder() {
+    tlsHeap = nullptr;
+    tlsHeapGone = true;
+    heap.abandon();
+  }
+  ThreadHeap heap;
+};
+
+inline ThreadHeap* attachThreadHeap() noexcept {
+  if (tlsHeapGone) {
+    return nullptr;
+  }
+  thread_local ThreadHeapHolder holder;
+  return &holder.heap;
+}
+
+// Выделения потоков, чей кэш уже разобран (деструкторы thread_local).
+struct FallbackHeap : private UncopyableUnmovable {
+  static FallbackHeap& instance() noexcept {
+    alignas(FallbackHeap) static unsigned char storage[sizeof(FallbackHeap)];
+    static FallbackHeap* heap =
+        ::new (static_cast<void*>(storage)) FallbackHeap();
+    return *heap;
+  }
+
+  SlabSpinLock lock;
+  ThreadHeap heap;
+};
+
+}  // namespace privat
+
+class SlabHeap {
+ public:
+  // nullptr при нехватке памяти; align - степень двойки.
+  static void* allocate(
+      std::size_t size,
+      std::size_t align = alignof(std::max_align_t)) noexcept {
+    using namespace privat;
+    assert(std::has_single_bit(align));
+    if (align > kMaxSmallAlign || size > kMaxSmallSize) {
+      return PageHeap::instance().allocateLarge(size, align);
+    }
+    if (align > alignof(std::max_align_t)) {
+      // Размеры классов кратны align, а объекты начинаются с границы 64.
+      size = (size + align - 1) & ~(align - 1);
+    }
+    const std::size_t cls = slabSizeClass(size);
+    ThreadHeap* heap = tlsHeap;
+    if (!heap) {
+      heap = attachThreadHeap();
+    }
+    if (heap) {
+      return heap->allocate(cls);
+    }
+    FallbackHeap& fallback = FallbackHeap::instance();
+    std::lock_guard lock(fallback.lock);
+    return fallback.heap.allocate(cls);
+  }
+
+  static void deallocate(void* p) noexcept {
+    using namespace privat;
+    if (!p) {
+      return;
+    }
+    Span* span = spanOf(p);
+    if (span->kind.load(std::memory_order_relaxed) == SpanKind::large) {
+      PageHeap::instance().freeLarge(span);
+      return;
+    }
+    ThreadHeap* heap = tlsHeap;
+    if (heap && span->owner.load(std::memory_order_relaxed) == heap) {
+      heap->deallocate(span, p);
+    } else {
+      pushRemote(span, p);
+    }
+  }
+
+  static std::size_t usableSize(const void* p) noexcept {
+    using namespace privat;
+    const Span* span = spanOf(p);
+    if (span->kind.load(std::memory_order_relaxed) == SpanKind::large) {
+      return span->mappedBytes -
+             static_cast<std::size_t>(static_cast<const char*>(p) -
+                                      reinterpret_cast<const char*>(span));
+    }
+    return span->objectSize.load(std::memory_order_relaxed);
+  }
+
+  static SlabStats stats() noexcept {
+    return privat::PageHeap::instance().stats();
+  }
+
+  /**
+   * Возвращает ОС всё, что можно: пустые span'ы и свободные страницы
+   * span'ов текущего потока и сирот, затем страницы всего запаса
+   * свободных span'ов. Кэши других потоков не
+   * трогает - их пустые span'ы и так уходят в PageHeap сами.
+   */
+  static void trim() noexcept {
+    using namespace privat;
+    if (ThreadHeap* heap = tlsHeap) {
+      heap->trim(true);
+    }
+    OrphanSpans::instance().trim();
+    PageHeap::instance().decommitRetained();
+  }
+
+  // Resident set size процесса из /proc/self/statm, 0 при ошибке.
+  static std::size_t residentBytes() noexcept {
+    const int fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return 0;
+    }
+    char buffer[128];
+    const ssize_t length = ::read(fd, buffer, sizeof(buffer) - 1);
+    ::close(fd);
+    if (length <= 0) {
+      return 0;
+    }
+    std::size_t pages = 0;
+    const char* c = buffer;
+    const char* end = buffer + length;
+    while (c < end && *c != ' ') {
+      ++c;
+    }
+    for (++c; c < end && *c >= '0' && *c <= '9'; ++c) {
+      pages = pages * 10 + static_cast<std::size_t>(*c - '0');
+    }
+    return pages * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  }
+};
+
+template <typename T>
+class SlabAllocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  SlabAllocator() noexcept = default;
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    void* p = SlabHeap::allocate(n * sizeof(T),
+                                 std::max(alignof(T), std::size_t{16}));
+    if (!p) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, std::size_t) noexcept { SlabHeap::deallocate(p); }
+
+  template <typename U>
+  friend bool operator==(const SlabAllocator&,
+                         const SlabAllocator<U>&) noexcept {
+    return true;
+  }
+};
@@ -0,0 +1,465 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "relocate.h"
+#include "scope_guard.h"
+
+/**
+ * SmallVector<T, N> - вектор, который держит до N элементов внутри себя и
+ * уходит в кучу только при переполнении. RelocatingVector<T> - тот же вектор
+ * без встроенного буфера.
+ *
+ * Рост, вставка и удаление переносят элементы через relocate.h: для
+ * тривиально перемещаемых типов это memcpy/memmove, а рост буфера в куче -
+ * realloc, который часто расширяет блок на месте вообще без копирования.
+ * Поэтому T обязан переноситься без исключений: быть тривиально
+ * перемещаемым или иметь noexcept move-конструктор.
+ *
+ * Итераторы - обычные указатели; как и у std::vector, они инвалидируются
+ * ростом, вставкой и удалением. Перемещение SmallVector с элементами во
+ * встроенном буфере переносит сами элементы.
+ */
+
+namespace privat {
+
+template <typename T, std::size_t N>
+struct InlineBuffer {
+  T* data() noexcept { return reinterpret_cast<T*>(bytes); }
+  const T* data() const noexcept {
+    return reinterpret_cast<const T*>(bytes);
+  }
+  alignas(T) unsigned char bytes[N * sizeof(T)];
+};
+
+template <typename T>
+struct InlineBuffer<T, 0> {
+  T* data() const noexcept { return nullptr; }
+};
+
+}  // namespace privat
+
+template <typename T, std::size_t N>
+class SmallVector {
+  static_assert(is_nothrow_relocatable_v<T>,
+                "SmallVector needs a trivially relocatable type or a noexcept "
+                "move constructor");
+
+  // realloc годится только для памяти из malloc и только если байтовая
+  // копия объекта - корректный перенос.
+  static constexpr bool kMallocable =
+      alignof(T) <= alignof(std::max_align_t);
+  static constexpr bool kUseRealloc =
+      kMallocable && is_trivially_relocatable_v<T>;
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  static constexpr size_type inline_capacity = N;
+
+  SmallVector() noexcept : capacity_(N) { data_ = inline_.data(); }
+
+  explicit SmallVector(size_type count) : SmallVector() { resize(count); }
+
+  SmallVector(size_type count, const T& value) : SmallVector() {
+    resize(count, value);
+  }
+
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  SmallVector(InputIt first, InputIt last) : SmallVector() {
+    append(first, last);
+  }
+
+  SmallVector(std::initializer_list<T> values)
+      : SmallVector(values.begin(), values.end()) {}
+
+  SmallVector(const SmallVector& other) : SmallVector() {
+    append(other.begin(), other.end());
+  }
+
+  SmallVector(SmallVector&& other) noexcept : SmallVector() { steal(other); }
+
+  SmallVector& operator=(const SmallVector& other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other) noexcept {
+    if (this != &other) {
+      reset();
+      steal(other);
+    }
+    return *this;
+  }
+
+  SmallVector& operator=(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+    return *this;
+  }
+
+  ~SmallVector() { reset(); }
+
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  void assign(InputIt first, InputIt last) {
+    clear();
+    append(first, last);
+  }
+
+  void assign(size_type count, const T& value) {
+    T copy(value);
+    clear();
+    resize(count, copy);
+  }
+
+  iterator begin() noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+  reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  T* data() noexcept { return data_; }
+  const T* data() const noexcept { return data_; }
+
+  T& operator[](size_type i) noexcept {
+    assert(i < size_);
+    return data_[i];
+  }
+  const T& operator[](size_type i) const noexcept {
+    assert(i < size_);
+    return data_[i];
+  }
+
+  T& at(size_type i) {
+    if (i >= size_) {
+      throw std::out_of_range("SmallVector::at");
+    }
+    return data_[i];
+  }
+  const T& at(size_type i) const {
+    return const_cast<SmallVector*>(this)->at(i);
+  }
+
+  T& front() noexcept { return (*this)[0]; }
+  const T& front() const noexcept { return (*this)[0]; }
+  T& back() noexcept { return (*this)[size_ - 1]; }
+  const T& back() const noexcept { return (*this)[size_ - 1]; }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return capacity_; }
+  static constexpr size_type max_size() noexcept {
+    return std::numeric_limits<difference_type>::max() / sizeof(T);
+  }
+
+  // Элементы лежат во встроенном буфере, а не в куче.
+  bool isInline() const noexcept {
+    return data_ == inline_.data();
+  }
+
+  void reserve(size_type count) {
+    if (count > capacity_) {
+      growTo(count);
+    }
+  }
+
+  void shrink_to_fit() {
+    if (isInline() || size_ == capacity_) {
+      return;
+    }
+    if (size_ <= N) {
+      T* heap = data_;
+      data_ = inline_.data();
+      uninitialized_relocate(heap, heap + size_, data_);
+      deallocate(heap);
+      capacity_ = N;
+    } else {
+      growTo(size_);
+    }
+  }
+
+  void clear() noexcept {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      return *emplaceGrow(size_, std::forward<Args>(args)...);
+    }
+    T* result = ::new (static_cast<void*>(data_ + size_))
+        T(std::forward<Args>(args)...);
+    ++size_;
+    return *result;
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  void pop_back() noexcept {
+    assert(size_ > 0);
+    std::destroy_at(data_ + --size_);
+  }
+
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    const auto idx = static_cast<size_type>(pos - begin());
+    assert(idx <= size_);
+    if (size_ == capacity_) {
+      return emplaceGrow(idx, std::forward<Args>(args)...);
+    }
+    if (idx == size_) {
+      return &emplace_back(std::forward<Args>(args)...);
+    }
+    // Новый элемент строится до сдвига: args могут ссылаться на элементы.
+    alignas(T) unsigned char raw[sizeof(T)];
+    T* value = ::new (static_cast<void*>(raw)) T(std::forward<Args>(args)...);
+    relocate(data_ + idx, data_ + size_, data_ + idx + 1);
+    relocate_at(value, data_ + idx);
+    ++size_;
+    return data_ + idx;
+  }
+
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+
+  iterator insert(const_iterator pos, size_type count, const T& value) {
+    SmallVector<T, 0> fresh(count, value);
+    return insertRelocating(pos, fresh);
+  }
+
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    SmallVector<T, 0> fresh(first, last);
+    return insertRelocating(pos, fresh);
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> values) {
+    return insert(pos, values.begin(), values.end());
+  }
+
+  iterator erase(const_iterator pos) noexcept { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) noexcept {
+    T* from = data_ + (first - begin());
+    T* to = data_ + (last - begin());
+    if (from != to) {
+      std::destroy(from, to);
+      relocate(to, end(), from);
+      size_ -= static_cast<size_type>(to - from);
+    }
+    return from;
+  }
+
+  void resize(size_type count) {
+    if (count <= size_) {
+      std::destroy(begin() + count, end());
+    } else {
+      reserve(count);
+      std::uninitialized_value_construct(end(), begin() + count);
+    }
+    size_ = count;
+  }
+
+  void resize(size_type count, const T& value) {
+    if (count <= size_) {
+      std::destroy(begin() + count, end());
+    } else if (count > capacity_) {
+      T copy(value);  // value может лежать в старом буфере
+      growTo(count);
+      std::uninitialized_fill(end(), begin() + count, copy);
+    } else {
+      std::uninitialized_fill(end(), begin() + count, value);
+    }
+    size_ = count;
+  }
+
+  void swap(SmallVector& other) noexcept {
+    SmallVector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend bool operator==(const SmallVector& a, const SmallVector& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+  }
+  friend bool operator!=(const SmallVector& a, const SmallVector& b) {
+    return !(a == b);
+  }
+
+ private:
+  template <typename U, std::size_t M>
+  friend class SmallVector;
+
+  static T* allocate(size_type count) {
+    if (count > max_size()) {
+      throw std::length_error("SmallVector: too many elements");
+    }
+    if constexpr (kMallocable) {
+      void* p = std::malloc(count * sizeof(T));
+      if (!p) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(p);
+    } else {
+      return static_cast<T*>(
+          ::operator new(count * sizeof(T), std::align_val_t{alignof(T)}));
+    }
+  }
+
+  static void deallocate(T* p) noexcept {
+    if constexpr (kMallocable) {
+      std::free(p);
+    } else {
+      ::operator delete(p, std::align_val_t{alignof(T)});
+    }
+  }
+
+  // Рост в полтора раза: освобождённые блоки могут переиспользоваться
+  // аллокатором при следующих ростах, в отличие от удвоения.
+  size_type nextCapacity(size_type required) const noexcept {
+    return std::max({required, capacity_ + capacity_ / 2, size_type{4}});
+  }
+
+  void growTo(size_type count) {
+    if constexpr (kUseRealloc) {
+      if (!isInline()) {
+        if (count > max_size()) {
+          throw std::length_error("SmallVector: too many elements");
+        }
+        void* p = std::realloc(static_cast<void*>(data_), count * sizeof(T));
+        if (!p) {
+          throw std::bad_alloc();
+        }
+        data_ = static_cast<T*>(p);
+        capacity_ = count;
+        return;
+      }
+    }
+    T* fresh = allocate(count);
+    uninitialized_relocate(begin(), end(), fresh);
+    release();
+    data_ = fresh;
+    capacity_ = count;
+  }
+
+  template <typename... Args>
+  T* emplaceGrow(size_type idx, Args&&... args) {
+    const size_type count = nextCapacity(size_ + 1);
+    if (kUseRealloc && !isInline()) {
+      alignas(T) unsigned char raw[sizeof(T)];
+      T* value =
+          ::new (static_cast<void*>(raw)) T(std::forward<Args>(args)...);
+      SCOPE_FAIL { std::destroy_at(value); };
+      growTo(count);
+      relocate(data_ + idx, data_ + size_, data_ + idx + 1);
+      relocate_at(value, data_ + idx);
+    } else {
+      // Сначала новый элемент: если он бросит, старый буфер не тронут.
+      T* fresh = allocate(count);
+      SCOPE_FAIL { deallocate(fresh); };
+      ::new (static_cast<void*>(fresh + idx)) T(std::forward<Args>(args)...);
+      uninitialized_relocate(data_, data_ + idx, fresh);
+      uninitialized_relocate(data_ + idx, data_ + size_, fresh + idx + 1);
+      release();
+      data_ = fresh;
+      capacity_ = count;
+    }
+    ++size_;
+    return data_ + idx;
+  }
+
+  // Переносит все элементы fresh на место pos; fresh остаётся пустым.
+  iterator insertRelocating(const_iterator pos, SmallVector<T, 0>& fresh) {
+    const auto idx = static_cast<size_type>(pos - begin());
+    const size_type count = fresh.size_;
+    if (size_ + count > capacity_) {
+      growTo(nextCapacity(size_ + count));
+    }
+    relocate(data_ + idx, data_ + size_, data_ + idx + count);
+    uninitialized_relocate(fresh.begin(), fresh.end(), data_ + idx);
+    fresh.size_ = 0;
+    size_ += count;
+    return data_ + idx;
+  }
+
+  template <typename InputIt>
+  void append(InputIt first, InputIt last) {
+    if constexpr (std::forward_iterator<InputIt>) {
+      reserve(size_ + static_cast<size_type>(std::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  void release() noexcept {
+    if (!isInline()) {
+      deallocate(data_);
+    }
+  }
+
+  void reset() noexcept {
+    clear();
+    release();
+    data_ = inline_.data();
+    capacity_ = N;
+  }
+
+  // Забирает содержимое other; *this пуст и использует встроенный буфер.
+  void steal(SmallVector& other) noexcept {
+    if (!other.isInline()) {
+      data_ = std::exchange(other.data_, other.inline_.data());
+      capacity_ = std::exchange(other.capacity_, N);
+    } else {
+      uninitialized_relocate(other.begin(), other.end(), data_);
+    }
+    size_ = std::exchange(other.size_, 0);
+  }
+
+  T* data_;
+  size_type size_ = 0;
+  size_type capacity_;
+  [[no_unique_address]] privat::InlineBuffer<T, N> inline_;
+};
+
+template <typename T>
+using RelocatingVector = SmallVector<T, 0>;
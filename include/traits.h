@@ -1,5 +1,7 @@
 #pragma once
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 /**
  * Признак для определения, является ли тип специализацией шаблона.
@@ -35,6 +37,49 @@ inline constexpr bool is_specialization_of_v =
       has_member_##member<T>::value;
 
 
+/**
+ * Признак тривиальной перемещаемости (trivially relocatable): объект можно
+ * перенести в другое место памяти побайтовым memcpy, после чего старую
+ * копию просто забыть, не вызывая деструктор. Это верно для всех тривиально
+ * копируемых типов, а также для большинства "обычных" классов, не хранящих
+ * указателей на самих себя: unique_ptr, shared_ptr, структуры из них.
+ *
+ * Автоматически признак выводится только для тривиально копируемых типов.
+ * Остальные типы подключаются явно - специализацией признака или членом
+ *   using IsTriviallyRelocatable = std::true_type;
+ * Помечать так типы со ссылками на себя (в т.ч. std::string из libstdc++ с
+ * его SSO-буфером, std::list) нельзя.
+ */
+template <typename T, typename = void>
+struct has_relocatable_tag : std::false_type {};
+
+template <typename T>
+struct has_relocatable_tag<T, std::void_t<typename T::IsTriviallyRelocatable>>
+    : T::IsTriviallyRelocatable {};
+
+template <typename T>
+struct is_trivially_relocatable
+    : std::bool_constant<std::is_trivially_copyable_v<T> ||
+                         has_relocatable_tag<T>::value> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v =
+    is_trivially_relocatable<std::remove_cv_t<T>>::value;
+
+template <typename T>
+struct is_trivially_relocatable<std::unique_ptr<T>> : std::true_type {};
+
+template <typename T>
+struct is_trivially_relocatable<std::shared_ptr<T>> : std::true_type {};
+
+template <typename T>
+struct is_trivially_relocatable<std::weak_ptr<T>> : std::true_type {};
+
+template <typename A, typename B>
+struct is_trivially_relocatable<std::pair<A, B>>
+    : std::bool_constant<is_trivially_relocatable_v<A> &&
+                         is_trivially_relocatable_v<B>> {};
+
 // OLDSCHOOL STYLE
 
 // Макрос GENERATE_HAS_MEMBER_TRAIT генерирует класс признака (trait) для
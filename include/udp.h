@@ -0,0 +1,897 @@
+#pragma once
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+#include "function.h"
+#include "posix_error.h"
+#include "scope_guard.h"
+
+/**
+ * Пакетный UDP (Game Programming Gems 3: "network", game-servers).
+ *
+ * Один системный вызов на пакет - главный тормоз сервера на сотнях тысяч
+ * мелких датаграмм в секунду, поэтому оба транспорта работают пачками:
+ *  - MmsgTransport - recvmmsg/sendmmsg, пачка за вызов;
+ *  - UringTransport - io_uring: в ядре постоянно висят depth запросов
+ *    RECVMSG, буферы под них ядро само берёт из зарегистрированного
+ *    кольца буферов пула (provided buffer ring), а отправка пачки - один
+ *    io_uring_enter.
+ * Принятые данные отдаются обработчику как std::span прямо на буфер пула,
+ * без копирования; span живёт до возврата из обработчика. Датаграммы
+ * длиннее буфера обрезаются.
+ *
+ * UdpServer<Transport> шардирует порт по потокам через SO_REUSEPORT: у
+ * каждого потока свой сокет, пул и транспорт, ядро раскладывает входящие
+ * по хэшу адреса отправителя. Только Linux.
+ */
+
+class SocketAddress {
+ public:
+  SocketAddress() noexcept = default;
+  SocketAddress(const sockaddr* address, socklen_t size) noexcept
+      : size_(std::min<socklen_t>(size, sizeof(storage_))) {
+    std::memcpy(&storage_, address, size_);
+  }
+
+  static SocketAddress ipv4(const char* host, std::uint16_t port) {
+    sockaddr_in in{};
+    in.sin_family = AF_INET;
+    in.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host, &in.sin_addr) != 1) {
+      throw std::invalid_argument(std::string("bad IPv4 address: ") + host);
+    }
+    return {reinterpret_cast<const sockaddr*>(&in), sizeof(in)};
+  }
+  static SocketAddress loopback(std::uint16_t port = 0) {
+    return ipv4("127.0.0.1", port);
+  }
+
+  std::uint16_t port() const noexcept {
+    if (storage_.ss_family == AF_INET) {
+      return ntohs(reinterpret_cast<const sockaddr_in&>(storage_).sin_port);
+    }
+    if (storage_.ss_family == AF_INET6) {
+      return ntohs(reinterpret_cast<const sockaddr_in6&>(storage_).sin6_port);
+    }
+    return 0;
+  }
+
+  const sockaddr* get() const noexcept {
+    return reinterpret_cast<const sockaddr*>(&storage_);
+  }
+  socklen_t size() const noexcept { return size_; }
+
+  friend bool operator==(const SocketAddress& a,
+                         const SocketAddress& b) noexcept {
+    return a.size_ == b.size_ && std::memcmp(&a.storage_, &b.storage_,
+                                             a.size_) == 0;
+  }
+
+ private:
+  sockaddr_storage storage_{};
+  socklen_t size_ = 0;
+};
+
+// Неблокирующий UDP-сокет, привязанный к адресу.
+class UdpSocket : private Moveonly {
+ public:
+  explicit UdpSocket(const SocketAddress& address, bool reusePort = false) {
+    fd_ = ::socket(address.get()->sa_family,
+                   SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+      privat::throwErrno("socket");
+    }
+    SCOPE_FAIL { ::close(fd_); };
+    if (reusePort) {
+      const int one = 1;
+      if (::setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) !=
+          0) {
+        privat::throwErrno("setsockopt(SO_REUSEPORT)");
+      }
+    }
+    if (::bind(fd_, address.get(), address.size()) != 0) {
+      privat::throwErrno("bind");
+    }
+  }
+
+  UdpSocket(UdpSocket&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+  UdpSocket& operator=(UdpSocket&& other) noexcept {
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+  ~UdpSocket() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  int fd() const noexcept { return fd_; }
+
+  SocketAddress localAddress() const {
+    sockaddr_storage storage{};
+    socklen_t size = sizeof(storage);
+    if (::getsockname(fd_, reinterpret_cast<sockaddr*>(&storage), &size) !=
+        0) {
+      privat::throwErrno("getsockname");
+    }
+    return {reinterpret_cast<const sockaddr*>(&storage), size};
+  }
+
+  // SO_RCVBUF/SO_SNDBUF: на всплесках пакеты теряются в буфере сокета.
+  void setBufferSizes(int bytes) {
+    if (::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) !=
+            0 ||
+        ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes)) !=
+            0) {
+      privat::throwErrno("setsockopt(SO_RCVBUF/SO_SNDBUF)");
+    }
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+/**
+ * Буферы одного размера в одном mmap-регионе (его регистрирует io_uring).
+ * Не потокобезопасен: пул принадлежит одному потоку-шарду.
+ */
+class PacketPool : private UncopyableUnmovable {
+ public:
+  static constexpr std::uint32_t kNone = ~std::uint32_t{0};
+
+  explicit PacketPool(std::uint32_t count, std::size_t bufferSize = 2048)
+      : count_(count), bufferSize_(bufferSize), bytes_(count * bufferSize) {
+    if (count == 0 || bufferSize == 0) {
+      throw std::invalid_argument("PacketPool: empty pool");
+    }
+    void* data = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      privat::throwErrno("mmap");
+    }
+    data_ = static_cast<std::byte*>(data);
+    SCOPE_FAIL { ::munmap(data_, bytes_); };
+    free_.reserve(count);
+    for (std::uint32_t id = count; id-- > 0;) {
+      free_.push_back(id);
+    }
+  }
+  ~PacketPool() { ::munmap(data_, bytes_); }
+
+  std::uint32_t acquire() noexcept {
+    if (free_.empty()) {
+      return kNone;
+    }
+    const std::uint32_t id = free_.back();
+    free_.pop_back();
+    return id;
+  }
+  void release(std::uint32_t id) noexcept { free_.push_back(id); }
+
+  std::byte* buffer(std::uint32_t id) const noexcept {
+    return data_ + std::size_t{id} * bufferSize_;
+  }
+  std::uint32_t count() const noexcept { return count_; }
+  std::size_t bufferSize() const noexcept { return bufferSize_; }
+  std::size_t available() const noexcept { return free_.size(); }
+
+ private:
+  std::uint32_t count_;
+  std::size_t bufferSize_;
+  std::size_t bytes_;
+  std::byte* data_ = nullptr;
+  std::vector<std::uint32_t> free_;
+};
+
+// Исходящая датаграмма: данные и адрес живут до возврата из send().
+struct OutPacket {
+  std::span<const std::byte> payload;
+  const SocketAddress* to;
+};
+
+class MmsgTransport : private UncopyableUnmovable {
+ public:
+  MmsgTransport(UdpSocket& socket, PacketPool& pool, std::size_t batch = 64)
+      : socket_(socket),
+        pool_(pool),
+        batch_(batch),
+        headers_(batch),
+        iovecs_(batch),
+        names_(batch),
+        ids_(batch) {}
+
+  /**
+   * Принимает до batch датаграмм одним recvmmsg и вызывает для каждой
+   * handler(std::span<const std::byte>, const SocketAddress&). Если
+   * ничего нет, ждёт до timeoutMs (-1 - бесконечно). Возвращает число
+   * обработанных датаграмм.
+   */
+  template <typename Handler>
+  std::size_t receive(Handler&& handler, int timeoutMs = 0) {
+    std::size_t count = 0;
+    SCOPE_EXIT {
+      while (count > 0) {
+        pool_.release(ids_[--count]);
+      }
+    };
+    for (; count < batch_; ++count) {
+      ids_[count] = pool_.acquire();
+      if (ids_[count] == PacketPool::kNone) {
+        break;
+      }
+      iovecs_[count] = {pool_.buffer(ids_[count]), pool_.bufferSize()};
+      msghdr& header = headers_[count].msg_hdr;
+      header = {};
+      header.msg_name = &names_[count];
+      header.msg_namelen = sizeof(sockaddr_storage);
+      header.msg_iov = &iovecs_[count];
+      header.msg_iovlen = 1;
+    }
+    if (count == 0) {
+      return 0;
+    }
+    int received = recv(count);
+    if (received < 0 && timeoutMs != 0 && waitFor(POLLIN, timeoutMs)) {
+      received = recv(count);
+    }
+    if (received < 0) {
+      return 0;
+    }
+    for (int i = 0; i < received; ++i) {
+      const mmsghdr& message = headers_[static_cast<std::size_t>(i)];
+      handler(std::span<const std::byte>(
+                  pool_.buffer(ids_[static_cast<std::size_t>(i)]),
+                  message.msg_len),
+              SocketAddress(reinterpret_cast<const sockaddr*>(
+                                &names_[static_cast<std::size_t>(i)]),
+                            message.msg_hdr.msg_namelen));
+    }
+    return static_cast<std::size_t>(received);
+  }
+
+  // Отправляет пачками по batch; возвращает число ушедших датаграмм.
+  std::size_t send(std::span<const OutPacket> packets) {
+    std::size_t sent = 0;
+    std::size_t next = 0;
+    while (next < packets.size()) {
+      const std::size_t count = std::min(batch_, packets.size() - next);
+      for (std::size_t i = 0; i < count; ++i) {
+        const OutPacket& packet = packets[next + i];
+        iovecs_[i] = {const_cast<std::byte*>(packet.payload.data()),
+                      packet.payload.size()};
+        msghdr& header = headers_[i].msg_hdr;
+        header = {};
+        header.msg_name = const_cast<sockaddr*>(packet.to->get());
+        header.msg_namelen = packet.to->size();
+        header.msg_iov = &iovecs_[i];
+        header.msg_iovlen = 1;
+      }
+      const int result = ::sendmmsg(socket_.fd(), headers_.data(),
+                                    static_cast<unsigned>(count), 0);
+      if (result > 0) {
+        sent += static_cast<std::size_t>(result);
+        next += static_cast<std::size_t>(result);
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        waitFor(POLLOUT, -1);
+      } else if (errno != EINTR) {
+        ++next;  // датаграмма отвергнута (EMSGSIZE и т.п.), идём дальше
+      }
+    }
+    return sent;
+  }
+
+ private:
+  int recv(std::size_t count) noexcept {
+    int result = 0;
+    do {
+      result = ::recvmmsg(socket_.fd(), headers_.data(),
+                          static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+    } while (result < 0 && errno == EINTR);
+    return result;
+  }
+
+  bool waitFor(short events, int timeoutMs) noexcept {
+    pollfd fd{socket_.fd(), events, 0};
+    return ::poll(&fd, 1, timeoutMs) > 0;
+  }
+
+  UdpSocket& socket_;
+  PacketPool& pool_;
+  std::size_t batch_;
+  std::vector<mmsghdr> headers_;
+  std::vector<iovec> iovecs_;
+  std::vector<sockaddr_storage> names_;
+  std::vector<std::uint32_t> ids_;
+};
+
+namespace privat {
+
+// Минимальное кольцо io_uring поверх системных вызовов (без liburing).
+class IoUring : private UncopyableUnmovable {
+ public:
+  explicit IoUring(unsigned entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      throwErrno("io_uring_setup");
+    }
+    SCOPE_FAIL { unmapAndClose(); };
+    sqEntries_ = params.sq_entries;
+    sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingBytes_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+      sqRingBytes_ = cqRingBytes_ = std::max(sqRingBytes_, cqRingBytes_);
+    }
+    sqRing_ = map(sqRingBytes_, IORING_OFF_SQ_RING);
+    cqRing_ = single ? sqRing_ : map(cqRingBytes_, IORING_OFF_CQ_RING);
+    sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqesBytes_, IORING_OFF_SQES));
+
+    sqHead_ = field(sqRing_, params.sq_off.head);
+    sqTail_ = field(sqRing_, params.sq_off.tail);
+    sqMask_ = *field(sqRing_, params.sq_off.ring_mask);
+    cqHead_ = field(cqRing_, params.cq_off.head);
+    cqTail_ = field(cqRing_, params.cq_off.tail);
+    cqMask_ = *field(cqRing_, params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cqRing_) +
+                                            params.cq_off.cqes);
+    // SQE подаются строго по порядку: массив индексов - тождественный.
+    unsigned* array = field(sqRing_, params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i) {
+      array[i] = i;
+    }
+    sqeTail_ = *sqTail_;
+  }
+  ~IoUring() { unmapAndClose(); }
+
+  int fd() const noexcept { return fd_; }
+
+  // Свободный SQE (обнулённый) или nullptr, если очередь полна.
+  io_uring_sqe* getSqe() noexcept {
+    const unsigned head =
+        std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire);
+    if (sqeTail_ - head >= sqEntries_) {
+      return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes_[sqeTail_++ & sqMask_];
+    *sqe = {};
+    return sqe;
+  }
+
+  /**
+   * Публикует подготовленные SQE и, если waitFor > 0, ждёт столько CQE,
+   * но не дольше timeoutMs (-1 - без ограничения). false - ядро временно
+   * не приняло SQE (EAGAIN, ENOMEM, EBUSY) или ожидание прервано: SQE
+   * остаются в очереди и уйдут со следующим вызовом. Остальные ошибки
+   * бросаются.
+   */
+  bool submit(unsigned waitFor = 0, int timeoutMs = -1) {
+    std::atomic_ref<unsigned>(*sqTail_).store(sqeTail_,
+                                              std::memory_order_release);
+    const unsigned toSubmit = sqeTail_ - submitted_;
+    if (toSubmit == 0 && waitFor == 0) {
+      return true;
+    }
+    unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec timeout{timeoutMs / 1000,
+                              (timeoutMs % 1000) * 1'000'000ll};
+    io_uring_getevents_arg arg{};
+    const void* argp = nullptr;
+    std::size_t argSize = 0;
+    if (waitFor > 0 && timeoutMs >= 0) {
+      arg.ts = reinterpret_cast<std::uintptr_t>(&timeout);
+      flags |= IORING_ENTER_EXT_ARG;
+      argp = &arg;
+      argSize = sizeof(arg);
+    }
+    const long result = ::syscall(__NR_io_uring_enter, fd_, toSubmit,
+                                  waitFor, flags, argp, argSize);
+    if (result < 0) {
+      if (errno == ETIME || errno == EINTR || errno == EBUSY ||
+          errno == EAGAIN || errno == ENOMEM) {
+        return false;
+      }
+      throwErrno("io_uring_enter");
+    }
+    submitted_ += static_cast<unsigned>(result);
+    return true;
+  }
+
+  // Забирает готовые CQE; голова сдвигается до вызова f.
+  template <typename F>
+  void consume(F&& f) {
+    auto head = std::atomic_ref<unsigned>(*cqHead_);
+    for (;;) {
+      const unsigned current = head.load(std::memory_order_relaxed);
+      if (current == std::atomic_ref<unsigned>(*cqTail_).load(
+                         std::memory_order_acquire)) {
+        return;
+      }
+      const io_uring_cqe cqe = cqes_[current & cqMask_];
+      head.store(current + 1, std::memory_order_release);
+      f(cqe);
+    }
+  }
+
+ private:
+  void* map(std::size_t bytes, std::uint64_t offset) {
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_,
+                     static_cast<off_t>(offset));
+    if (p == MAP_FAILED) {
+      throwErrno("mmap io_uring");
+    }
+    return p;
+  }
+
+  static unsigned* field(void* ring, unsigned offset) noexcept {
+    return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+  }
+
+  void unmapAndClose() noexcept {
+    if (sqes_) {
+      ::munmap(sqes_, sqesBytes_);
+    }
+    if (cqRing_ && cqRing_ != sqRing_) {
+      ::munmap(cqRing_, cqRingBytes_);
+    }
+    if (sqRing_) {
+      ::munmap(sqRing_, sqRingBytes_);
+    }
+    ::close(fd_);
+  }
+
+  int fd_ = -1;
+  unsigned sqEntries_ = 0;
+  std::size_t sqRingBytes_ = 0;
+  std::size_t cqRingBytes_ = 0;
+  std::size_t sqesBytes_ = 0;
+  void* sqRing_ = nullptr;
+  void* cqRing_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  unsigned* sqHead_ = nullptr;
+  unsigned* sqTail_ = nullptr;
+  unsigned sqMask_ = 0;
+  unsigned* cqHead_ = nullptr;
+  unsigned* cqTail_ = nullptr;
+  unsigned cqMask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+  unsigned sqeTail_ = 0;
+  unsigned submitted_ = 0;
+};
+
+}  // namespace privat
+
+class UringTransport : private UncopyableUnmovable {
+ public:
+  // Есть ли io_uring (ядро, seccomp, sysctl kernel.io_uring_disabled).
+  static bool supported() noexcept {
+    static const bool supported = [] {
+      io_uring_params params{};
+      const long fd = ::syscall(__NR_io_uring_setup, 2, &params);
+      if (fd < 0) {
+        return false;
+      }
+      ::close(static_cast<int>(fd));
+      return true;
+    }();
+    return supported;
+  }
+
+  /**
+   * Забирает все буферы пула в кольцо буферов ядра; пул должен быть не
+   * меньше depth. Сокет переводится в блокирующий режим - ожидание
+   * готовности io_uring делает сам, не занимая поток.
+   */
+  UringTransport(UdpSocket& socket, PacketPool& pool, std::size_t depth = 64)
+      : socket_(socket),
+        pool_(pool),
+        depth_(depth),
+        ring_(static_cast<unsigned>(std::bit_ceil(2 * depth))),
+        slots_(depth),
+        sendHeaders_(depth),
+        sendIovecs_(depth) {
+    if (pool.available() < depth || pool.count() > 32768) {
+      throw std::invalid_argument("UringTransport: pool size vs depth");
+    }
+    const int flags = ::fcntl(socket_.fd(), F_GETFL);
+    ::fcntl(socket_.fd(), F_SETFL, flags & ~O_NONBLOCK);
+
+    bufEntries_ = std::bit_ceil(pool.count());
+    bufRingBytes_ = bufEntries_ * sizeof(io_uring_buf);
+    void* ring = ::mmap(nullptr, bufRingBytes_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+      privat::throwErrno("mmap");
+    }
+    bufRing_ = static_cast<io_uring_buf*>(ring);
+    SCOPE_FAIL { ::munmap(bufRing_, bufRingBytes_); };
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<std::uintptr_t>(bufRing_);
+    reg.ring_entries = bufEntries_;
+    reg.bgid = kBufferGroup;
+    if (::syscall(__NR_io_uring_register, ring_.fd(),
+                  IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+      privat::throwErrno("io_uring_register(PBUF_RING)");
+    }
+    for (std::uint32_t id; (id = pool_.acquire()) != PacketPool::kNone;) {
+      provide(static_cast<std::uint16_t>(id));
+      owned_.push_back(id);
+    }
+    publishBuffers();
+    unarmed_.reserve(depth_);
+    for (std::size_t slot = depth_; slot-- > 0;) {
+      unarmed_.push_back(slot);
+    }
+    rearm();
+  }
+
+  ~UringTransport() {
+    // Отменяем висящие RECVMSG и ждём их завершения: до этого ядро ещё
+    // может писать в буферы пула и в slots_.
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+      try {
+        ring_.submit();
+      } catch (...) {
+      }
+      sqe = ring_.getSqe();
+    }
+    if (sqe) {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = socket_.fd();
+      sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_FD;
+      sqe->user_data = kCancelTag;
+    }
+    receivesInFlight_ -= deferred_.size();
+    while (receivesInFlight_ > 0) {
+      try {
+        ring_.submit(1, 100);
+      } catch (...) {
+        break;
+      }
+      ring_.consume([&](const io_uring_cqe& cqe) {
+        if (!(cqe.user_data & (kSendTag | kCancelTag))) {
+          --receivesInFlight_;
+        }
+      });
+    }
+    io_uring_buf_reg reg{};
+    reg.bgid = kBufferGroup;
+    ::syscall(__NR_io_uring_register, ring_.fd(), IORING_UNREGISTER_PBUF_RING,
+              &reg, 1);
+    ::munmap(bufRing_, bufRingBytes_);
+    // Ядро больше не владеет буферами: все они снова в пуле.
+    for (std::uint32_t id : owned_) {
+      pool_.release(id);
+    }
+  }
+
+  // Тот же контракт, что у MmsgTransport::receive.
+  template <typename Handler>
+  std::size_t receive(Handler&& handler, int timeoutMs = 0) {
+    std::size_t handled = 0;
+    auto process = [&](const io_uring_cqe& cqe) {
+      if (cqe.user_data & (kSendTag | kCancelTag)) {
+        return;
+      }
+      // Слот перевзводится в rearm(), вне обработки CQE: там же ошибки
+      // io_uring_enter, которые нельзя бросать из SCOPE_EXIT.
+      --receivesInFlight_;
+      unarmed_.push_back(static_cast<std::size_t>(cqe.user_data));
+      if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+        return;
+      }
+      const auto id =
+          static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      SCOPE_EXIT {
+        provide(id);
+        publishBuffers();
+      };
+      if (cqe.res < 0) {
+        return;
+      }
+      ++handled;
+      const sockaddr_storage& name = slots_[cqe.user_data].name;
+      handler(std::span<const std::byte>(pool_.buffer(id),
+                                         static_cast<std::size_t>(cqe.res)),
+              SocketAddress(reinterpret_cast<const sockaddr*>(&name),
+                            name.ss_family == AF_INET6
+                                ? sizeof(sockaddr_in6)
+                                : sizeof(sockaddr_in)));
+    };
+    // Слоты, которые не удалось перевзвести в прошлый раз (очередь была
+    // полна, ядро вернуло EAGAIN или обработчик бросил исключение).
+    rearm();
+    while (!deferred_.empty()) {
+      const io_uring_cqe cqe = deferred_.back();
+      deferred_.pop_back();
+      process(cqe);
+    }
+    ring_.consume(process);
+    if (handled == 0 && timeoutMs != 0) {
+      rearm();
+      ring_.submit(1, timeoutMs);
+      ring_.consume(process);
+    }
+    rearm();
+    return handled;
+  }
+
+  /**
+   * Отправляет пачками по depth: SENDMSG на каждую датаграмму и один
+   * io_uring_enter на пачку. Возвращает число ушедших датаграмм.
+   */
+  std::size_t send(std::span<const OutPacket> packets) {
+    std::size_t sent = 0;
+    for (std::size_t next = 0; next < packets.size();) {
+      std::size_t count = 0;
+      for (; count < depth_ && next + count < packets.size(); ++count) {
+        io_uring_sqe* sqe = ring_.getSqe();
+        if (!sqe) {
+          break;
+        }
+        const OutPacket& packet = packets[next + count];
+        sendIovecs_[count] = {const_cast<std::byte*>(packet.payload.data()),
+                              packet.payload.size()};
+        msghdr& header = sendHeaders_[count];
+        header = {};
+        header.msg_name = const_cast<sockaddr*>(packet.to->get());
+        header.msg_namelen = packet.to->size();
+        header.msg_iov = &sendIovecs_[count];
+        header.msg_iovlen = 1;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = socket_.fd();
+        sqe->addr = reinterpret_cast<std::uintptr_t>(&header);
+        sqe->len = 1;
+        sqe->user_data = kSendTag | count;
+      }
+      // Ждём всю пачку: заголовки и данные должны дожить до завершения.
+      for (std::size_t pending = count; pending > 0;) {
+        ring_.submit(1);
+        ring_.consume([&](const io_uring_cqe& cqe) {
+          if (cqe.user_data & kCancelTag) {
+            return;
+          }
+          if (!(cqe.user_data & kSendTag)) {
+            deferred_.push_back(cqe);
+            return;
+          }
+          --pending;
+          if (cqe.res >= 0) {
+            ++sent;
+          }
+        });
+      }
+      next += count;
+    }
+    return sent;
+  }
+
+ private:
+  static constexpr std::uint16_t kBufferGroup = 0;
+  static constexpr std::uint64_t kSendTag = std::uint64_t{1} << 62;
+  static constexpr std::uint64_t kCancelTag = std::uint64_t{1} << 61;
+
+  struct ReceiveSlot {
+    msghdr header;
+    iovec iov;
+    sockaddr_storage name;
+  };
+
+  /**
+   * Ставит RECVMSG для слотов из unarmed_, пока есть свободные SQE, и
+   * отправляет их ядру. Что не поместилось или не принято, остаётся до
+   * следующего receive().
+   */
+  void rearm() {
+    while (!unarmed_.empty()) {
+      io_uring_sqe* sqe = ring_.getSqe();
+      if (!sqe) {
+        break;
+      }
+      armReceive(sqe, unarmed_.back());
+      unarmed_.pop_back();
+    }
+    ring_.submit();
+  }
+
+  void armReceive(io_uring_sqe* sqe, std::size_t slot) noexcept {
+    ReceiveSlot& s = slots_[slot];
+    s.iov = {nullptr, pool_.bufferSize()};
+    s.header = {};
+    s.header.msg_name = &s.name;
+    s.header.msg_namelen = sizeof(s.name);
+    s.header.msg_iov = &s.iov;
+    s.header.msg_iovlen = 1;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket_.fd();
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&s.header);
+    sqe->len = 1;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = slot;
+    ++receivesInFlight_;
+  }
+
+  void provide(std::uint16_t id) noexcept {
+    // Хвост кольца лежит в поле resv нулевого элемента: его не трогаем.
+    io_uring_buf& buf = bufRing_[bufTail_++ & (bufEntries_ - 1)];
+    buf.addr = reinterpret_cast<std::uintptr_t>(pool_.buffer(id));
+    buf.len = static_cast<std::uint32_t>(pool_.bufferSize());
+    buf.bid = id;
+  }
+
+  void publishBuffers() noexcept {
+    std::atomic_ref<std::uint16_t>(bufRing_[0].resv)
+        .store(bufTail_, std::memory_order_release);
+  }
+
+  UdpSocket& socket_;
+  PacketPool& pool_;
+  std::size_t depth_;
+  privat::IoUring ring_;
+  std::vector<ReceiveSlot> slots_;
+  std::vector<msghdr> sendHeaders_;
+  std::vector<iovec> sendIovecs_;
+  std::vector<io_uring_cqe> deferred_;
+  std::vector<std::size_t> unarmed_;  // ждут RECVMSG; ёмкость depth_
+  io_uring_buf* bufRing_ = nullptr;
+  std::size_t bufRingBytes_ = 0;
+  std::uint32_t bufEntries_ = 0;
+  std::uint16_t bufTail_ = 0;
+  std::vector<std::uint32_t> owned_;
+  std::size_t receivesInFlight_ = 0;
+};
+
+/**
+ * UDP-сервер на shards потоков с SO_REUSEPORT. Обработчик вызывается
+ * из потоков шардов параллельно (должен быть потокобезопасен) с
+ * UdpServer::Shard& - через него можно ответить: ответы копируются и
+ * уходят одной пачкой после обработки текущей пачки входящих.
+ */
+template <typename Transport>
+class UdpServer : private UncopyableUnmovable {
+ public:
+  struct Options {
+    std::size_t shards = std::max(1u, std::thread::hardware_concurrency());
+    std::uint32_t buffers = 1024;
+    std::size_t bufferSize = 2048;
+    std::size_t batch = 64;
+    int pollMs = 20;  // как часто потоки проверяют stop()
+  };
+
+  class Shard : private UncopyableUnmovable {
+   public:
+    std::size_t index() const noexcept { return index_; }
+
+    // false, если payload не влезает в буфер ответа.
+    bool reply(std::span<const std::byte> payload, const SocketAddress& to) {
+      if (payload.size() > bufferSize_) {
+        return false;
+      }
+      if (replies_.size() == batch_) {
+        flush();
+      }
+      const std::size_t slot = replies_.size();
+      std::byte* data = replyData_.data() + slot * bufferSize_;
+      std::memcpy(data, payload.data(), payload.size());
+      replyTo_[slot] = to;
+      replies_.push_back({{data, payload.size()}, &replyTo_[slot]});
+      return true;
+    }
+
+   private:
+    friend class UdpServer;
+
+    Shard(std::size_t index, UdpSocket socket, const Options& options)
+        : index_(index),
+          batch_(options.batch),
+          bufferSize_(options.bufferSize),
+          socket_(std::move(socket)),
+          pool_(options.buffers, options.bufferSize),
+          transport_(socket_, pool_, options.batch),
+          replyData_(options.batch * options.bufferSize),
+          replyTo_(options.batch) {
+      replies_.reserve(options.batch);
+    }
+
+    void flush() {
+      if (!replies_.empty()) {
+        transport_.send(replies_);
+        replies_.clear();
+      }
+    }
+
+    std::size_t index_;
+    std::size_t batch_;
+    std::size_t bufferSize_;
+    UdpSocket socket_;
+    PacketPool pool_;
+    Transport transport_;
+    std::vector<std::byte> replyData_;
+    std::vector<SocketAddress> replyTo_;
+    std::vector<OutPacket> replies_;
+  };
+
+  using Handler = UniqueFunction<void(Shard&, std::span<const std::byte>,
+                                      const SocketAddress&)>;
+
+  UdpServer(const SocketAddress& address, Handler handler,
+            Options options = {})
+      : handler_(std::move(handler)) {
+    // Первый сокет разрешает порт 0 в конкретный, остальные садятся на него.
+    UdpSocket first(address, true);
+    address_ = first.localAddress();
+    shards_.reserve(options.shards);
+    for (std::size_t i = 0; i < options.shards; ++i) {
+      UdpSocket socket = i == 0 ? std::move(first) : UdpSocket(address_, true);
+      shards_.emplace_back(new Shard(i, std::move(socket), options));
+    }
+    SCOPE_FAIL { stop(); };
+    threads_.reserve(options.shards);
+    for (auto& shard : shards_) {
+      threads_.emplace_back([this, &shard = *shard, poll = options.pollMs] {
+        run(shard, poll);
+      });
+    }
+  }
+
+  ~UdpServer() { stop(); }
+
+  void stop() {
+    stopping_.store(true, std::memory_order_relaxed);
+    for (std::thread& thread : threads_) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+  }
+
+  const SocketAddress& address() const noexcept { return address_; }
+  std::uint16_t port() const noexcept { return address_.port(); }
+  std::size_t shardCount() const noexcept { return shards_.size(); }
+
+ private:
+  void run(Shard& shard, int pollMs) {
+    while (!stopping_.load(std::memory_order_relaxed)) {
+      shard.transport_.receive(
+          [&](std::span<const std::byte> payload, const SocketAddress& from) {
+            handler_(shard, payload, from);
+          },
+          pollMs);
+      shard.flush();
+    }
+  }
+
+  Handler handler_;
+  SocketAddress address_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stopping_{false};
+};
@@ -0,0 +1,98 @@
+// Замена глобальных operator new/delete на SlabHeap. Подключается к
+// исполняемому файлу целиком, через CMake-цель slab_new_delete:
+//   target_link_libraries(app PRIVATE slab_new_delete)
+// malloc/free при этом остаются системными.
+
+#include <cstddef>
+#include <new>
+
+#include "slab_allocator.h"
+
+namespace {
+
+void* allocateOrThrow(std::size_t size, std::size_t align) {
+  for (;;) {
+    if (void* p = SlabHeap::allocate(size, align)) {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void* allocateOrNull(std::size_t size, std::size_t align) noexcept {
+  try {
+    return allocateOrThrow(size, align);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+constexpr std::size_t kDefaultAlign = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return allocateOrThrow(size, kDefaultAlign);
+}
+void* operator new[](std::size_t size) {
+  return allocateOrThrow(size, kDefaultAlign);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocateOrNull(size, kDefaultAlign);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocateOrNull(size, kDefaultAlign);
+}
+void* operator new(std::size_t size, std::align_val_t align) {
+  return allocateOrThrow(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align) {
+  return allocateOrThrow(size, static_cast<std::size_t>(align));
+}
+void* operator new(std::size_t size, std::align_val_t align,
+                   const std::nothrow_t&) noexcept {
+  return allocateOrNull(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align,
+                     const std::nothrow_t&) noexcept {
+  return allocateOrNull(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void* p) noexcept { SlabHeap::deallocate(p); }
+void operator delete[](void* p) noexcept { SlabHeap::deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete(void* p, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  SlabHeap::deallocate(p);
+}
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  SlabHeap::deallocate(p);
+}
@@ -0,0 +1,421 @@
+#include "btree.h"
+#include "olc_btree.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Counted {
+  static inline int alive = 0;
+  explicit Counted(int v = 0) : value(v) { ++alive; }
+  Counted(const Counted& other) : value(other.value) { ++alive; }
+  Counted(Counted&& other) noexcept : value(other.value) { ++alive; }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() { --alive; }
+  int value;
+};
+
+// Конструктор бросает для отрицательных значений.
+struct Throwing : Counted {
+  explicit Throwing(int v) : Counted(v) {
+    if (v < 0) {
+      throw std::runtime_error("throwing value");
+    }
+  }
+};
+
+// Копирование бросает, когда исчерпан бюджет copiesLeft (< 0 - без него).
+struct CopyBudget {
+  static inline int copiesLeft = -1;
+
+  static void spend() {
+    if (copiesLeft == 0) {
+      throw std::runtime_error("copy budget exhausted");
+    }
+    if (copiesLeft > 0) {
+      --copiesLeft;
+    }
+  }
+};
+
+struct BudgetValue : Counted {
+  explicit BudgetValue(int v = 0) : Counted(v) {}
+  BudgetValue(const BudgetValue& other) : Counted(other) {
+    CopyBudget::spend();
+  }
+  BudgetValue(BudgetValue&&) noexcept = default;
+  BudgetValue& operator=(const BudgetValue&) = default;
+};
+
+struct BudgetKey {
+  BudgetKey() = default;
+  explicit BudgetKey(int v) noexcept : value(v) {}
+  BudgetKey(const BudgetKey& other) : value(other.value) {
+    CopyBudget::spend();
+  }
+  BudgetKey(BudgetKey&&) noexcept = default;
+  BudgetKey& operator=(const BudgetKey&) = default;
+  BudgetKey& operator=(BudgetKey&&) noexcept = default;
+  friend bool operator<(const BudgetKey& a, const BudgetKey& b) noexcept {
+    return a.value < b.value;
+  }
+  int value = 0;
+};
+
+}  // namespace
+
+TEST(BTree, MapBasic_Test) {
+  BTreeMap<int, std::string> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.insert({2, "two"}).second);
+  EXPECT_FALSE(map.insert({2, "again"}).second);
+  map[1] = "one";
+  map.emplace(3, "three");
+  EXPECT_EQ(map.size(), 3u);
+  EXPECT_EQ(map.at(2), "two");
+  EXPECT_THROW(map.at(4), std::out_of_range);
+  EXPECT_FALSE(map.insert_or_assign(2, "TWO").second);
+  EXPECT_EQ(map.find(2)->second, "TWO");
+  EXPECT_TRUE(map.contains(3));
+  EXPECT_EQ(map.count(5), 0u);
+
+  std::vector<int> keys;
+  for (auto& [key, value] : map) {
+    keys.push_back(key);
+    value += "!";
+  }
+  EXPECT_EQ(keys, (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(map[1], "one!");
+
+  EXPECT_EQ(map.erase(2), 1u);
+  EXPECT_EQ(map.erase(2), 0u);
+  EXPECT_EQ(map.find(2), map.end());
+  EXPECT_TRUE(map.verify());
+}
+
+TEST(BTree, RandomAgainstStdMap_Test) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> keyDist(0, 5000);
+  BTreeMap<int, int> tree;
+  std::map<int, int> reference;
+  for (int step = 0; step < 40000; ++step) {
+    const int key = keyDist(rng);
+    if (rng() % 3 == 0) {
+      EXPECT_EQ(tree.erase(key), reference.erase(key));
+    } else {
+      EXPECT_EQ(tree.try_emplace(key, step).second,
+                reference.try_emplace(key, step).second);
+    }
+    if (step % 4000 == 0) {
+      ASSERT_TRUE(tree.verify());
+    }
+  }
+  ASSERT_TRUE(tree.verify());
+  ASSERT_EQ(tree.size(), reference.size());
+  EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin()));
+  EXPECT_TRUE((tree == BTreeMap<int, int>(reference.begin(), reference.end())));
+  EXPECT_TRUE(std::equal(tree.rbegin(), tree.rend(), reference.rbegin()));
+
+  for (int key = -1; key < 5002; key += 7) {
+    auto lb = tree.lower_bound(key);
+    auto ub = tree.upper_bound(key);
+    auto rlb = reference.lower_bound(key);
+    auto rub = reference.upper_bound(key);
+    EXPECT_EQ(lb == tree.end(), rlb == reference.end());
+    if (lb != tree.end()) {
+      EXPECT_EQ(lb->first, rlb->first);
+    }
+    EXPECT_EQ(ub == tree.end(), rub == reference.end());
+    if (ub != tree.end()) {
+      EXPECT_EQ(ub->first, rub->first);
+    }
+  }
+
+  while (!reference.empty()) {
+    reference.erase(reference.begin());
+    tree.erase(tree.begin());
+    ASSERT_EQ(tree.empty() ? -1 : tree.begin()->first,
+              reference.empty() ? -1 : reference.begin()->first);
+  }
+  EXPECT_TRUE(tree.empty());
+  EXPECT_TRUE(tree.verify());
+}
+
+TEST(BTree, SequentialInsertPacksLeaves_Test) {
+  BTreeSet<long> ascending;
+  for (long i = 0; i < 10000; ++i) {
+    ascending.insert(i);
+  }
+  EXPECT_TRUE(ascending.verify());
+  long expected = 0;
+  for (long key : ascending) {
+    EXPECT_EQ(key, expected++);
+  }
+  EXPECT_EQ(expected, 10000);
+
+  for (long i = 9999; i >= 5000; --i) {
+    ascending.erase(i);
+  }
+  EXPECT_TRUE(ascending.verify());
+  EXPECT_EQ(*ascending.rbegin(), 4999);
+}
+
+TEST(BTree, BulkLoad_Test) {
+  for (std::size_t n : {0u, 1u, 7u, 100u, 1000u, 12345u}) {
+    std::vector<std::pair<int, int>> sorted;
+    for (std::size_t i = 0; i < n; ++i) {
+      sorted.emplace_back(static_cast<int>(2 * i), static_cast<int>(i));
+    }
+    BTreeMap<int, int> map(sorted_unique, sorted.begin(), sorted.end());
+    ASSERT_TRUE(map.verify()) << n;
+    ASSERT_EQ(map.size(), n);
+    EXPECT_TRUE(std::equal(map.begin(), map.end(), sorted.begin(),
+                           [](const auto& a, const auto& b) {
+                             return a.first == b.first &&
+                                    a.second == b.second;
+                           }));
+    // Дерево после bulk-load остаётся обычным: вставки и удаления работают.
+    map[1] = -1;
+    map.erase(0);
+    EXPECT_TRUE(map.verify());
+  }
+}
+
+TEST(BTree, CopyMoveAndLifetime_Test) {
+  {
+    BTreeMap<int, Counted> map;
+    for (int i = 0; i < 500; ++i) {
+      map.try_emplace(i, i);
+    }
+    EXPECT_EQ(Counted::alive, 500);
+    BTreeMap<int, Counted> copy = map;
+    EXPECT_EQ(Counted::alive, 1000);
+    EXPECT_TRUE(copy.verify());
+    BTreeMap<int, Counted> moved = std::move(map);
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(Counted::alive, 1000);
+    for (int i = 0; i < 500; i += 2) {
+      moved.erase(i);
+    }
+    EXPECT_EQ(Counted::alive, 750);
+    EXPECT_EQ(copy.find(42)->second.value, 42);
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(BTree, ThrowingValueLeavesTreeIntact_Test) {
+  {
+    BTreeMap<int, Throwing> map;
+    std::map<int, int> reference;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 5000; ++i) {
+      const int key = static_cast<int>(rng() % 2000);
+      const bool fail = rng() % 3 == 0;
+      if (fail) {
+        const bool existed = map.contains(key);
+        if (existed) {
+          // Ключ уже есть - значение не строится, исключения нет.
+          EXPECT_FALSE(map.try_emplace(key, -1).second);
+        } else {
+          EXPECT_THROW(map.try_emplace(key, -1), std::runtime_error);
+        }
+      } else if (map.try_emplace(key, key).second) {
+        reference.emplace(key, key);
+      }
+      ASSERT_EQ(map.size(), reference.size());
+    }
+    EXPECT_TRUE(map.verify());
+    EXPECT_EQ(Counted::alive, static_cast<int>(reference.size()));
+    auto it = map.begin();
+    for (const auto& [key, value] : reference) {
+      ASSERT_EQ(it->first, key);
+      EXPECT_EQ(it->second.value, value);
+      ++it;
+    }
+
+    BTreeMap<int, Throwing> empty;
+    EXPECT_THROW(empty.try_emplace(1, -1), std::runtime_error);
+    EXPECT_TRUE(empty.empty());
+    EXPECT_TRUE(empty.verify());
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(BTree, ThrowingCopyDuringBulkLoad_Test) {
+  using Map = BTreeMap<int, BudgetValue>;
+  {
+    Map map;
+    for (int i = 0; i < 2000; ++i) {
+      map.try_emplace(i, i);
+    }
+    for (const int budget : {0, 1, 100, 1999}) {
+      CopyBudget::copiesLeft = budget;
+      EXPECT_THROW(Map copy(map), std::runtime_error);
+      CopyBudget::copiesLeft = -1;
+      EXPECT_EQ(Counted::alive, 2000);
+    }
+    Map copy(map);
+    EXPECT_TRUE(copy.verify());
+    EXPECT_EQ(Counted::alive, 4000);
+  }
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(BTree, ThrowingKeyCopyDuringSplit_Test) {
+  BTreeSet<BudgetKey> set;
+  std::mt19937 rng(11);
+  std::set<int> reference;
+  for (int i = 0; i < 3000; ++i) {
+    const BudgetKey key(static_cast<int>(rng() % 100000));
+    // Бюджет растёт, пока вставка не пройдёт: исключение пробуется в
+    // каждом месте, где вставка копирует ключ, включая разделение узлов.
+    for (int budget = 0;; ++budget) {
+      CopyBudget::copiesLeft = budget;
+      bool thrown = false;
+      try {
+        set.insert(key);
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+      CopyBudget::copiesLeft = -1;
+      if (!thrown) {
+        break;
+      }
+      ASSERT_EQ(set.size(), reference.size());
+      ASSERT_EQ(set.contains(key), reference.count(key.value) != 0);
+    }
+    reference.insert(key.value);
+  }
+  ASSERT_TRUE(set.verify());
+  ASSERT_EQ(set.size(), reference.size());
+  auto it = set.begin();
+  for (const int value : reference) {
+    ASSERT_EQ(it->value, value);
+    ++it;
+  }
+}
+
+TEST(BTree, StringKeysAndRangeErase_Test) {
+  BTreeSet<std::string, std::greater<>> set;
+  std::set<std::string, std::greater<>> reference;
+  for (int i = 0; i < 2000; ++i) {
+    const std::string key = "key" + std::to_string(i * 7919 % 2000);
+    set.insert(key);
+    reference.insert(key);
+  }
+  ASSERT_TRUE(set.verify());
+  EXPECT_TRUE(std::equal(set.begin(), set.end(), reference.begin(),
+                         reference.end()));
+
+  auto first = set.lower_bound("key500");
+  auto last = set.lower_bound("key1500");
+  set.erase(first, last);
+  reference.erase(reference.lower_bound("key500"),
+                  reference.lower_bound("key1500"));
+  ASSERT_TRUE(set.verify());
+  EXPECT_TRUE(std::equal(set.begin(), set.end(), reference.begin(),
+                         reference.end()));
+}
+
+TEST(BTree, SimdSearch_Test) {
+  std::vector<std::int32_t> keys32 = {-5, -1, 0, 3, 3, 8, 9, 10, 11, 12};
+  std::vector<std::int64_t> keys64 = {-5, -1, 0, 3, 3, 8, 9, 10, 11, 12};
+  for (int needle = -7; needle < 14; ++needle) {
+    const auto lower = static_cast<std::size_t>(
+        std::lower_bound(keys32.begin(), keys32.end(), needle) -
+        keys32.begin());
+    const auto upper = static_cast<std::size_t>(
+        std::upper_bound(keys32.begin(), keys32.end(), needle) -
+        keys32.begin());
+    EXPECT_EQ(privat::countBelow<false>(keys32.data(), keys32.size(), needle),
+              lower);
+    EXPECT_EQ(privat::countBelow<true>(keys32.data(), keys32.size(), needle),
+              upper);
+    EXPECT_EQ(privat::countBelow<false>(keys64.data(), keys64.size(),
+                                        std::int64_t{needle}),
+              lower);
+    EXPECT_EQ(privat::countBelow<true>(keys64.data(), keys64.size(),
+                                       std::int64_t{needle}),
+              upper);
+  }
+}
+
+TEST(OlcBTree, Basic_Test) {
+  OlcBTreeMap<long, long> map;
+  EXPECT_FALSE(map.find(1).has_value());
+  for (long i = 0; i < 5000; ++i) {
+    EXPECT_TRUE(map.insert(i * 3 % 5000, i));
+  }
+  EXPECT_FALSE(map.insert(3, -1));
+  EXPECT_EQ(map.find(3), 1);
+  EXPECT_FALSE(map.insertOrAssign(3, -1));
+  EXPECT_EQ(map.find(3), -1);
+  EXPECT_EQ(map.size(), 5000u);
+
+  std::vector<long> seen;
+  EXPECT_EQ(map.scan(4990, 100, [&](long k, long) { seen.push_back(k); }),
+            10u);
+  EXPECT_EQ(seen.front(), 4990);
+  EXPECT_EQ(seen.back(), 4999);
+
+  for (long i = 0; i < 5000; i += 2) {
+    EXPECT_TRUE(map.erase(i));
+  }
+  EXPECT_FALSE(map.erase(0));
+  EXPECT_EQ(map.size(), 2500u);
+  seen.clear();
+  map.scan(0, 10, [&](long k, long) { seen.push_back(k); });
+  EXPECT_EQ(seen, (std::vector<long>{1, 3, 5, 7, 9, 11, 13, 15, 17, 19}));
+}
+
+TEST(OlcBTree, ConcurrentReaders_Test) {
+  constexpr long kKeys = 20000;
+  OlcBTreeMap<long, long> map;
+  // Чётные ключи есть всегда, нечётные вставляет и удаляет писатель.
+  for (long i = 0; i < kKeys; i += 2) {
+    map.insert(i, i);
+  }
+  std::atomic<bool> stop{false};
+  std::atomic<long> errors{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&, t] {
+      std::mt19937 rng(static_cast<unsigned>(t));
+      while (!stop) {
+        const long key = static_cast<long>(rng() % kKeys) & ~1L;
+        if (map.find(key) != key) {
+          ++errors;
+        }
+        long prev = -1;
+        map.scan(key, 50, [&](long k, long v) {
+          if (k <= prev || v != k) {
+            ++errors;
+          }
+          prev = k;
+        });
+      }
+    });
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (long i = 1; i < kKeys; i += 2) {
+      map.insert(i, i);
+    }
+    for (long i = 1; i < kKeys; i += 2) {
+      map.erase(i);
+    }
+  }
+  stop = true;
+  for (auto& th : readers) {
+    th.join();
+  }
+  EXPECT_EQ(errors.load(), 0);
+  EXPECT_EQ(map.size(), static_cast<std::size_t>(kKeys / 2));
+}
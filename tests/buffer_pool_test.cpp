@@ -0,0 +1,273 @@
+#include "buffer_pool.h"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+std::string_view text(const BufferRef& buffer) {
+  return {reinterpret_cast<const char*>(buffer.data().data()), buffer.size()};
+}
+
+BufferRef fill(BufferPool& pool, std::string_view s) {
+  UniqueBufferRef buffer = pool.acquire();
+  std::memcpy(buffer.mutableData().data(), s.data(), s.size());
+  return std::move(buffer).slice(0, s.size()).share();
+}
+
+// Байты, выделенные через malloc и ещё не освобождённые.
+std::size_t mallocInUse() {
+  const struct mallinfo2 info = ::mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+std::string chainText(const BufferChain& chain) {
+  std::string out(chain.size(), '\0');
+  chain.copyTo(std::as_writable_bytes(std::span(out.data(), out.size())));
+  return out;
+}
+
+}  // namespace
+
+static_assert(std::is_copy_constructible_v<BufferRef>);
+static_assert(std::is_nothrow_move_constructible_v<BufferRef>);
+static_assert(!std::is_copy_constructible_v<UniqueBufferRef>);
+static_assert(!std::is_copy_assignable_v<UniqueBufferRef>);
+static_assert(std::is_nothrow_move_constructible_v<UniqueBufferRef>);
+static_assert(std::is_nothrow_move_assignable_v<UniqueBufferRef>);
+static_assert(std::is_convertible_v<UniqueBufferRef&&, BufferRef>);
+static_assert(!std::is_convertible_v<BufferRef, UniqueBufferRef>);
+
+TEST(BufferPool, AcquireGivesWholeBlock_Test) {
+  BufferPool pool(1000, 4);
+  UniqueBufferRef buffer = pool.acquire();
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(buffer.size(), 1000u);
+  EXPECT_EQ(buffer.useCount(), 1u);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data().data()) % 64, 0u);
+  std::memset(buffer.mutableData().data(), 0xAB, buffer.size());
+  EXPECT_EQ(pool.stats().totalBlocks, 4u);
+  EXPECT_EQ(pool.stats().liveBlocks, 1u);
+  buffer.reset();
+  EXPECT_FALSE(buffer);
+  EXPECT_EQ(pool.stats().liveBlocks, 0u);
+}
+
+TEST(BufferPool, SlicesShareTheBlock_Test) {
+  BufferPool pool(64);
+  const BufferRef message = fill(pool, "header:body-bytes");
+  EXPECT_EQ(message.useCount(), 1u);
+  BufferRef header = message.slice(0, 6);
+  BufferRef body = message.slice(7);
+  EXPECT_EQ(text(header), "header");
+  EXPECT_EQ(text(body), "body-bytes");
+  EXPECT_EQ(text(body.slice(5, 100)), "bytes");
+  EXPECT_EQ(message.useCount(), 3u);
+  // Под-кусок указывает в тот же блок, без копии.
+  EXPECT_EQ(body.data().data(), message.data().data() + 7);
+
+  BufferRef copy = header;
+  EXPECT_EQ(message.useCount(), 4u);
+  copy.removePrefix(1);
+  copy.removeSuffix(1);
+  EXPECT_EQ(text(copy), "eade");
+  EXPECT_EQ(text(header), "header");
+  BufferRef moved = std::move(copy);
+  EXPECT_FALSE(copy);
+  EXPECT_EQ(message.useCount(), 4u);
+}
+
+TEST(BufferPool, BlockReturnsWhenLastSliceDrops_Test) {
+  BufferPool pool(128, 1, 1);
+  BufferRef body;
+  {
+    const BufferRef message = fill(pool, "abcdef");
+    body = message.slice(3);
+    EXPECT_FALSE(pool.tryAcquire());  // единственный блок занят
+  }
+  EXPECT_EQ(pool.stats().liveBlocks, 1u);
+  EXPECT_EQ(text(body), "def");
+  body = BufferRef();
+  EXPECT_EQ(pool.stats().liveBlocks, 0u);
+  EXPECT_TRUE(pool.tryAcquire());
+  EXPECT_THROW(
+      {
+        UniqueBufferRef held = pool.acquire();
+        pool.acquire();
+      },
+      std::bad_alloc);
+}
+
+TEST(BufferPool, DestructionFreesChunksOnLiveThread_Test) {
+  // Поток жив всё время: кэш потока не должен удерживать пулы.
+  const std::size_t before = mallocInUse();
+  for (int i = 0; i < 50; ++i) {
+    BufferPool pool(64 * 1024, 16);
+    UniqueBufferRef buffer = pool.acquire();
+    std::memset(buffer.mutableData().data(), 1, buffer.size());
+  }
+  EXPECT_LT(mallocInUse(), before + 4 * 1024 * 1024);
+
+  // То же для пула, блоки которого вернулись в кэш другого живого потока.
+  std::atomic<BufferPool*> current{nullptr};
+  std::atomic<int> step{0};
+  std::thread releaser([&] {
+    for (int i = 0; i < 20; ++i) {
+      while (step.load() != 2 * i + 1) {
+        std::this_thread::yield();
+      }
+      current.load()->acquire().reset();
+      step.store(2 * i + 2);
+    }
+  });
+  const std::size_t middle = mallocInUse();
+  for (int i = 0; i < 20; ++i) {
+    BufferPool pool(64 * 1024, 16);
+    current = &pool;
+    step.store(2 * i + 1);
+    while (step.load() != 2 * i + 2) {
+      std::this_thread::yield();
+    }
+  }
+  releaser.join();
+  EXPECT_LT(mallocInUse(), middle + 4 * 1024 * 1024);
+}
+
+TEST(BufferPool, ReusesBlocks_Test) {
+  BufferPool pool(256, 8);
+  std::set<const std::byte*> seen;
+  for (int round = 0; round < 100; ++round) {
+    std::vector<UniqueBufferRef> buffers;
+    for (int i = 0; i < 8; ++i) {
+      buffers.push_back(pool.acquire());
+      seen.insert(buffers.back().data().data());
+    }
+  }
+  EXPECT_EQ(pool.stats().totalBlocks, 8u);
+  EXPECT_EQ(seen.size(), 8u);
+}
+
+TEST(BufferPool, CrossThreadReleaseAndReuse_Test) {
+  BufferPool pool(64, 32);
+  constexpr int kMessages = 20000;
+  std::vector<BufferRef> queue(kMessages);
+  std::atomic<int> produced{0};
+  std::thread producer([&] {
+    for (int i = 0; i < kMessages; ++i) {
+      queue[static_cast<std::size_t>(i)] = fill(pool, std::to_string(i));
+      produced.store(i + 1, std::memory_order_release);
+    }
+  });
+  std::thread consumer([&] {
+    for (int i = 0; i < kMessages; ++i) {
+      while (produced.load(std::memory_order_acquire) <= i) {
+        std::this_thread::yield();
+      }
+      BufferRef message = std::move(queue[static_cast<std::size_t>(i)]);
+      EXPECT_EQ(text(message), std::to_string(i));
+    }
+  });
+  producer.join();
+  consumer.join();
+  EXPECT_EQ(pool.stats().liveBlocks, 0u);
+  // Возвраты шли в кэш потребителя и в общий стек, а не в новые чанки.
+  EXPECT_LT(pool.stats().totalBlocks, std::size_t{kMessages});
+}
+
+TEST(BufferPool, ConcurrentAcquireRelease_Test) {
+  BufferPool pool(32, 16);
+  constexpr int kThreads = 8;
+  std::vector<std::thread> threads;
+  std::atomic<bool> corrupted{false};
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<UniqueBufferRef> held;
+      for (int i = 0; i < 20000; ++i) {
+        if (held.size() < 40 && (i * 7 + t) % 3 != 0) {
+          held.push_back(pool.acquire());
+          held.back().mutableData()[0] = static_cast<std::byte>(t);
+        } else if (!held.empty()) {
+          if (held.back().data()[0] != static_cast<std::byte>(t)) {
+            corrupted = true;
+          }
+          held.pop_back();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(corrupted);
+  EXPECT_EQ(pool.stats().liveBlocks, 0u);
+}
+
+TEST(BufferPool, ChainConsumeAndWritev_Test) {
+  BufferPool pool(64);
+  const BufferRef message = fill(pool, "GET /index HTTP/1.1");
+  BufferChain chain;
+  chain.append(message.slice(0, 4));
+  chain.append(fill(pool, "/other"));
+  chain.append(message.slice(10));
+  chain.append(BufferRef());  // пустые куски не добавляются
+  EXPECT_EQ(chain.partCount(), 3u);
+  EXPECT_EQ(chainText(chain), "GET /other HTTP/1.1");
+
+  SmallVector<iovec, 4> iov;
+  chain.toIovecs(iov);
+  ASSERT_EQ(iov.size(), 3u);
+  EXPECT_EQ(iov[0].iov_base, message.data().data());
+
+  chain.consume(6);
+  EXPECT_EQ(chainText(chain), "ther HTTP/1.1");
+  EXPECT_EQ(chain.partCount(), 2u);
+
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+  EXPECT_EQ(chain.writeTo(fds[1]), 13u);
+  EXPECT_TRUE(chain.empty());
+  char out[32] = {};
+  EXPECT_EQ(::read(fds[0], out, sizeof(out)), 13);
+  EXPECT_EQ(std::string_view(out), "ther HTTP/1.1");
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  BufferChain other;
+  other.append(message.slice(0, 3));
+  chain.append(std::move(other));
+  EXPECT_TRUE(other.empty());
+  EXPECT_EQ(chainText(chain), "GET");
+}
+
+TEST(BufferPool, WritevStopsOnFullNonblockingPipe_Test) {
+  BufferPool pool(4096);
+  int fds[2];
+  ASSERT_EQ(::pipe2(fds, O_NONBLOCK), 0);
+  BufferChain chain;
+  const BufferRef page = [&] {
+    UniqueBufferRef buffer = pool.acquire();
+    std::memset(buffer.mutableData().data(), 'x', buffer.size());
+    return std::move(buffer).share();
+  }();
+  for (int i = 0; i < 64; ++i) {
+    chain.append(page);  // 256 КиБ - больше буфера канала
+  }
+  const std::size_t total = chain.size();
+  const std::size_t written = chain.writeTo(fds[1]);
+  EXPECT_GT(written, 0u);
+  EXPECT_LT(written, total);
+  EXPECT_EQ(chain.size(), total - written);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
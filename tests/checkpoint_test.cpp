@@ -0,0 +1,260 @@
+#include "checkpoint.h"
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kPages = 64;
+
+std::string tempPath(const char* name) {
+  return testing::TempDir() + name + std::to_string(::getpid()) + ".ckpt";
+}
+
+// Снимок содержимого арены для сравнения после восстановления.
+std::vector<std::byte> contents(const CheckpointArena& arena) {
+  return {arena.data(), arena.data() + arena.used()};
+}
+
+void touch(CheckpointArena& arena, std::size_t page, std::uint8_t value) {
+  arena.data()[page * arena.pageSize() + 7] = std::byte{value};
+}
+
+class CheckpointTest : public testing::TestWithParam<DirtyTracking> {
+ protected:
+  void SetUp() override {
+    if (GetParam() == DirtyTracking::softDirty &&
+        !CheckpointArena::softDirtySupported()) {
+      GTEST_SKIP() << "kernel does not track soft-dirty bits";
+    }
+    path_ = tempPath("checkpoint_test_");
+  }
+  void TearDown() override { ::unlink(path_.c_str()); }
+
+  // Без отслеживания грязной считается каждая занятая страница.
+  static std::vector<std::uint32_t> dirty(const CheckpointArena& arena,
+                                          std::vector<std::uint32_t> pages) {
+    if (GetParam() == DirtyTracking::none) {
+      pages.resize(arena.usedPages());
+      for (std::size_t i = 0; i < pages.size(); ++i) {
+        pages[i] = static_cast<std::uint32_t>(i);
+      }
+    }
+    return pages;
+  }
+
+  std::string path_;
+};
+
+}  // namespace
+
+TEST_P(CheckpointTest, TracksWrittenPages_Test) {
+  CheckpointArena arena(kPages * privat::systemPageSize(), GetParam());
+  arena.allocate(arena.capacity());
+  arena.resetDirty();
+  EXPECT_EQ(arena.dirtyPages(), dirty(arena, {}));
+
+  touch(arena, 3, 1);
+  touch(arena, 4, 1);
+  touch(arena, 40, 1);
+  EXPECT_EQ(arena.dirtyPages(), dirty(arena, {3, 4, 40}));
+
+  arena.resetDirty();
+  EXPECT_EQ(arena.dirtyPages(), dirty(arena, {}));
+  touch(arena, 4, 2);
+  EXPECT_EQ(arena.dirtyPages(), dirty(arena, {4}));
+  EXPECT_EQ(arena.data()[4 * arena.pageSize() + 7], std::byte{2});
+}
+
+TEST_P(CheckpointTest, DeltasReplayToLatestState_Test) {
+  std::vector<std::vector<std::byte>> states;
+  {
+    CheckpointArena arena(kPages * privat::systemPageSize(), GetParam());
+    CheckpointWriter writer(arena, path_);
+    struct Counters {
+      std::uint64_t values[1024];
+    };
+    auto* counters = arena.create<Counters>();
+    for (std::uint64_t round = 0; round < 5; ++round) {
+      counters->values[round * 100] = round + 1;
+      arena.create<std::uint32_t>(static_cast<std::uint32_t>(round));
+      const CheckpointStats stats = writer.checkpoint();
+      EXPECT_EQ(stats.sequence, round + 1);
+      EXPECT_GE(stats.pages, 1u);
+      EXPECT_LE(stats.pages, 3u);
+      states.push_back(contents(arena));
+    }
+  }
+  for (std::uint64_t upTo = 1; upTo <= states.size(); ++upTo) {
+    CheckpointArena restored(kPages * privat::systemPageSize(),
+                             DirtyTracking::mprotect);
+    EXPECT_EQ(replayCheckpoints(path_, restored, upTo), upTo);
+    EXPECT_EQ(contents(restored), states[upTo - 1]);
+    // После восстановления арена снова отслеживается с чистого листа.
+    EXPECT_TRUE(restored.dirtyPages().empty());
+  }
+}
+
+TEST_P(CheckpointTest, BackgroundCheckpointMatchesSnapshotAtFork_Test) {
+  CheckpointArena arena(kPages * privat::systemPageSize(), GetParam());
+  CheckpointWriter writer(arena, path_);
+  arena.allocate(8 * arena.pageSize());
+  touch(arena, 1, 1);
+  writer.checkpoint();
+  touch(arena, 2, 2);
+  const auto atFork = contents(arena);
+  writer.checkpointInBackground();
+  // Родитель уже меняет состояние; дочерний процесс пишет копию на fork.
+  touch(arena, 2, 3);
+  touch(arena, 5, 3);
+  writer.wait();
+  EXPECT_EQ(writer.sequence(), 2u);
+
+  CheckpointArena restored(kPages * privat::systemPageSize(),
+                           DirtyTracking::none);
+  EXPECT_EQ(replayCheckpoints(path_, restored), 2u);
+  EXPECT_EQ(contents(restored), atFork);
+  EXPECT_EQ(arena.dirtyPages(), dirty(arena, {2, 5}));
+}
+
+INSTANTIATE_TEST_SUITE_P(Tracking, CheckpointTest,
+                         testing::Values(DirtyTracking::none,
+                                         DirtyTracking::mprotect,
+                                         DirtyTracking::softDirty));
+
+TEST(Checkpoint, FullCheckpointWritesEveryUsedPage_Test) {
+  const std::string path = tempPath("checkpoint_full_");
+  CheckpointArena arena(kPages * privat::systemPageSize(),
+                        DirtyTracking::mprotect);
+  CheckpointWriter writer(arena, path);
+  arena.allocate(10 * arena.pageSize() + 1);
+  touch(arena, 0, 1);
+  EXPECT_EQ(writer.checkpoint().pages, 1u);
+  const CheckpointStats full = writer.checkpointFull();
+  EXPECT_EQ(full.pages, 11u);
+  EXPECT_GT(full.bytesWritten, 11 * arena.pageSize());
+  ::unlink(path.c_str());
+}
+
+TEST(Checkpoint, TornTailIsIgnored_Test) {
+  const std::string path = tempPath("checkpoint_torn_");
+  std::vector<std::byte> first;
+  {
+    CheckpointArena arena(kPages * privat::systemPageSize(),
+                          DirtyTracking::mprotect);
+    CheckpointWriter writer(arena, path);
+    arena.allocate(4 * arena.pageSize());
+    touch(arena, 0, 1);
+    writer.checkpoint();
+    first = contents(arena);
+    touch(arena, 1, 2);
+    touch(arena, 2, 2);
+    writer.checkpoint();
+  }
+  struct stat st {};
+  ASSERT_EQ(::stat(path.c_str(), &st), 0);
+  ASSERT_EQ(::truncate(path.c_str(), st.st_size - 100), 0);
+
+  CheckpointArena restored(kPages * privat::systemPageSize(),
+                           DirtyTracking::none);
+  EXPECT_EQ(replayCheckpoints(path, restored), 1u);
+  EXPECT_EQ(contents(restored), first);
+  ::unlink(path.c_str());
+}
+
+TEST(Checkpoint, CorruptedRecordStopsReplay_Test) {
+  const std::string path = tempPath("checkpoint_corrupt_");
+  {
+    CheckpointArena arena(kPages * privat::systemPageSize(),
+                          DirtyTracking::mprotect);
+    CheckpointWriter writer(arena, path);
+    arena.allocate(arena.pageSize());
+    touch(arena, 0, 1);
+    writer.checkpoint();
+    touch(arena, 0, 2);
+    writer.checkpoint();
+  }
+  // Портим байт страницы во второй записи: её контрольная сумма не сойдётся.
+  struct stat st {};
+  ASSERT_EQ(::stat(path.c_str(), &st), 0);
+  const int fd = ::open(path.c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  const char garbage = 0x55;
+  ASSERT_EQ(::pwrite(fd, &garbage, 1, st.st_size - 1), 1);
+  ::close(fd);
+
+  CheckpointArena restored(kPages * privat::systemPageSize(),
+                           DirtyTracking::none);
+  EXPECT_EQ(replayCheckpoints(path, restored), 1u);
+  EXPECT_EQ(restored.data()[7], std::byte{1});
+  ::unlink(path.c_str());
+}
+
+TEST(Checkpoint, CorruptedPageCountStopsReplay_Test) {
+  const std::string path = tempPath("checkpoint_page_count_");
+  {
+    CheckpointArena arena(kPages * privat::systemPageSize(),
+                          DirtyTracking::mprotect);
+    CheckpointWriter writer(arena, path);
+    arena.allocate(arena.pageSize());
+    touch(arena, 0, 1);
+    writer.checkpoint();
+    touch(arena, 0, 2);
+    writer.checkpoint();
+  }
+  // Заголовок второй записи с правильными magic и номером, но с огромным
+  // числом страниц: replay не должен пытаться под него выделять память.
+  const int fd = ::open(path.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  const auto first = static_cast<off_t>(sizeof(privat::CheckpointFileHeader));
+  privat::CheckpointRecordHeader header{};
+  ASSERT_EQ(::pread(fd, &header, sizeof(header), first),
+            static_cast<ssize_t>(sizeof(header)));
+  const off_t second =
+      first + static_cast<off_t>(sizeof(header) +
+                                 header.pageCount * (sizeof(std::uint32_t) +
+                                                     privat::systemPageSize()));
+  const std::uint32_t huge = 0xFFFFFFFF;
+  ASSERT_EQ(::pwrite(fd, &huge, sizeof(huge),
+                     second + static_cast<off_t>(offsetof(
+                                  privat::CheckpointRecordHeader, pageCount))),
+            static_cast<ssize_t>(sizeof(huge)));
+  ::close(fd);
+
+  CheckpointArena restored(kPages * privat::systemPageSize(),
+                           DirtyTracking::none);
+  EXPECT_EQ(replayCheckpoints(path, restored), 1u);
+  EXPECT_EQ(restored.data()[7], std::byte{1});
+  ::unlink(path.c_str());
+}
+
+TEST(Checkpoint, ArenaStoresOffsetsNotPointers_Test) {
+  struct Node {
+    std::size_t next;
+    int value;
+  };
+  CheckpointArena arena(kPages * privat::systemPageSize(),
+                        DirtyTracking::none);
+  Node* a = arena.create<Node>(Node{0, 1});
+  Node* b = arena.create<Node>(Node{arena.offsetOf(a), 2});
+  EXPECT_EQ(arena.at<Node>(b->next)->value, 1);
+  EXPECT_THROW(arena.allocate(arena.capacity()), std::bad_alloc);
+}
+
+TEST(Checkpoint, UnrelatedSegfaultsAreNotSwallowed_Test) {
+  CheckpointArena arena(kPages * privat::systemPageSize(),
+                        DirtyTracking::mprotect);
+  EXPECT_DEATH(
+      {
+        volatile int* p = nullptr;
+        *p = 1;
+      },
+      "");
+}
@@ -0,0 +1,136 @@
+#include "function.h"
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+namespace {
+
+int twice(int x) { return 2 * x; }
+
+struct Counter {
+  static inline int alive = 0;
+  Counter() { ++alive; }
+  Counter(const Counter&) { ++alive; }
+  Counter(Counter&&) noexcept { ++alive; }
+  ~Counter() { --alive; }
+  int operator()() const { return alive; }
+};
+
+}  // namespace
+
+TEST(Function, InplaceInvoke_Test) {
+  InplaceFunction<int(int)> f = [](int x) { return x + 1; };
+  EXPECT_TRUE(static_cast<bool>(f));
+  EXPECT_EQ(f(1), 2);
+
+  f = &twice;
+  EXPECT_EQ(f(4), 8);
+
+  int base = 10;
+  f = [&base](int x) { return base + x; };
+  EXPECT_EQ(f(5), 15);
+  EXPECT_TRUE(f.isInline());
+}
+
+TEST(Function, InplaceCopy_Test) {
+  std::string captured = "hello";
+  InplaceFunction<std::size_t()> f = [captured] { return captured.size(); };
+  InplaceFunction<std::size_t()> g = f;
+  EXPECT_EQ(f(), 5u);
+  EXPECT_EQ(g(), 5u);
+
+  InplaceFunction<std::size_t()> h;
+  h = std::move(f);
+  EXPECT_FALSE(static_cast<bool>(f));
+  EXPECT_EQ(h(), 5u);
+}
+
+TEST(Function, Empty_Test) {
+  InplaceFunction<void()> f;
+  EXPECT_TRUE(f == nullptr);
+  EXPECT_THROW(f(), std::bad_function_call);
+
+  int (*null)(int) = nullptr;
+  UniqueFunction<int(int)> g = null;
+  EXPECT_FALSE(static_cast<bool>(g));
+}
+
+TEST(Function, Copyability_Test) {
+  static_assert(std::is_copy_constructible_v<InplaceFunction<void()>>);
+  static_assert(std::is_nothrow_move_constructible_v<InplaceFunction<void()>>);
+  static_assert(!std::is_copy_constructible_v<UniqueFunction<void()>>);
+  static_assert(!std::is_copy_assignable_v<UniqueFunction<void()>>);
+  static_assert(std::is_nothrow_move_constructible_v<UniqueFunction<void()>>);
+
+  // Move-only замыкание нельзя положить в копируемую обёртку.
+  using MoveOnlyLambda = decltype([p = std::unique_ptr<int>()] {});
+  static_assert(
+      !std::is_constructible_v<InplaceFunction<void()>, MoveOnlyLambda>);
+  static_assert(
+      std::is_constructible_v<UniqueFunction<void()>, MoveOnlyLambda>);
+
+  // Не влезающее замыкание InplaceFunction не принимает, UniqueFunction
+  // кладёт его в кучу.
+  using BigLambda = decltype([buffer = std::array<char, 256>()] {});
+  static_assert(!std::is_constructible_v<InplaceFunction<void()>, BigLambda>);
+  static_assert(
+      !std::is_convertible_v<BigLambda, InplaceFunction<void()>>);
+  static_assert(!std::is_assignable_v<InplaceFunction<void()>&, BigLambda>);
+  static_assert(std::is_constructible_v<UniqueFunction<void()>, BigLambda>);
+  static_assert(
+      std::is_constructible_v<InplaceFunction<void(), 512>, BigLambda>);
+}
+
+TEST(Function, NoexceptSignature_Test) {
+  InplaceFunction<int() noexcept> f = []() noexcept { return 7; };
+  static_assert(noexcept(f()));
+  EXPECT_EQ(f(), 7);
+
+  using Throwing = decltype([] { return 1; });
+  static_assert(!std::is_constructible_v<UniqueFunction<int() noexcept>,
+                                         Throwing>);
+}
+
+TEST(Function, UniqueMoveOnly_Test) {
+  auto ptr = std::make_unique<int>(42);
+  UniqueFunction<int()> f = [p = std::move(ptr)] { return *p; };
+  EXPECT_TRUE(f.isInline());
+  UniqueFunction<int()> g = std::move(f);
+  EXPECT_FALSE(static_cast<bool>(f));
+  EXPECT_EQ(g(), 42);
+}
+
+TEST(Function, UniqueHeapFallback_Test) {
+  std::array<long, 16> big{};
+  big[3] = 5;
+  UniqueFunction<long(), 16> f = [big] { return big[3]; };
+  EXPECT_FALSE(f.isInline());
+  UniqueFunction<long(), 16> g = std::move(f);
+  EXPECT_EQ(g(), 5);
+  g = nullptr;
+  EXPECT_FALSE(static_cast<bool>(g));
+}
+
+TEST(Function, Lifetime_Test) {
+  {
+    InplaceFunction<int()> f = Counter{};
+    EXPECT_EQ(Counter::alive, 1);
+    InplaceFunction<int()> g = f;
+    EXPECT_EQ(Counter::alive, 2);
+    g = nullptr;
+    EXPECT_EQ(Counter::alive, 1);
+    UniqueFunction<int(), 8> h = Counter{};
+    EXPECT_EQ(Counter::alive, 2);
+  }
+  EXPECT_EQ(Counter::alive, 0);
+}
+
+TEST(Function, Swap_Test) {
+  UniqueFunction<int()> a = [] { return 1; };
+  UniqueFunction<int()> b = [] { return 2; };
+  a.swap(b);
+  EXPECT_EQ(a(), 2);
+  EXPECT_EQ(b(), 1);
+}
@@ -0,0 +1,297 @@
+#include "intrusive.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+struct Item : IntrusiveListHook<>,
+              IntrusiveSListHook<>,
+              IntrusiveHashSetHook<>,
+              IntrusiveRBTreeHook<> {
+  explicit Item(int v) : value(v) {}
+  int value;
+  IntrusiveListHook<> member_;
+};
+
+struct ItemHash {
+  std::size_t operator()(const Item& item) const noexcept {
+    return std::hash<int>{}(item.value);
+  }
+  std::size_t operator()(int key) const noexcept {
+    return std::hash<int>{}(key);
+  }
+};
+
+struct ItemEqual {
+  bool operator()(const Item& item, int key) const noexcept {
+    return item.value == key;
+  }
+  bool operator()(const Item& a, const Item& b) const noexcept {
+    return a.value == b.value;
+  }
+};
+
+struct ItemLess {
+  bool operator()(const Item& a, const Item& b) const noexcept {
+    return a.value < b.value;
+  }
+  bool operator()(const Item& a, int b) const noexcept { return a.value < b; }
+  bool operator()(int a, const Item& b) const noexcept { return a < b.value; }
+};
+
+using List = IntrusiveList<Item>;
+using MemberList =
+    IntrusiveList<Item, IntrusiveMemberHook<Item, IntrusiveListHook<>,
+                                            &Item::member_>>;
+using SList = IntrusiveSList<Item>;
+using HashSet =
+    IntrusiveHashSet<Item, IntrusiveBaseHook<Item, IntrusiveHashSetHook<>>,
+                     ItemHash, ItemEqual>;
+using Tree =
+    IntrusiveRBTree<Item, IntrusiveBaseHook<Item, IntrusiveRBTreeHook<>>,
+                    ItemLess>;
+
+std::vector<int> values(const auto& container) {
+  std::vector<int> out;
+  for (const Item& item : container) {
+    out.push_back(item.value);
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(Intrusive, List_Test) {
+  Item a(1), b(2), c(3);
+  List list;
+  list.push_back(b);
+  list.push_front(a);
+  list.push_back(c);
+  EXPECT_EQ(list.size(), 3u);
+  EXPECT_EQ(values(list), (std::vector<int>{1, 2, 3}));
+  EXPECT_TRUE(list.contains(b));
+
+  list.erase(b);
+  EXPECT_FALSE(b.IntrusiveListHook<>::isLinked());
+  EXPECT_EQ(values(list), (std::vector<int>{1, 3}));
+
+  list.insert(list.iteratorTo(c), b);
+  EXPECT_EQ(values(list), (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(list.back().value, 3);
+  list.pop_back();
+  list.pop_front();
+  EXPECT_EQ(values(list), (std::vector<int>{2}));
+}
+
+TEST(Intrusive, ListAutoUnlink_Test) {
+  List list;
+  Item a(1);
+  {
+    Item b(2);
+    list.push_back(a);
+    list.push_back(b);
+    EXPECT_EQ(list.size(), 2u);
+  }
+  EXPECT_EQ(list.size(), 1u);
+  EXPECT_EQ(values(list), (std::vector<int>{1}));
+}
+
+TEST(Intrusive, ListDestroyedFirst_Test) {
+  Item a(1);
+  {
+    List list;
+    list.push_back(a);
+  }
+  EXPECT_FALSE(a.IntrusiveListHook<>::isLinked());
+}
+
+TEST(Intrusive, MemberHook_Test) {
+  Item a(1), b(2);
+  MemberList members;
+  List bases;
+  members.push_back(b);
+  members.push_back(a);
+  bases.push_back(a);
+  EXPECT_EQ(values(members), (std::vector<int>{2, 1}));
+  EXPECT_EQ(&members.front(), &b);
+  members.erase(a);
+  EXPECT_EQ(values(members), (std::vector<int>{2}));
+  EXPECT_EQ(values(bases), (std::vector<int>{1}));
+}
+
+TEST(Intrusive, ScopedLink_Test) {
+  Item a(1);
+  List list;
+  {
+    auto guard = list.scopedPushBack(a);
+    EXPECT_EQ(list.size(), 1u);
+  }
+  EXPECT_TRUE(list.empty());
+}
+
+TEST(Intrusive, ClearAndDispose_Test) {
+  List list;
+  for (int i = 0; i < 5; ++i) {
+    list.push_back(*new Item(i));
+  }
+  int disposed = 0;
+  list.clearAndDispose([&](Item* item) {
+    ++disposed;
+    delete item;
+  });
+  EXPECT_EQ(disposed, 5);
+  EXPECT_TRUE(list.empty());
+}
+
+TEST(Intrusive, SList_Test) {
+  Item a(1), b(2), c(3);
+  SList list;
+  list.push_front(c);
+  list.push_front(a);
+  list.insert_after(list.begin(), b);
+  EXPECT_EQ(values(list), (std::vector<int>{1, 2, 3}));
+  list.erase(b);
+  EXPECT_EQ(values(list), (std::vector<int>{1, 3}));
+  {
+    Item d(4);
+    list.insert_after(list.begin(), d);
+    EXPECT_EQ(list.size(), 3u);
+  }
+  EXPECT_EQ(values(list), (std::vector<int>{1, 3}));
+  list.pop_front();
+  EXPECT_EQ(list.front().value, 3);
+}
+
+TEST(Intrusive, HashSet_Test) {
+  std::vector<Item> items;
+  for (int i = 0; i < 100; ++i) {
+    items.emplace_back(i);
+  }
+  HashSet set;
+  for (Item& item : items) {
+    EXPECT_TRUE(set.insert(item).second);
+  }
+  EXPECT_EQ(set.size(), 100u);
+  EXPECT_GE(set.bucket_count(), 100u);
+
+  Item duplicate(42);
+  EXPECT_FALSE(set.insert(duplicate).second);
+  EXPECT_FALSE(duplicate.IntrusiveHashSetHook<>::isLinked());
+
+  EXPECT_EQ(set.find(42)->value, 42);
+  EXPECT_TRUE(set.find(1000) == set.end());
+  EXPECT_EQ(set.eraseKey(42), 1u);
+  EXPECT_FALSE(set.contains(42));
+  set.erase(items[7]);
+  EXPECT_FALSE(set.contains(7));
+
+  std::size_t seen = 0;
+  for (auto it = set.begin(); it != set.end(); ++it) {
+    ++seen;
+  }
+  EXPECT_EQ(seen, set.size());
+}
+
+TEST(Intrusive, HashSetAutoUnlink_Test) {
+  HashSet set;
+  {
+    Item a(1);
+    set.insert(a);
+    EXPECT_TRUE(set.contains(1));
+  }
+  EXPECT_FALSE(set.contains(1));
+  EXPECT_TRUE(set.empty());
+}
+
+TEST(Intrusive, RBTree_Test) {
+  std::vector<int> keys(1000);
+  for (int i = 0; i < 1000; ++i) {
+    keys[static_cast<std::size_t>(i)] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+  std::vector<Item> items;
+  items.reserve(keys.size());
+  Tree tree;
+  for (int key : keys) {
+    items.emplace_back(key);
+    EXPECT_TRUE(tree.insert(items.back()).second);
+  }
+  EXPECT_EQ(tree.size(), 1000u);
+
+  std::vector<int> sorted = values(tree);
+  EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+  EXPECT_EQ(sorted.size(), 1000u);
+
+  std::set<int> reference(keys.begin(), keys.end());
+  for (std::size_t i = 0; i < items.size(); i += 3) {
+    reference.erase(items[i].value);
+    tree.erase(items[i]);
+  }
+  EXPECT_EQ(values(tree),
+            std::vector<int>(reference.begin(), reference.end()));
+
+  EXPECT_EQ(tree.lower_bound(500)->value, *reference.lower_bound(500));
+  EXPECT_EQ(tree.upper_bound(500)->value, *reference.upper_bound(500));
+  EXPECT_EQ(std::prev(tree.end())->value, *reference.rbegin());
+  EXPECT_EQ(tree.find(*reference.begin())->value, *reference.begin());
+
+  Item duplicate(*reference.begin());
+  EXPECT_FALSE(tree.insert(duplicate).second);
+  tree.insertEqual(duplicate);
+  EXPECT_EQ(tree.size(), reference.size() + 1);
+}
+
+TEST(Intrusive, RBTreeClear_Test) {
+  std::vector<Item> items;
+  for (int i = 0; i < 64; ++i) {
+    items.emplace_back(i);
+  }
+  Tree tree;
+  for (Item& item : items) {
+    tree.insert(item);
+  }
+  std::size_t disposed = 0;
+  tree.clearAndDispose([&](Item*) { ++disposed; });
+  EXPECT_EQ(disposed, items.size());
+  EXPECT_TRUE(tree.empty());
+  for (const Item& item : items) {
+    EXPECT_FALSE(item.IntrusiveRBTreeHook<>::isLinked());
+  }
+}
+
+TEST(Intrusive, CopiedHookIsUnlinked_Test) {
+  List list;
+  Item a(1);
+  list.push_back(a);
+  Item b = a;
+  EXPECT_FALSE(b.IntrusiveListHook<>::isLinked());
+  EXPECT_EQ(list.size(), 1u);
+}
+
+namespace {
+struct Enemy : AutoList<Enemy> {
+  explicit Enemy(int h) : hp(h) {}
+  int hp;
+};
+}  // namespace
+
+TEST(Intrusive, AutoList_Test) {
+  EXPECT_TRUE(Enemy::instances().empty());
+  {
+    Enemy a(10);
+    Enemy b(20);
+    Enemy c = b;
+    int total = 0;
+    for (const Enemy& e : Enemy::instances()) {
+      total += e.hp;
+    }
+    EXPECT_EQ(total, 50);
+    EXPECT_EQ(Enemy::instances().size(), 3u);
+  }
+  EXPECT_TRUE(Enemy::instances().empty());
+}
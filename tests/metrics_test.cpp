@@ -0,0 +1,285 @@
+#include "metrics.h"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string shmName(const char* name) {
+  return std::string("/metrics_test_") + name + std::to_string(::getpid());
+}
+
+const MetricSample* find(const std::vector<MetricSample>& samples,
+                         const std::string& name) {
+  for (const MetricSample& sample : samples) {
+    if (sample.name == name) {
+      return &sample;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(Metrics, HistogramBucketsAreLogLinear_Test) {
+  using namespace privat;
+  constexpr unsigned kBits = 4;
+  std::size_t previous = 0;
+  for (std::uint64_t value = 0; value < 100000; ++value) {
+    const std::size_t bucket = histogramBucket(value, kBits);
+    ASSERT_GE(bucket, previous);
+    ASSERT_LE(histogramBucketLow(bucket, kBits), value);
+    ASSERT_GE(histogramBucketHigh(bucket, kBits), value);
+    previous = bucket;
+  }
+  for (std::size_t bucket = 0; bucket < 500; ++bucket) {
+    const std::uint64_t low = histogramBucketLow(bucket, kBits);
+    const std::uint64_t high = histogramBucketHigh(bucket, kBits);
+    EXPECT_EQ(histogramBucket(low, kBits), bucket);
+    EXPECT_EQ(histogramBucket(high, kBits), bucket);
+    // Ширина корзины - не больше 1/16 её нижней границы.
+    EXPECT_LE((high - low) * 16, std::max<std::uint64_t>(low, 15));
+  }
+  EXPECT_EQ(histogramBucket(~std::uint64_t{0}, kBits),
+            (64 - kBits) * 16 + 15);
+}
+
+TEST(Metrics, CountersAndGaugesAggregateAcrossThreads_Test) {
+  MetricsRegistry registry;
+  const Counter requests = registry.counter("requests");
+  const Gauge queue = registry.gauge("queue_depth");
+  constexpr int kThreads = 8;
+  constexpr int kIncrements = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIncrements; ++i) {
+        requests.inc();
+        queue.add(1);
+        queue.add(-1);
+      }
+      queue.add(2);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(requests.value(), std::uint64_t{kThreads * kIncrements});
+  EXPECT_EQ(queue.value(), 2 * kThreads);
+  queue.set(-5);
+  EXPECT_EQ(queue.value(), -5);
+
+  // Повторная регистрация - та же метрика, другой тип - ошибка.
+  registry.counter("requests").inc(10);
+  EXPECT_EQ(requests.value(), std::uint64_t{kThreads * kIncrements + 10});
+  EXPECT_THROW(registry.gauge("requests"), std::logic_error);
+  EXPECT_THROW(registry.counter(std::string(100, 'x')), std::invalid_argument);
+}
+
+TEST(Metrics, HistogramPercentiles_Test) {
+  MetricsRegistry registry;
+  const Histogram latency = registry.histogram("latency_ns", 5);
+  for (std::uint64_t value = 1; value <= 10000; ++value) {
+    latency.record(value);
+  }
+  const HistogramSnapshot snapshot = latency.snapshot();
+  EXPECT_EQ(snapshot.count, 10000u);
+  EXPECT_EQ(snapshot.sum, 10000u * 10001 / 2);
+  EXPECT_DOUBLE_EQ(snapshot.mean(), 5000.5);
+  for (double q : {0.5, 0.9, 0.99, 0.999}) {
+    const auto exact = static_cast<double>(q * 10000);
+    const auto p = static_cast<double>(snapshot.percentile(q));
+    EXPECT_GE(p, exact);
+    EXPECT_LE(p, exact * (1 + 1.0 / 32) + 1) << q;
+  }
+  EXPECT_EQ(snapshot.percentile(0.0), 1u);
+  EXPECT_EQ(snapshot.percentile(1.0), privat::histogramBucketHigh(
+                                          privat::histogramBucket(10000, 5),
+                                          5));
+  EXPECT_EQ(HistogramSnapshot{}.percentile(0.5), 0u);
+
+  // Выше maxValue всё копится в последней корзине.
+  const Histogram small = registry.histogram("small", 2, 100);
+  small.record(1'000'000);
+  const HistogramSnapshot clamped = small.snapshot();
+  EXPECT_EQ(clamped.count, 1u);
+  EXPECT_EQ(clamped.buckets.back(), 1u);
+}
+
+TEST(Metrics, ScopedTimerRecordsDuration_Test) {
+  MetricsRegistry registry;
+  const Histogram timings = registry.histogram("timings");
+  {
+    METRICS_SCOPED_TIMER(timings);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  {
+    auto timer = timings.startTimer();
+    timer.dismiss();
+  }
+  const HistogramSnapshot snapshot = timings.snapshot();
+  ASSERT_EQ(snapshot.count, 1u);
+  EXPECT_GE(snapshot.sum, 2'000'000u);
+  EXPECT_GE(snapshot.percentile(1.0), 2'000'000u);
+}
+
+TEST(Metrics, ReaderScrapesSharedSegment_Test) {
+  const std::string name = shmName("reader");
+  MetricsRegistry registry(name);
+  const Counter packets = registry.counter("packets");
+  const Gauge sessions = registry.gauge("sessions");
+  const Histogram latency = registry.histogram("latency");
+  packets.inc(42);
+  sessions.set(7);
+  latency.record(100);
+  latency.record(300);
+
+  MetricsReader reader(name);
+  std::vector<MetricSample> samples = reader.snapshot();
+  ASSERT_EQ(samples.size(), 3u);
+  EXPECT_EQ(find(samples, "packets")->kind, MetricKind::counter);
+  EXPECT_EQ(find(samples, "packets")->value, 42);
+  EXPECT_EQ(find(samples, "sessions")->value, 7);
+  EXPECT_EQ(find(samples, "latency")->histogram.count, 2u);
+  EXPECT_EQ(find(samples, "latency")->histogram.sum, 400u);
+
+  // Читатель видит новые значения и метрики без участия писателя.
+  packets.inc();
+  registry.counter("late").inc(3);
+  samples = reader.snapshot();
+  EXPECT_EQ(find(samples, "packets")->value, 43);
+  ASSERT_NE(find(samples, "late"), nullptr);
+  EXPECT_EQ(find(samples, "late")->value, 3);
+  EXPECT_EQ(registry.snapshot().size(), samples.size());
+}
+
+TEST(Metrics, ReaderWorksFromAnotherProcess_Test) {
+  const std::string name = shmName("process");
+  MetricsRegistry registry(name);
+  const Counter events = registry.counter("events");
+  events.inc(5);
+  const pid_t child = ::fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    // Отдельное отображение того же сегмента, как у внешнего сборщика.
+    MetricsReader reader(name);
+    const std::vector<MetricSample> samples = reader.snapshot();
+    ::_exit(samples.size() == 1 && samples[0].value == 5 ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(::waitpid(child, &status, 0), child);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(Metrics, NamedSegmentIsNotClobbered_Test) {
+  const std::string name = shmName("exclusive");
+  MetricsRegistry first(name);
+  first.counter("owned").inc(9);
+  EXPECT_THROW(MetricsRegistry second(name), std::system_error);
+  EXPECT_EQ(MetricsReader(name).snapshot().at(0).value, 9);
+
+  {
+    // replace забирает имя, но не трогает старый сегмент.
+    MetricsRegistry::Options options;
+    options.replace = true;
+    MetricsRegistry second(name, options);
+    EXPECT_TRUE(MetricsReader(name).snapshot().empty());
+    EXPECT_EQ(first.snapshot().at(0).value, 9);
+  }
+  // Деструктор replace-реестра удалил имя; деструктор first не удалит чужое.
+  EXPECT_THROW(MetricsReader{name}, std::system_error);
+  MetricsRegistry third(name);
+}
+
+TEST(Metrics, ReaderRejectsCorruptedSegment_Test) {
+  const std::string name = shmName("corrupted");
+  MetricsRegistry registry(name);
+  registry.counter("good").inc(1);
+  registry.histogram("empty");
+  registry.counter("outside");
+  registry.gauge("unknown");
+
+  const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+  ASSERT_GE(fd, 0);
+  const std::size_t bytes = registry.segmentBytes();
+  void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                      0);
+  ::close(fd);
+  ASSERT_NE(base, MAP_FAILED);
+  const privat::MetricsView view(static_cast<std::byte*>(base), bytes);
+  privat::MetricDescriptor* descriptors = view.descriptors();
+  descriptors[1].cellCount = 0;
+  descriptors[2].firstCell = view.header()->maxCells;
+  descriptors[3].kind = static_cast<MetricKind>(77);
+
+  // Испорченные дескрипторы пропускаются, неизвестный тип - без значения.
+  const std::vector<MetricSample> samples = MetricsReader(name).snapshot();
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_EQ(samples[0].name, "good");
+  EXPECT_EQ(samples[0].value, 1);
+  EXPECT_EQ(samples[1].name, "unknown");
+
+  view.header()->cellsOffset += 64;
+  EXPECT_THROW(MetricsReader{name}, std::runtime_error);
+  view.header()->cellsOffset -= 64;
+  view.header()->maxCells *= 2;
+  EXPECT_THROW(MetricsReader{name}, std::runtime_error);
+  ::munmap(base, bytes);
+}
+
+TEST(Metrics, ThreadSlotsAreRecycled_Test) {
+  const std::uint32_t main = privat::metricsThreadIndex();
+  // Потоки, которые уже завершились, не держат номера.
+  for (int i = 0; i < 100; ++i) {
+    std::thread([] { privat::metricsThreadIndex(); }).join();
+  }
+  constexpr int kThreads = 3;
+  std::atomic<int> ready{0};
+  std::atomic<bool> done{false};
+  std::vector<std::uint32_t> indices(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      indices[static_cast<std::size_t>(t)] = privat::metricsThreadIndex();
+      ready.fetch_add(1);
+      while (!done.load()) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  while (ready.load() < kThreads) {
+    std::this_thread::yield();
+  }
+  done = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  indices.push_back(main);
+  // Четыре живых потока - четыре разных номера меньше четырёх: при 4
+  // шардах у каждого свой.
+  std::sort(indices.begin(), indices.end());
+  EXPECT_EQ(std::unique(indices.begin(), indices.end()), indices.end());
+  EXPECT_LT(indices.back(), 4u);
+}
+
+TEST(Metrics, SegmentLimits_Test) {
+  MetricsRegistry::Options options;
+  options.shards = 3;
+  options.maxMetrics = 2;
+  MetricsRegistry registry({}, options);
+  EXPECT_EQ(registry.shards(), 4u);
+  registry.counter("a");
+  registry.counter("b");
+  EXPECT_THROW(registry.counter("c"), std::length_error);
+  EXPECT_THROW(MetricsReader(shmName("missing")), std::system_error);
+}
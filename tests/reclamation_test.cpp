@@ -0,0 +1,262 @@
+#include "lockfree.h"
+#include "reclamation.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Tracked {
+  explicit Tracked(std::atomic<int>& counter) : freed(counter) {}
+  ~Tracked() { freed.fetch_add(1); }
+  std::atomic<int>& freed;
+};
+
+// Deleter с состоянием: складывает объекты в "пул" вместо delete.
+struct PoolDeleter {
+  void operator()(int* p) { returned.push_back(p); }
+  std::vector<int*> returned;
+};
+
+// Минимальное состояние домена для проверки кэша threadLocalFor.
+struct CountingState {
+  struct Local {
+    bool released = false;
+  };
+  explicit CountingState(std::atomic<int>& counter) : alive(counter) {
+    alive.fetch_add(1);
+  }
+  ~CountingState() { alive.fetch_sub(1); }
+  Local* acquireLocal() { return &local; }
+  void releaseLocal(Local* l) { l->released = true; }
+
+  std::atomic<int>& alive;
+  Local local;
+};
+
+}  // namespace
+
+TEST(Reclamation, EpochRetireAndCollect_Test) {
+  std::atomic<int> freed{0};
+  EpochDomain domain(1000);
+  for (int i = 0; i < 10; ++i) {
+    domain.retire(new Tracked(freed));
+  }
+  EXPECT_EQ(freed.load(), 0);
+  for (int i = 0; i < 3; ++i) {
+    domain.collect();
+  }
+  EXPECT_EQ(freed.load(), 10);
+}
+
+TEST(Reclamation, EpochGuardDelaysReclamation_Test) {
+  std::atomic<int> freed{0};
+  EpochDomain domain(1000);
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    SCOPE_EPOCH(domain);
+    entered = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!entered) {
+    std::this_thread::yield();
+  }
+  domain.retire(new Tracked(freed));
+  for (int i = 0; i < 5; ++i) {
+    domain.collect();
+  }
+  EXPECT_EQ(freed.load(), 0);
+  release = true;
+  reader.join();
+  for (int i = 0; i < 3; ++i) {
+    domain.collect();
+  }
+  EXPECT_EQ(freed.load(), 1);
+}
+
+TEST(Reclamation, EpochGuardNesting_Test) {
+  EpochDomain domain;
+  auto outer = makeEpochGuard(domain);
+  {
+    SCOPE_EPOCH(domain);
+  }
+  const auto epoch = domain.epoch();
+  domain.collect();
+  domain.collect();
+  // Внешняя секция всё ещё открыта: эпоха сдвигается максимум на одну.
+  EXPECT_LE(domain.epoch(), epoch + 1);
+  outer.dismiss();
+}
+
+TEST(Reclamation, DomainDestructionDrains_Test) {
+  std::atomic<int> freed{0};
+  {
+    HazardPointerDomain domain(1000);
+    domain.retire(new Tracked(freed));
+    domain.retire(new Tracked(freed));
+  }
+  EXPECT_EQ(freed.load(), 2);
+}
+
+TEST(Reclamation, ThreadCacheDoesNotKeepDeadDomains_Test) {
+  std::atomic<int> alive{0};
+  for (int i = 0; i < 100; ++i) {
+    auto state = std::make_shared<CountingState>(alive);
+    privat::threadLocalFor(state);
+    EXPECT_EQ(&privat::threadLocalFor(state), &state->local);
+    EXPECT_EQ(state.use_count(), 1);
+    state.reset();
+    EXPECT_EQ(alive.load(), 0);
+  }
+
+  // Выход потока возвращает запись живому домену и не трогает мёртвые.
+  auto live = std::make_shared<CountingState>(alive);
+  std::thread([&] {
+    auto dead = std::make_shared<CountingState>(alive);
+    privat::threadLocalFor(dead);
+    privat::threadLocalFor(live);
+  }).join();
+  EXPECT_TRUE(live->local.released);
+  EXPECT_EQ(alive.load(), 1);
+
+  for (int i = 0; i < 100; ++i) {
+    EpochDomain domain;
+    domain.collect();
+  }
+}
+
+TEST(Reclamation, HazardProtect_Test) {
+  std::atomic<int> freed{0};
+  HazardPointerDomain domain(1);
+  std::atomic<Tracked*> shared{new Tracked(freed)};
+
+  auto guard = makeHazardGuard(domain);
+  Tracked* protectedPtr = guard.protect(shared);
+  shared.store(nullptr);
+  domain.retire(protectedPtr);
+  domain.collect();
+  EXPECT_EQ(freed.load(), 0);
+  EXPECT_EQ(domain.pending(), 1u);
+
+  guard.reset();
+  domain.collect();
+  EXPECT_EQ(freed.load(), 1);
+  EXPECT_EQ(domain.pending(), 0u);
+}
+
+TEST(Reclamation, StatefulDeleter_Test) {
+  PoolDeleter pool;
+  int values[3] = {};
+  {
+    EpochDomain domain;
+    for (int& v : values) {
+      domain.retire(&v, pool);
+    }
+  }
+  EXPECT_EQ(pool.returned.size(), 3u);
+}
+
+template <typename Domain>
+class LockFreeTest : public ::testing::Test {};
+
+using Domains = ::testing::Types<EpochDomain, HazardPointerDomain>;
+TYPED_TEST_SUITE(LockFreeTest, Domains);
+
+TYPED_TEST(LockFreeTest, StackOrder_Test) {
+  TypeParam domain;
+  TreiberStack<int, TypeParam> stack(domain);
+  EXPECT_TRUE(stack.empty());
+  for (int i = 0; i < 5; ++i) {
+    stack.push(i);
+  }
+  for (int i = 4; i >= 0; --i) {
+    EXPECT_EQ(stack.pop(), i);
+  }
+  EXPECT_FALSE(stack.pop().has_value());
+}
+
+TYPED_TEST(LockFreeTest, QueueOrder_Test) {
+  TypeParam domain;
+  MichaelScottQueue<int, TypeParam> queue(domain);
+  EXPECT_TRUE(queue.empty());
+  for (int i = 0; i < 5; ++i) {
+    queue.push(i);
+  }
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(queue.pop(), i);
+  }
+  EXPECT_FALSE(queue.pop().has_value());
+}
+
+TYPED_TEST(LockFreeTest, ConcurrentStack_Test) {
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 5000;
+  TypeParam domain;
+  TreiberStack<int, TypeParam> stack(domain);
+  std::atomic<long> popped{0};
+  std::atomic<int> count{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        stack.push(t * kPerThread + i);
+        if (auto v = stack.pop()) {
+          popped += *v;
+          ++count;
+        }
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  while (auto v = stack.pop()) {
+    popped += *v;
+    ++count;
+  }
+  const long n = kThreads * kPerThread;
+  EXPECT_EQ(count.load(), n);
+  EXPECT_EQ(popped.load(), n * (n - 1) / 2);
+}
+
+TYPED_TEST(LockFreeTest, ConcurrentQueue_Test) {
+  constexpr int kProducers = 2;
+  constexpr int kPerProducer = 5000;
+  TypeParam domain;
+  MichaelScottQueue<int, TypeParam> queue(domain);
+  std::vector<std::vector<int>> seen(kProducers);
+  std::thread consumer([&] {
+    int received = 0;
+    while (received < kProducers * kPerProducer) {
+      if (auto v = queue.pop()) {
+        seen[static_cast<std::size_t>(*v / kPerProducer)].push_back(
+            *v % kPerProducer);
+        ++received;
+      }
+    }
+  });
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        queue.push(p * kPerProducer + i);
+      }
+    });
+  }
+  for (auto& th : producers) {
+    th.join();
+  }
+  consumer.join();
+  // FIFO для каждого производителя.
+  for (const auto& values : seen) {
+    EXPECT_EQ(values.size(), static_cast<std::size_t>(kPerProducer));
+    EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+  }
+}
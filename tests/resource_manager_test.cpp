@@ -0,0 +1,222 @@
+#include "resource_manager.h"
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr std::size_t kFiles = 10;
+constexpr std::size_t kFileSize = 4096;
+
+std::string key(std::size_t i) { return "dir/file" + std::to_string(i); }
+
+std::string contents(std::size_t i) {
+  std::string data(kFileSize, static_cast<char>('a' + i % 26));
+  data.replace(0, key(i).size(), key(i));
+  return data;
+}
+
+class ResourceManagerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = fs::path(testing::TempDir()) /
+            ("resource_manager_test_" + std::to_string(::getpid()));
+    fs::create_directories(root_ / "dir");
+    for (std::size_t i = 0; i < kFiles; ++i) {
+      std::ofstream(root_ / key(i), std::ios::binary) << contents(i);
+    }
+  }
+  void TearDown() override { fs::remove_all(root_); }
+
+  // Ждёт, пока фоновая загрузка положит ключ в кэш.
+  static bool waitCached(ResourceManager& manager, const std::string& key) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!manager.find(key)) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  fs::path root_;
+};
+
+}  // namespace
+
+TEST_F(ResourceManagerTest, LoadsAndCaches_Test) {
+  ResourceManager manager(root_);
+  const ResourceHandle first = manager.get(key(3));
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first->key(), key(3));
+  EXPECT_EQ(first->text(), contents(3));
+  EXPECT_EQ(first->size(), kFileSize);
+
+  const ResourceHandle again = manager.get(key(3));
+  EXPECT_EQ(again, first);  // тот же mmap, без повторной загрузки
+  const ResourceStats stats = manager.stats();
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.residentCount, 1u);
+  EXPECT_EQ(stats.residentBytes, kFileSize);
+  EXPECT_EQ(stats.loadLatency.count, 1u);
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+  EXPECT_EQ(manager.find(key(4)), nullptr);
+}
+
+TEST_F(ResourceManagerTest, DeduplicatesConcurrentRequests_Test) {
+  ResourceManager manager(root_);
+  constexpr int kThreads = 8;
+  std::vector<ResourceHandle> handles(kThreads);
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+      handles[static_cast<std::size_t>(t)] = manager.get(key(1));
+    });
+  }
+  go.store(true);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const ResourceHandle& handle : handles) {
+    EXPECT_EQ(handle, handles[0]);
+  }
+  const ResourceStats stats = manager.stats();
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.hits + stats.deduplicated, kThreads - 1u);
+  EXPECT_EQ(stats.loadLatency.count, 1u);
+}
+
+TEST_F(ResourceManagerTest, CallbacksAndFailures_Test) {
+  ResourceManager manager(root_);
+  std::promise<std::string> loaded;
+  manager.load(key(2), [&](ResourceHandle resource, std::exception_ptr error) {
+    EXPECT_FALSE(error);
+    loaded.set_value(std::string(resource->text()));
+  });
+  EXPECT_EQ(loaded.get_future().get(), contents(2));
+
+  // Ресурс уже в кэше: обратный вызов приходит сразу, в этом потоке.
+  bool immediate = false;
+  manager.load(key(2), [&](ResourceHandle resource, std::exception_ptr) {
+    immediate = resource != nullptr;
+  });
+  EXPECT_TRUE(immediate);
+
+  std::promise<bool> failed;
+  manager.load("dir/missing",
+               [&](ResourceHandle resource, std::exception_ptr error) {
+                 failed.set_value(!resource && error);
+               });
+  EXPECT_TRUE(failed.get_future().get());
+  EXPECT_THROW(manager.get("dir/missing"), std::system_error);
+  EXPECT_EQ(manager.stats().failures, 2u);
+
+  // Неудача не кэшируется: появившийся файл загрузится.
+  std::ofstream(root_ / "dir/missing") << "now here";
+  EXPECT_EQ(manager.get("dir/missing")->text(), "now here");
+
+  EXPECT_THROW(manager.load("../outside"), std::invalid_argument);
+  EXPECT_THROW(manager.load("dir/../../outside"), std::invalid_argument);
+  EXPECT_THROW(manager.load("/etc/hostname"), std::invalid_argument);
+  EXPECT_THROW(manager.load(""), std::invalid_argument);
+}
+
+TEST_F(ResourceManagerTest, EvictsLeastRecentlyUsedWithinBudget_Test) {
+  ResourceManager::Options options;
+  options.memoryBudget = 3 * kFileSize;
+  ResourceManager manager(root_, options);
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    manager.get(key(i));
+    manager.get(key(0));  // часто используемый остаётся в кэше
+  }
+  const ResourceStats stats = manager.stats();
+  EXPECT_EQ(stats.residentBytes, 3 * kFileSize);
+  EXPECT_EQ(stats.residentCount, 3u);
+  EXPECT_EQ(stats.misses, kFiles);
+  EXPECT_EQ(stats.evictions, kFiles - 3);
+  EXPECT_NE(manager.find(key(0)), nullptr);
+  EXPECT_NE(manager.find(key(kFiles - 2)), nullptr);
+  EXPECT_NE(manager.find(key(kFiles - 1)), nullptr);
+  EXPECT_EQ(manager.find(key(1)), nullptr);
+}
+
+TEST_F(ResourceManagerTest, EvictedResourceStaysValidWhileHeld_Test) {
+  ResourceManager::Options options;
+  options.memoryBudget = kFileSize;
+  ResourceManager manager(root_, options);
+  const ResourceHandle held = manager.get(key(5));
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    manager.get(key(i));
+  }
+  EXPECT_EQ(manager.find(key(5)), nullptr);
+  EXPECT_EQ(held->text(), contents(5));
+  // Повторный запрос грузит файл заново: это уже другой ресурс.
+  EXPECT_NE(manager.get(key(5)), held);
+}
+
+TEST_F(ResourceManagerTest, PrefetchTurnsMissesIntoHits_Test) {
+  MetricsRegistry metrics;
+  ResourceManager::Options options;
+  options.metrics = &metrics;
+  ResourceManager manager(root_, options);
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    manager.prefetch(key(i));
+  }
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    ASSERT_TRUE(waitCached(manager, key(i)));
+  }
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    EXPECT_EQ(manager.get(key(i))->text(), contents(i));
+  }
+  const ResourceStats stats = manager.stats();
+  EXPECT_EQ(stats.prefetches, kFiles);
+  EXPECT_EQ(stats.misses, 0u);
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 1.0);
+
+  // Те же значения видны через общий реестр метрик.
+  bool found = false;
+  for (const MetricSample& sample : metrics.snapshot()) {
+    if (sample.name == "resource_hits") {
+      found = true;
+      EXPECT_EQ(sample.value, static_cast<std::int64_t>(kFiles));
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST_F(ResourceManagerTest,
+       LoadOfPrefetchedKeyIsNotStuckBehindBackground_Test) {
+  ResourceManager::Options options;
+  options.workers = 1;
+  ResourceManager manager(root_, options);
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    manager.prefetch(key(i));
+  }
+  // Срочный запрос последнего ключа обгоняет фоновую очередь.
+  EXPECT_EQ(manager.get(key(kFiles - 1))->text(), contents(kFiles - 1));
+}
+
+TEST_F(ResourceManagerTest, EmptyFile_Test) {
+  std::ofstream(root_ / "empty").flush();
+  ResourceManager manager(root_);
+  const ResourceHandle empty = manager.get("empty");
+  EXPECT_EQ(empty->size(), 0u);
+  EXPECT_TRUE(empty->text().empty());
+}
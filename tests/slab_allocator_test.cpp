@@ -0,0 +1,282 @@
+#include "slab_allocator.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+bool isAligned(const void* p, std::size_t align) {
+  return reinterpret_cast<std::uintptr_t>(p) % align == 0;
+}
+
+// Возвращает всё пустое в PageHeap, чтобы stats() видел только живое.
+std::size_t liveBytes() {
+  SlabHeap::trim();
+  return SlabHeap::stats().allocatedBytes;
+}
+
+}  // namespace
+
+TEST(SlabAllocator, SizeClassesCoverEverySize_Test) {
+  using namespace privat;
+  std::size_t previous = 0;
+  for (std::size_t size = 1; size <= kMaxSmallSize; ++size) {
+    const std::size_t cls = slabSizeClass(size);
+    ASSERT_LT(cls, kSizeClasses);
+    ASSERT_GE(slabClassSize(cls), size);
+    ASSERT_GE(cls, previous);
+    if (cls > 0) {
+      ASSERT_LT(slabClassSize(cls - 1), size);
+    }
+    previous = cls;
+  }
+  for (std::size_t cls = 0; cls < kSizeClasses; ++cls) {
+    EXPECT_EQ(slabSizeClass(slabClassSize(cls)), cls);
+    EXPECT_EQ(slabClassSize(cls) % 16, 0u);
+  }
+}
+
+TEST(SlabAllocator, AllocatesAlignedUsableMemory_Test) {
+  std::vector<void*> blocks;
+  for (std::size_t size : {1, 8, 16, 24, 100, 256, 257, 1000, 4096, 8192,
+                           8193, 100000}) {
+    void* p = SlabHeap::allocate(size);
+    ASSERT_NE(p, nullptr);
+    EXPECT_TRUE(isAligned(p, 16));
+    EXPECT_GE(SlabHeap::usableSize(p), size);
+    std::memset(p, 0xAB, size);
+    blocks.push_back(p);
+  }
+  for (std::size_t align : {32, 64, 128, 4096}) {
+    void* p = SlabHeap::allocate(40, align);
+    ASSERT_NE(p, nullptr);
+    EXPECT_TRUE(isAligned(p, align));
+    blocks.push_back(p);
+  }
+  for (void* p : blocks) {
+    SlabHeap::deallocate(p);
+  }
+  SlabHeap::deallocate(nullptr);
+}
+
+TEST(SlabAllocator, ReusesFreedObjects_Test) {
+  void* a = SlabHeap::allocate(48);
+  SlabHeap::deallocate(a);
+  void* b = SlabHeap::allocate(48);
+  EXPECT_EQ(a, b);
+  SlabHeap::deallocate(b);
+}
+
+TEST(SlabAllocator, StatsTrackLiveBytes_Test) {
+  const std::size_t before = liveBytes();
+  std::vector<void*> blocks;
+  for (int i = 0; i < 1000; ++i) {
+    blocks.push_back(SlabHeap::allocate(64));
+  }
+  void* large = SlabHeap::allocate(1 << 20);
+  SlabStats stats = SlabHeap::stats();
+  EXPECT_GE(stats.allocatedBytes, before + 1000 * 64 + (1 << 20));
+  EXPECT_GE(stats.largeBytes, std::size_t{1} << 20);
+  EXPECT_GE(stats.committedBytes, stats.allocatedBytes);
+  EXPECT_GE(stats.mappedBytes, stats.committedBytes);
+
+  SlabHeap::deallocate(large);
+  for (void* p : blocks) {
+    SlabHeap::deallocate(p);
+  }
+  EXPECT_EQ(liveBytes(), before);
+}
+
+TEST(SlabAllocator, LargeMappingsAreReused_Test) {
+  void* first = SlabHeap::allocate(1 << 20);
+  SlabHeap::deallocate(first);
+  const SlabStats cached = SlabHeap::stats();
+  // Близкий размер попадает в то же округлённое отображение.
+  void* second = SlabHeap::allocate((1 << 20) + 1000);
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(SlabHeap::stats().mappedBytes, cached.mappedBytes);
+  SlabHeap::deallocate(second);
+
+  // trim отдаёт страницы кэша ОС, отображение остаётся пригодным.
+  SlabHeap::trim();
+  EXPECT_LT(SlabHeap::stats().committedBytes, cached.committedBytes);
+  auto* third = static_cast<char*>(SlabHeap::allocate(1 << 20));
+  EXPECT_EQ(third, first);
+  std::memset(third, 1, 1 << 20);
+  SlabHeap::deallocate(third);
+
+  // Крупнее 4 МиБ не кэшируется.
+  void* huge = SlabHeap::allocate(8 << 20);
+  SlabHeap::deallocate(huge);
+  EXPECT_EQ(SlabHeap::stats().mappedBytes, cached.mappedBytes);
+}
+
+TEST(SlabAllocator, TrimReturnsPagesToTheSystem_Test) {
+  std::vector<void*> blocks;
+  for (int i = 0; i < 50000; ++i) {
+    blocks.push_back(SlabHeap::allocate(512));
+  }
+  const SlabStats full = SlabHeap::stats();
+  for (void* p : blocks) {
+    SlabHeap::deallocate(p);
+  }
+  SlabHeap::trim();
+  const SlabStats trimmed = SlabHeap::stats();
+  EXPECT_GT(trimmed.decommittedSpans, 0u);
+  EXPECT_LT(trimmed.committedBytes + 20 * 1024 * 1024, full.committedBytes);
+  EXPECT_EQ(trimmed.mappedBytes, full.mappedBytes);
+}
+
+TEST(SlabAllocator, TrimReleasesPagesUnderSparseSurvivors_Test) {
+  const std::size_t before = liveBytes();
+  std::vector<char*> blocks;
+  for (int i = 0; i < 20000; ++i) {
+    blocks.push_back(static_cast<char*>(SlabHeap::allocate(1024)));
+    std::memset(blocks.back(), i % 251, 1024);
+  }
+  // Выживает каждый 64-й: почти все страницы свободны, но ни один span
+  // не пуст целиком.
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    if (i % 64 != 0) {
+      SlabHeap::deallocate(std::exchange(blocks[i], nullptr));
+    }
+  }
+  SlabHeap::trim();
+  const SlabStats trimmed = SlabHeap::stats();
+  EXPECT_GT(trimmed.releasedBytes, std::size_t{10} << 20);
+
+  // Паркованные объекты снова выдаются, выжившие не тронуты.
+  std::vector<void*> again;
+  for (int i = 0; i < 20000; ++i) {
+    again.push_back(SlabHeap::allocate(1024));
+    std::memset(again.back(), 0xFF, 1024);
+  }
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    if (blocks[i]) {
+      EXPECT_EQ(blocks[i][0], static_cast<char>(i % 251));
+      EXPECT_EQ(blocks[i][1023], static_cast<char>(i % 251));
+      SlabHeap::deallocate(blocks[i]);
+    }
+  }
+  for (void* p : again) {
+    SlabHeap::deallocate(p);
+  }
+  EXPECT_EQ(liveBytes(), before);
+}
+
+TEST(SlabAllocator, CrossThreadFreesReturnToOwner_Test) {
+  const std::size_t before = liveBytes();
+  constexpr int kBatches = 200;
+  constexpr int kBatch = 256;
+  std::vector<std::vector<void*>> batches(kBatches);
+  std::atomic<int> produced{0};
+
+  std::thread producer([&] {
+    std::mt19937 rng(1);
+    for (auto& batch : batches) {
+      for (int i = 0; i < kBatch; ++i) {
+        const std::size_t size = 16 + rng() % 2000;
+        void* p = SlabHeap::allocate(size);
+        std::memset(p, 0x5A, size);
+        batch.push_back(p);
+      }
+      produced.fetch_add(1, std::memory_order_release);
+    }
+  });
+  std::thread consumer([&] {
+    for (auto& batch : batches) {
+      const auto index = static_cast<int>(&batch - batches.data());
+      while (produced.load(std::memory_order_acquire) <= index) {
+        std::this_thread::yield();
+      }
+      for (void* p : batch) {
+        SlabHeap::deallocate(p);
+      }
+    }
+  });
+  producer.join();
+  consumer.join();
+
+  // Span'ы вышедшего producer'а стали сиротами; trim их подбирает.
+  EXPECT_EQ(liveBytes(), before);
+}
+
+TEST(SlabAllocator, OrphanedSpansAreAdopted_Test) {
+  std::vector<void*> blocks;
+  std::thread([&] {
+    for (int i = 0; i < 100; ++i) {
+      blocks.push_back(SlabHeap::allocate(96));
+    }
+  }).join();
+  // Поток уже вышел: освобождения идут в чужой span, а новые выделения
+  // того же класса забирают его себе.
+  for (std::size_t i = 0; i < blocks.size(); i += 2) {
+    SlabHeap::deallocate(blocks[i]);
+  }
+  std::vector<void*> again;
+  for (int i = 0; i < 50; ++i) {
+    again.push_back(SlabHeap::allocate(96));
+  }
+  for (std::size_t i = 1; i < blocks.size(); i += 2) {
+    SlabHeap::deallocate(blocks[i]);
+  }
+  for (void* p : again) {
+    SlabHeap::deallocate(p);
+  }
+}
+
+TEST(SlabAllocator, ManyThreadsMixedSizes_Test) {
+  const std::size_t before = liveBytes();
+  constexpr int kThreads = 8;
+  std::vector<std::atomic<void*>> shared(kThreads * 1000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(static_cast<unsigned>(t));
+      for (int i = 0; i < 20000; ++i) {
+        const std::size_t slot = rng() % shared.size();
+        void* p = SlabHeap::allocate(8 + rng() % 3000);
+        // Обмен через общий массив: освобождает чаще всего чужой поток.
+        void* old = shared[slot].exchange(p, std::memory_order_acq_rel);
+        SlabHeap::deallocate(old);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& p : shared) {
+    SlabHeap::deallocate(p.load());
+  }
+  EXPECT_EQ(liveBytes(), before);
+}
+
+TEST(SlabAllocator, StlContainers_Test) {
+  std::vector<int, SlabAllocator<int>> v;
+  for (int i = 0; i < 10000; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(v[9999], 9999);
+
+  std::map<int, int, std::less<>, SlabAllocator<std::pair<const int, int>>>
+      map;
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(i, i * 2);
+  }
+  EXPECT_EQ(map.at(500), 1000);
+
+  EXPECT_TRUE(SlabAllocator<int>() == SlabAllocator<double>());
+  EXPECT_THROW(SlabAllocator<int>().allocate(std::size_t(-1) / 2),
+               std::bad_array_new_length);
+}
+
+TEST(SlabAllocator, ResidentBytesIsReported_Test) {
+  EXPECT_GT(SlabHeap::residentBytes(), 0u);
+}
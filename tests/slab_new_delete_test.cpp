@@ -0,0 +1,170 @@
+#include "slab_allocator.h"
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// Отдельный исполняемый файл: здесь глобальные operator new/delete
+// заменены целью slab_new_delete.
+
+namespace {
+
+privat::SpanKind kindOf(const void* p) {
+  return privat::spanOf(p)->kind.load(std::memory_order_relaxed);
+}
+
+bool fromSlabHeap(const void* p) {
+  return kindOf(p) != privat::SpanKind::free;
+}
+
+// Размер, который не выделить: new_handler вызывается каждый раз.
+std::size_t hugeSize() {
+  volatile std::size_t size = std::numeric_limits<std::size_t>::max() - 4096;
+  return size;
+}
+
+int handlerCalls = 0;
+
+void giveUpAfterThreeCalls() {
+  if (++handlerCalls == 3) {
+    std::set_new_handler(nullptr);
+  }
+}
+
+struct alignas(256) OverAligned {
+  unsigned char bytes[256];
+};
+
+}  // namespace
+
+TEST(SlabNewDelete, ScalarAndArray_Test) {
+  auto* value = new int(42);
+  EXPECT_EQ(kindOf(value), privat::SpanKind::small);
+  EXPECT_EQ(*value, 42);
+  delete value;
+
+  auto* array = new char[1000];
+  EXPECT_EQ(kindOf(array), privat::SpanKind::small);
+  EXPECT_GE(SlabHeap::usableSize(array), 1000u);
+  delete[] array;
+
+  auto* large = new char[1 << 20];
+  EXPECT_EQ(kindOf(large), privat::SpanKind::large);
+  delete[] large;
+}
+
+TEST(SlabNewDelete, Aligned_Test) {
+  auto* object = new OverAligned();
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(object) % 256, 0u);
+  EXPECT_TRUE(fromSlabHeap(object));
+  delete object;
+
+  auto* objects = new OverAligned[3];
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(objects) % 256, 0u);
+  delete[] objects;
+
+  void* p = ::operator new(100, std::align_val_t{32});
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 32, 0u);
+  EXPECT_EQ(kindOf(p), privat::SpanKind::small);
+  ::operator delete(p, 100, std::align_val_t{32});
+
+  void* q = ::operator new(64, std::align_val_t{4096}, std::nothrow);
+  ASSERT_NE(q, nullptr);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(q) % 4096, 0u);
+  ::operator delete(q, std::align_val_t{4096}, std::nothrow);
+}
+
+TEST(SlabNewDelete, SpanAligned_Test) {
+  for (const std::size_t align : {std::size_t{1} << 16, std::size_t{1} << 21}) {
+    for (const std::size_t size : {std::size_t{64}, std::size_t{300000}}) {
+      // Второй круг берёт отображение из кэша крупных блоков.
+      for (int round = 0; round < 2; ++round) {
+        void* p = ::operator new(size, std::align_val_t{align});
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % align, 0u);
+        EXPECT_EQ(kindOf(p), privat::SpanKind::large);
+        EXPECT_GE(SlabHeap::usableSize(p), size);
+        std::memset(p, 0xab, size);
+        ::operator delete(p, size, std::align_val_t{align});
+      }
+    }
+  }
+
+  auto* buffers = new (std::align_val_t{1 << 16}) std::uint64_t[4096];
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffers) % (1 << 16), 0u);
+  buffers[4095] = 1;
+  ::operator delete[](buffers, std::align_val_t{1 << 16});
+}
+
+TEST(SlabNewDelete, Nothrow_Test) {
+  auto* value = new (std::nothrow) int(7);
+  ASSERT_NE(value, nullptr);
+  EXPECT_TRUE(fromSlabHeap(value));
+  delete value;
+
+  EXPECT_EQ(::operator new(hugeSize(), std::nothrow), nullptr);
+  EXPECT_EQ(::operator new[](hugeSize(), std::nothrow), nullptr);
+  EXPECT_EQ(::operator new(hugeSize(), std::align_val_t{64}, std::nothrow),
+            nullptr);
+}
+
+TEST(SlabNewDelete, NewHandler_Test) {
+  handlerCalls = 0;
+  std::set_new_handler(giveUpAfterThreeCalls);
+  EXPECT_THROW(static_cast<void>(::operator new(hugeSize())), std::bad_alloc);
+  EXPECT_EQ(handlerCalls, 3);
+
+  // nothrow-вариант проходит через тот же обработчик и возвращает nullptr.
+  handlerCalls = 0;
+  std::set_new_handler(giveUpAfterThreeCalls);
+  EXPECT_EQ(::operator new(hugeSize(), std::nothrow), nullptr);
+  EXPECT_EQ(handlerCalls, 3);
+
+  // Обработчик, бросающий сам, прерывает цикл.
+  std::set_new_handler([] { throw std::bad_alloc(); });
+  EXPECT_THROW(
+      static_cast<void>(::operator new[](hugeSize(), std::align_val_t{128})),
+      std::bad_alloc);
+  std::set_new_handler(nullptr);
+}
+
+TEST(SlabNewDelete, StlContainers_Test) {
+  std::vector<int> v;
+  for (int i = 0; i < 100000; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_TRUE(fromSlabHeap(v.data()));
+  EXPECT_EQ(v[99999], 99999);
+
+  std::string s(200, 'x');
+  EXPECT_TRUE(fromSlabHeap(s.data()));
+
+  std::map<int, std::string> map;
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(i, std::to_string(i));
+  }
+  EXPECT_EQ(map.at(500), "500");
+
+  auto shared = std::make_shared<std::vector<double>>(10, 1.5);
+  EXPECT_TRUE(fromSlabHeap(shared.get()));
+}
+
+TEST(SlabNewDelete, LargeBuffersReuseMappings_Test) {
+  { std::vector<char> warmup(256 * 1024); }
+  const std::size_t mapped = SlabHeap::stats().mappedBytes;
+  const void* first = nullptr;
+  for (int i = 0; i < 1000; ++i) {
+    std::vector<char> buffer(256 * 1024 + static_cast<std::size_t>(i));
+    if (i == 0) {
+      first = buffer.data();
+    }
+    EXPECT_EQ(buffer.data(), first);
+  }
+  EXPECT_EQ(SlabHeap::stats().mappedBytes, mapped);
+}
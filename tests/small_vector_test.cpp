@@ -0,0 +1,192 @@
+#include "small_vector.h"
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Тривиально перемещаемый по объявлению, но с нетривиальным move: счётчики
+// показывают, что контейнер переносит его memcpy, а не конструкторами.
+struct Relocatable {
+  using IsTriviallyRelocatable = std::true_type;
+  static inline int moves = 0;
+  static inline int alive = 0;
+
+  explicit Relocatable(int v = 0) : value(std::make_unique<int>(v)) {
+    ++alive;
+  }
+  Relocatable(const Relocatable& other)
+      : value(std::make_unique<int>(*other.value)) {
+    ++alive;
+  }
+  Relocatable(Relocatable&& other) noexcept : value(std::move(other.value)) {
+    ++moves;
+    ++alive;
+  }
+  Relocatable& operator=(const Relocatable& other) {
+    value = std::make_unique<int>(*other.value);
+    return *this;
+  }
+  ~Relocatable() { --alive; }
+  bool operator==(const Relocatable& other) const {
+    return *value == *other.value;
+  }
+
+  std::unique_ptr<int> value;
+};
+
+// Хранит указатель на себя: переносится только конструкторами.
+struct SelfRef {
+  explicit SelfRef(int v = 0) : self(this), value(v) {}
+  SelfRef(const SelfRef& other) : self(this), value(other.value) {}
+  SelfRef(SelfRef&& other) noexcept : self(this), value(other.value) {}
+  SelfRef& operator=(const SelfRef& other) {
+    value = other.value;
+    return *this;
+  }
+  bool valid() const { return self == this; }
+
+  SelfRef* self;
+  int value;
+};
+
+template <typename Vector>
+std::vector<int> values(const Vector& v) {
+  std::vector<int> result;
+  for (const auto& item : v) {
+    result.push_back(*item.value);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(Relocate, Algorithms_Test) {
+  alignas(Relocatable) unsigned char raw[3 * sizeof(Relocatable)];
+  Relocatable source[3] = {Relocatable(1), Relocatable(2), Relocatable(3)};
+  Relocatable::moves = 0;
+  auto* dest = reinterpret_cast<Relocatable*>(raw);
+  Relocatable* end = uninitialized_relocate(source, source + 3, dest);
+  EXPECT_EQ(end, dest + 3);
+  EXPECT_EQ(Relocatable::moves, 0);
+  EXPECT_EQ(*dest[2].value, 3);
+
+  // Перекрывающийся сдвиг вправо и обратно.
+  std::destroy_at(dest + 2);
+  relocate(dest, dest + 2, dest + 1);
+  EXPECT_EQ(*dest[1].value, 1);
+  EXPECT_EQ(*dest[2].value, 2);
+  relocate(dest + 1, dest + 3, dest);
+  EXPECT_EQ(*dest[0].value, 1);
+  std::destroy(dest, dest + 2);
+  // source уже перенесён: его деструкторы не должны ничего освобождать.
+  for (auto& s : source) {
+    new (&s) Relocatable();
+  }
+}
+
+TEST(SmallVector, InlineThenHeap_Test) {
+  SmallVector<int, 4> v;
+  EXPECT_TRUE(v.isInline());
+  EXPECT_EQ(v.capacity(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_TRUE(v.isInline());
+  v.push_back(4);
+  EXPECT_FALSE(v.isInline());
+  EXPECT_EQ(v, (SmallVector<int, 4>{0, 1, 2, 3, 4}));
+
+  v.erase(v.begin() + 1, v.begin() + 3);
+  EXPECT_EQ(v, (SmallVector<int, 4>{0, 3, 4}));
+  v.shrink_to_fit();
+  EXPECT_TRUE(v.isInline());
+  EXPECT_EQ(v, (SmallVector<int, 4>{0, 3, 4}));
+  EXPECT_THROW(v.at(3), std::out_of_range);
+}
+
+TEST(SmallVector, RelocatesWithoutMoves_Test) {
+  {
+    RelocatingVector<Relocatable> v;
+    Relocatable::moves = 0;
+    for (int i = 0; i < 1000; ++i) {
+      v.emplace_back(i);
+    }
+    v.insert(v.begin() + 500, Relocatable(-1));
+    v.erase(v.begin());
+    EXPECT_EQ(Relocatable::moves, 1);  // только во временный объект insert
+    EXPECT_EQ(v.size(), 1000u);
+    EXPECT_EQ(*v[499].value, -1);
+    EXPECT_EQ(*v.back().value, 999);
+  }
+  EXPECT_EQ(Relocatable::alive, 0);
+}
+
+TEST(SmallVector, NonTrivialTypes_Test) {
+  SmallVector<SelfRef, 2> v;
+  for (int i = 0; i < 20; ++i) {
+    v.emplace(v.begin() + i / 2, i);
+  }
+  for (const auto& item : v) {
+    EXPECT_TRUE(item.valid());
+  }
+  SmallVector<SelfRef, 2> moved = std::move(v);
+  EXPECT_TRUE(v.empty());
+  EXPECT_EQ(moved.size(), 20u);
+  moved.erase(moved.begin() + 3);
+  for (const auto& item : moved) {
+    EXPECT_TRUE(item.valid());
+  }
+
+  SmallVector<std::string, 3> strings = {"a", "b"};
+  strings.insert(strings.begin() + 1, 3, std::string(40, 'x'));
+  EXPECT_EQ(strings.size(), 5u);
+  EXPECT_EQ(strings[4], "b");
+  SmallVector<std::string, 3> small = {"x"};
+  strings.swap(small);
+  EXPECT_EQ(strings.size(), 1u);
+  EXPECT_EQ(small.size(), 5u);
+  EXPECT_TRUE(strings.isInline());
+}
+
+TEST(SmallVector, InsertAliasingAndRanges_Test) {
+  {
+    SmallVector<Relocatable, 2> v;
+    v.emplace_back(1);
+    v.emplace_back(2);
+    // Аргумент ссылается на элемент, а вставка вызывает рост.
+    v.insert(v.begin(), v[1]);
+    v.push_back(v[0]);
+    v.resize(6, v[1]);
+    EXPECT_EQ(values(v), (std::vector<int>{2, 1, 2, 2, 1, 1}));
+
+    std::vector<Relocatable> extra;
+    extra.emplace_back(7);
+    extra.emplace_back(8);
+    v.insert(v.begin() + 2, extra.begin(), extra.end());
+    EXPECT_EQ(values(v), (std::vector<int>{2, 1, 7, 8, 2, 2, 1, 1}));
+
+    SmallVector<Relocatable, 2> copy = v;
+    EXPECT_EQ(copy, v);
+    copy.assign(3, Relocatable(5));
+    EXPECT_EQ(values(copy), (std::vector<int>{5, 5, 5}));
+    copy.clear();
+    EXPECT_TRUE(copy.empty());
+  }
+  EXPECT_EQ(Relocatable::alive, 0);
+}
+
+TEST(SmallVector, Resize_Test) {
+  RelocatingVector<int> v(3);
+  EXPECT_EQ(v, (RelocatingVector<int>{0, 0, 0}));
+  v.resize(5, 7);
+  EXPECT_EQ(v, (RelocatingVector<int>{0, 0, 0, 7, 7}));
+  v.resize(1);
+  EXPECT_EQ(v.size(), 1u);
+  v.reserve(100);
+  EXPECT_GE(v.capacity(), 100u);
+  v.shrink_to_fit();
+  EXPECT_EQ(v.capacity(), 1u);
+}
@@ -27,3 +27,28 @@ TEST(Traits, HasMember_Test) {
   EXPECT_TRUE(has_member_fptr_v<Bar>);
 }
 
+
+struct RelocatableTagged {
+  using IsTriviallyRelocatable = std::true_type;
+  RelocatableTagged() = default;
+  RelocatableTagged(const RelocatableTagged&) {}
+  std::unique_ptr<int> owned;
+};
+
+struct SelfReferencing {
+  SelfReferencing() : self(this) {}
+  SelfReferencing(const SelfReferencing&) : self(this) {}
+  SelfReferencing* self;
+};
+
+TEST(Traits, TriviallyRelocatable_Test) {
+  EXPECT_TRUE(is_trivially_relocatable_v<int>);
+  EXPECT_TRUE(is_trivially_relocatable_v<const Foo1*>);
+  EXPECT_TRUE(is_trivially_relocatable_v<std::unique_ptr<Bar>>);
+  EXPECT_TRUE(is_trivially_relocatable_v<std::shared_ptr<int>>);
+  EXPECT_TRUE(is_trivially_relocatable_v<RelocatableTagged>);
+  EXPECT_TRUE((is_trivially_relocatable_v<
+               std::pair<int, std::unique_ptr<int>>>));
+  EXPECT_FALSE(is_trivially_relocatable_v<SelfReferencing>);
+  EXPECT_FALSE((is_trivially_relocatable_v<std::pair<int, SelfReferencing>>));
+}
@@ -0,0 +1,233 @@
+#include "udp.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::span<const std::byte> bytes(const std::string& s) {
+  return std::as_bytes(std::span(s.data(), s.size()));
+}
+
+std::string text(std::span<const std::byte> payload) {
+  return {reinterpret_cast<const char*>(payload.data()), payload.size()};
+}
+
+// Ждёт ответ на клиентском сокете; пустая строка - таймаут.
+std::string receiveText(const UdpSocket& socket, int timeoutMs = 2000) {
+  pollfd fd{socket.fd(), POLLIN, 0};
+  if (::poll(&fd, 1, timeoutMs) <= 0) {
+    return {};
+  }
+  char buffer[2048];
+  const ssize_t n = ::recv(socket.fd(), buffer, sizeof(buffer), 0);
+  return n > 0 ? std::string(buffer, static_cast<std::size_t>(n))
+               : std::string();
+}
+
+void sendText(const UdpSocket& socket, const std::string& s,
+              const SocketAddress& to) {
+  ASSERT_EQ(::sendto(socket.fd(), s.data(), s.size(), 0, to.get(), to.size()),
+            static_cast<ssize_t>(s.size()));
+}
+
+template <typename Transport>
+class UdpTransportTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    if constexpr (std::is_same_v<Transport, UringTransport>) {
+      if (!UringTransport::supported()) {
+        GTEST_SKIP() << "io_uring is not available";
+      }
+    }
+  }
+};
+
+using Transports = testing::Types<MmsgTransport, UringTransport>;
+TYPED_TEST_SUITE(UdpTransportTest, Transports);
+
+}  // namespace
+
+TEST(Udp, SocketAddress_Test) {
+  const SocketAddress a = SocketAddress::ipv4("127.0.0.1", 4000);
+  EXPECT_EQ(a.port(), 4000);
+  EXPECT_EQ(a.size(), sizeof(sockaddr_in));
+  EXPECT_EQ(a, SocketAddress::loopback(4000));
+  EXPECT_FALSE(a == SocketAddress::loopback(4001));
+  EXPECT_THROW(SocketAddress::ipv4("not an address", 1),
+               std::invalid_argument);
+
+  UdpSocket socket(SocketAddress::loopback());
+  EXPECT_NE(socket.localAddress().port(), 0);
+}
+
+TEST(Udp, PacketPoolRecyclesBuffers_Test) {
+  PacketPool pool(4, 512);
+  EXPECT_EQ(pool.available(), 4u);
+  std::set<std::byte*> seen;
+  std::vector<std::uint32_t> ids;
+  for (std::uint32_t id; (id = pool.acquire()) != PacketPool::kNone;) {
+    ids.push_back(id);
+    seen.insert(pool.buffer(id));
+  }
+  EXPECT_EQ(ids.size(), 4u);
+  EXPECT_EQ(seen.size(), 4u);
+  EXPECT_EQ(pool.buffer(1) - pool.buffer(0), 512);
+  pool.release(ids[2]);
+  EXPECT_EQ(pool.acquire(), ids[2]);
+  EXPECT_THROW(PacketPool(0), std::invalid_argument);
+}
+
+TYPED_TEST(UdpTransportTest, ReceivesAndSendsBatches_Test) {
+  UdpSocket server(SocketAddress::loopback());
+  UdpSocket client(SocketAddress::loopback());
+  server.setBufferSizes(1 << 20);
+  PacketPool pool(128);
+  TypeParam transport(server, pool, 32);
+
+  constexpr int kPackets = 100;
+  for (int i = 0; i < kPackets; ++i) {
+    sendText(client, "packet " + std::to_string(i), server.localAddress());
+  }
+  std::vector<std::string> received;
+  std::vector<OutPacket> replies;
+  std::vector<std::string> payloads;
+  const SocketAddress clientAddress = client.localAddress();
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (received.size() < kPackets &&
+         std::chrono::steady_clock::now() < deadline) {
+    transport.receive(
+        [&](std::span<const std::byte> payload, const SocketAddress& from) {
+          // Данные лежат прямо в буфере пула.
+          EXPECT_GE(payload.data(), pool.buffer(0));
+          EXPECT_LT(payload.data(), pool.buffer(pool.count() - 1) + 2048);
+          EXPECT_EQ(from, clientAddress);
+          received.push_back(text(payload));
+        },
+        100);
+  }
+  ASSERT_EQ(received.size(), static_cast<std::size_t>(kPackets));
+  for (int i = 0; i < kPackets; ++i) {
+    EXPECT_EQ(received[static_cast<std::size_t>(i)],
+              "packet " + std::to_string(i));
+  }
+
+  payloads.reserve(kPackets);
+  for (int i = 0; i < kPackets; ++i) {
+    payloads.push_back("reply " + std::to_string(i));
+    replies.push_back({bytes(payloads.back()), &clientAddress});
+  }
+  EXPECT_EQ(transport.send(replies), static_cast<std::size_t>(kPackets));
+  for (int i = 0; i < kPackets; ++i) {
+    EXPECT_EQ(receiveText(client), "reply " + std::to_string(i));
+  }
+}
+
+TYPED_TEST(UdpTransportTest, ReturnsBuffersToPool_Test) {
+  UdpSocket server(SocketAddress::loopback());
+  UdpSocket client(SocketAddress::loopback());
+  PacketPool pool(64);
+  {
+    TypeParam transport(server, pool, 16);
+    sendText(client, "ping", server.localAddress());
+    std::size_t got = 0;
+    for (int i = 0; i < 50 && got == 0; ++i) {
+      got = transport.receive(
+          [](std::span<const std::byte>, const SocketAddress&) {}, 100);
+    }
+    EXPECT_EQ(got, 1u);
+    // Пустой сокет: ожидание ограничено таймаутом.
+    EXPECT_EQ(transport.receive(
+                  [](std::span<const std::byte>, const SocketAddress&) {}, 10),
+              0u);
+  }
+  EXPECT_EQ(pool.available(), pool.count());
+}
+
+TYPED_TEST(UdpTransportTest, HandlerExceptionKeepsReceiving_Test) {
+  UdpSocket server(SocketAddress::loopback());
+  UdpSocket client(SocketAddress::loopback());
+  PacketPool pool(4);
+  // Один приёмный слот: если он не перевзведётся, дальше ничего не придёт.
+  TypeParam transport(server, pool, 1);
+  sendText(client, "boom", server.localAddress());
+  bool thrown = false;
+  for (int i = 0; i < 50 && !thrown; ++i) {
+    try {
+      transport.receive(
+          [](std::span<const std::byte>, const SocketAddress&) {
+            throw std::runtime_error("handler failed");
+          },
+          100);
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+  }
+  ASSERT_TRUE(thrown);
+
+  std::vector<std::string> received;
+  for (int i = 0; i < 3; ++i) {
+    sendText(client, "after " + std::to_string(i), server.localAddress());
+    for (int attempt = 0; attempt < 50 && received.size() <= std::size_t(i);
+         ++attempt) {
+      transport.receive(
+          [&](std::span<const std::byte> payload, const SocketAddress&) {
+            received.push_back(text(payload));
+          },
+          100);
+    }
+  }
+  EXPECT_EQ(received,
+            (std::vector<std::string>{"after 0", "after 1", "after 2"}));
+}
+
+TYPED_TEST(UdpTransportTest, EchoServerShardsAcrossThreads_Test) {
+  using Server = UdpServer<TypeParam>;
+  typename Server::Options options;
+  options.shards = 4;
+  options.buffers = 256;
+  std::mutex mutex;
+  std::set<std::size_t> shardsSeen;
+  std::atomic<int> handled{0};
+  Server server(
+      SocketAddress::loopback(),
+      [&](typename Server::Shard& shard, std::span<const std::byte> payload,
+          const SocketAddress& from) {
+        {
+          std::lock_guard lock(mutex);
+          shardsSeen.insert(shard.index());
+        }
+        handled.fetch_add(1, std::memory_order_relaxed);
+        shard.reply(payload, from);
+      },
+      options);
+  EXPECT_EQ(server.shardCount(), 4u);
+  ASSERT_NE(server.port(), 0);
+
+  // Разные порты клиентов - разные хэши: ядро раскладывает по шардам.
+  std::vector<UdpSocket> clients;
+  for (int i = 0; i < 16; ++i) {
+    clients.emplace_back(SocketAddress::loopback());
+  }
+  for (std::size_t i = 0; i < clients.size(); ++i) {
+    for (int j = 0; j < 5; ++j) {
+      const std::string message =
+          std::to_string(i) + ":" + std::to_string(j);
+      sendText(clients[i], message, server.address());
+      EXPECT_EQ(receiveText(clients[i]), message);
+    }
+  }
+  EXPECT_EQ(handled.load(), 80);
+  server.stop();
+  EXPECT_GT(shardsSeen.size(), 1u);
+}